@@ -17,8 +17,10 @@
 */
 
 #include "errorcheck.h"
+#include <QAtomicInteger>
 #include <QCoreApplication>
 #include <QFile>
+#include <QHash>
 #include <QReadLocker>
 #include <QRegExp>
 #include <QThread>
@@ -30,11 +32,16 @@
 #if defined(RTKIT_SUPPORT)
 #include <QDBusConnection>
 #include <QDBusInterface>
-#include <sys/resource.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 #endif
+#include <cerrno>
+#include <limits>
 #include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
 
 #ifndef RLIMIT_RTTIME
 #define RLIMIT_RTTIME 15
@@ -48,6 +55,14 @@
 #define DEFAULT_INPUT_TIMEOUT 500
 #endif
 
+#ifndef DEFAULT_RT_PRIORITY
+#define DEFAULT_RT_PRIORITY 6
+#endif
+
+#ifndef PREFAULT_STACK_SIZE
+#define PREFAULT_STACK_SIZE (64 * 1024)
+#endif
+
 /**
  * @file alsaclient.cpp
  * Implementation of classes managing ALSA Sequencer clients
@@ -198,6 +213,8 @@ public:
     bool stopped();
     void stop();
     void setRealtimePriority();
+    void setCpuAffinity();
+    void lockMemory();
 
     MidiClient *m_MidiClient;
     int m_Wait;
@@ -213,6 +230,13 @@ public:
         m_eventsEnabled(false),
         m_BlockMode(false),
         m_NeedRefreshClientList(true),
+        m_AnnounceTracked(false),
+        m_TopologyVersion(0),
+        m_RtPolicy(SCHED_RR),
+        m_RtPriority(DEFAULT_RT_PRIORITY),
+        m_LockMemory(false),
+        m_FaultCheck(false),
+        m_InputTimeout(DEFAULT_INPUT_TIMEOUT),
         m_OpenMode(SND_SEQ_OPEN_DUPLEX),
         m_DeviceName("default"),
         m_SeqHandle(nullptr),
@@ -224,6 +248,14 @@ public:
     bool m_eventsEnabled;
     bool m_BlockMode;
     bool m_NeedRefreshClientList;
+    bool m_AnnounceTracked;
+    quint64 m_TopologyVersion;
+    int m_RtPolicy;
+    int m_RtPriority;
+    bool m_LockMemory;
+    bool m_FaultCheck;
+    int m_InputTimeout;
+    QList<int> m_InputCpus;
     int  m_OpenMode;
     QString m_DeviceName;
     snd_seq_t* m_SeqHandle;
@@ -239,8 +271,322 @@ public:
     QObjectList m_listeners;
     SystemInfo m_sysInfo;
     PoolInfo m_poolInfo;
+    QReadWriteLock m_TopologyLock;
+    QHash<int, int> m_ClientIndex;
+    QHash<QString, int> m_ClientNameIndex;
+    QHash<int, int> m_PortIndex;
+
+    bool isTracking() const;
+    void invalidateClientList();
+    void updateClient(int clientId, const ClientInfo* cInfo);
+    void updateTopology();
+    void updateIndexes();
+
+    /* input thread statistics, written by the input thread only */
+    void resetInputStatistics();
+    void recordDispatchLatency(const snd_seq_event_t* evp);
+    QAtomicInteger<quint64> m_Wakeups;
+    QAtomicInteger<qint64> m_LatencyTotal;
+    QAtomicInteger<qint64> m_LatencyMin;
+    QAtomicInteger<qint64> m_LatencyMax;
+    QAtomicInteger<quint64> m_Dispatches;
+    QAtomicInteger<quint64> m_PageFaults;
+    QAtomicInteger<quint64> m_StampedEvents;
+    QAtomicInteger<qint64> m_DispatchTotal;
+    QAtomicInteger<qint64> m_DispatchMin;
+    QAtomicInteger<qint64> m_DispatchMax;
 };
 
+void
+MidiClient::MidiClientPrivate::resetInputStatistics()
+{
+    m_Wakeups.store(0);
+    m_LatencyTotal.store(0);
+    m_LatencyMin.store(std::numeric_limits<qint64>::max());
+    m_LatencyMax.store(0);
+    m_Dispatches.store(0);
+    m_PageFaults.store(0);
+    m_StampedEvents.store(0);
+    m_DispatchTotal.store(0);
+    m_DispatchMin.store(std::numeric_limits<qint64>::max());
+    m_DispatchMax.store(0);
+}
+
+/*
+ * Measures the delay from the real-time stamp of an event, given by its
+ * queue at arrival or scheduling time, to the current time of that queue.
+ * The queue status lives on the stack, so nothing is allocated.
+ */
+void
+MidiClient::MidiClientPrivate::recordDispatchLatency(const snd_seq_event_t* evp)
+{
+    snd_seq_queue_status_t* status;
+    snd_seq_queue_status_alloca(&status);
+    if (snd_seq_get_queue_status(m_SeqHandle, evp->queue, status) < 0)
+        return;
+    const snd_seq_real_time_t* now = snd_seq_queue_status_get_real_time(status);
+    qint64 latency = (qint64(now->tv_sec) - qint64(evp->time.time.tv_sec)) * 1000000000 +
+                     (qint64(now->tv_nsec) - qint64(evp->time.time.tv_nsec));
+    latency = qMax(Q_INT64_C(0), latency);
+    m_StampedEvents.fetchAndAddRelaxed(1);
+    m_DispatchTotal.fetchAndAddRelaxed(latency);
+    if (latency < m_DispatchMin.load())
+        m_DispatchMin.store(latency);
+    if (latency > m_DispatchMax.load())
+        m_DispatchMax.store(latency);
+}
+
+/*
+ * Monotonic clock, in nanoseconds.
+ */
+static qint64
+monotonicTime()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Minor and major page faults of the calling thread.
+ */
+static quint64
+threadPageFaults()
+{
+    struct rusage usage;
+    if (::getrusage(RUSAGE_THREAD, &usage) < 0)
+        return 0;
+    return quint64(usage.ru_minflt) + quint64(usage.ru_majflt);
+}
+
+/*
+ * Key of the ports index: an ALSA address packed into an int.
+ */
+static inline int
+portKey(int client, int port)
+{
+    return (client << 8) | (port & 0xff);
+}
+
+/*
+ * The ports of the clients list matching the filter capabilities, excluding
+ * the system client, this client, and the ports not meant to be exported.
+ */
+static PortInfoList
+filterClientPorts(const ClientInfoList& clients, unsigned int filter, int myId)
+{
+    PortInfoList result;
+    for (ClientInfo ci : clients) {
+        if ((ci.getClientId() == SND_SEQ_CLIENT_SYSTEM) ||
+            (ci.getClientId() == myId))
+            continue;
+        const PortInfoList lstPorts = ci.getPorts();
+        for (PortInfo pi : lstPorts) {
+            unsigned int cap = pi.getCapability();
+            if ( ((filter & cap) != 0) &&
+                 ((SND_SEQ_PORT_CAP_NO_EXPORT & cap) == 0) ) {
+                result.append(pi);
+            }
+        }
+    }
+    return result;
+}
+
+/*
+ * Replaces the ports of a single client within a ports list built by
+ * filterClientPorts(), which is sorted by client id. The ports of the
+ * client are removed when cInfo is null.
+ */
+static void
+updateClientPorts(PortInfoList& ports, int clientId, const ClientInfo* cInfo,
+                  unsigned int filter, int myId)
+{
+    int i = 0;
+    while ((i < ports.count()) && (ports[i].getClient() < clientId))
+        ++i;
+    while ((i < ports.count()) && (ports[i].getClient() == clientId))
+        ports.removeAt(i);
+    if (cInfo != nullptr) {
+        ClientInfoList single;
+        single.append(*cInfo);
+        const PortInfoList lstPorts = filterClientPorts(single, filter, myId);
+        for (const PortInfo& pi : lstPorts)
+            ports.insert(i++, pi);
+    }
+}
+
+/*
+ * True when the clients list shows a subscription of this client to the
+ * system announce port, so the topology changes reach the input thread.
+ */
+static bool
+announceSubscribed(const ClientInfoList& clients, int myId)
+{
+    for (ClientInfo ci : clients) {
+        if (ci.getClientId() != SND_SEQ_CLIENT_SYSTEM)
+            continue;
+        const PortInfoList lstPorts = ci.getPorts();
+        for (PortInfo pi : lstPorts) {
+            if (pi.getPort() != SND_SEQ_PORT_SYSTEM_ANNOUNCE)
+                continue;
+            SubscribersList subs = pi.getReadSubscribers();
+            for (Subscriber& s : subs) {
+                if (s.getAddr()->client == myId)
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * The cached clients list is trusted without asking the sequencer only
+ * while the input thread is running and receiving the announcements.
+ * The caller must hold the topology lock.
+ */
+bool
+MidiClient::MidiClientPrivate::isTracking() const
+{
+    return m_AnnounceTracked && (m_Thread != nullptr) && m_Thread->isRunning();
+}
+
+void
+MidiClient::MidiClientPrivate::invalidateClientList()
+{
+    QWriteLocker locker(&m_TopologyLock);
+    m_NeedRefreshClientList = true;
+}
+
+/*
+ * Replaces a client of the clients list after an announcement, inserting
+ * it at its place when it is new, or removes it when cInfo is null. Only
+ * the index entries and the available ports of that client are updated,
+ * besides shifting the positions of the following clients when one is
+ * inserted or removed. The caller must hold the topology lock for writing.
+ */
+void
+MidiClient::MidiClientPrivate::updateClient(int clientId, const ClientInfo* cInfo)
+{
+    int i = m_ClientIndex.value(clientId, -1);
+    if ((i < 0) && (cInfo == nullptr))
+        return;
+    const int myId = snd_seq_client_id(m_SeqHandle);
+    QString oldName;
+    if (i >= 0) {
+        ClientInfo old = m_ClientList.at(i);
+        oldName = old.getName().toCaseFolded();
+        const PortInfoList lstPorts = old.getPorts();
+        for (PortInfo pi : lstPorts)
+            m_PortIndex.remove(portKey(clientId, pi.getPort()));
+    }
+    if (cInfo == nullptr) {
+        m_ClientList.removeAt(i);
+        m_ClientIndex.remove(clientId);
+        QHash<int, int>::Iterator it;
+        for (it = m_ClientIndex.begin(); it != m_ClientIndex.end(); ++it) {
+            if (it.value() > i)
+                --it.value();
+        }
+    } else if (i >= 0) {
+        m_ClientList[i] = *cInfo;
+    } else {
+        // keep the list sorted by client id
+        i = 0;
+        QHash<int, int>::Iterator it;
+        for (it = m_ClientIndex.begin(); it != m_ClientIndex.end(); ++it) {
+            if (it.key() < clientId)
+                ++i;
+        }
+        for (it = m_ClientIndex.begin(); it != m_ClientIndex.end(); ++it) {
+            if (it.value() >= i)
+                ++it.value();
+        }
+        m_ClientList.insert(i, *cInfo);
+        m_ClientIndex.insert(clientId, i);
+    }
+    QString newName;
+    if (cInfo != nullptr) {
+        ClientInfo ci = *cInfo;
+        newName = ci.getName().toCaseFolded();
+        const PortInfoList lstPorts = ci.getPorts();
+        for (int j = 0; j < lstPorts.count(); ++j) {
+            PortInfo pi = lstPorts.at(j);
+            m_PortIndex.insert(portKey(clientId, pi.getPort()), j);
+        }
+    }
+    if ((oldName != newName) && (m_ClientNameIndex.value(oldName, -1) == clientId)) {
+        // the name goes to the next client using it, if any
+        m_ClientNameIndex.remove(oldName);
+        for (ClientInfo ci : m_ClientList) {
+            if (ci.getName().toCaseFolded() == oldName) {
+                m_ClientNameIndex.insert(oldName, ci.getClientId());
+                break;
+            }
+        }
+    }
+    if (cInfo != nullptr) {
+        const int first = m_ClientNameIndex.value(newName, -1);
+        if ((first < 0) || (first > clientId))
+            m_ClientNameIndex.insert(newName, clientId);
+    }
+    updateClientPorts( m_InputsAvail, clientId, cInfo, SND_SEQ_PORT_CAP_READ |
+                       SND_SEQ_PORT_CAP_SUBS_READ, myId );
+    updateClientPorts( m_OutputsAvail, clientId, cInfo, SND_SEQ_PORT_CAP_WRITE |
+                       SND_SEQ_PORT_CAP_SUBS_WRITE, myId );
+    if (clientId == SND_SEQ_CLIENT_SYSTEM) {
+        ClientInfoList single;
+        if (cInfo != nullptr)
+            single.append(*cInfo);
+        m_AnnounceTracked = announceSubscribed(single, myId);
+    }
+    ++m_TopologyVersion;
+}
+
+/*
+ * Rebuilds the available ports lists after a full refresh of the clients
+ * list. The caller must hold the topology lock for writing.
+ */
+void
+MidiClient::MidiClientPrivate::updateTopology()
+{
+    const int myId = snd_seq_client_id(m_SeqHandle);
+    m_InputsAvail = filterClientPorts( m_ClientList, SND_SEQ_PORT_CAP_READ |
+                                       SND_SEQ_PORT_CAP_SUBS_READ, myId );
+    m_OutputsAvail = filterClientPorts( m_ClientList, SND_SEQ_PORT_CAP_WRITE |
+                                        SND_SEQ_PORT_CAP_SUBS_WRITE, myId );
+    m_AnnounceTracked = announceSubscribed(m_ClientList, myId);
+    updateIndexes();
+    ++m_TopologyVersion;
+}
+
+/*
+ * Rebuilds the hash indexes of the clients list: the position of each
+ * client by id, the id of each client by case folded name (the first
+ * one wins, as the clients are sorted by id), and the position of each
+ * port within its client by address. The caller must hold the topology
+ * lock for writing.
+ */
+void
+MidiClient::MidiClientPrivate::updateIndexes()
+{
+    m_ClientIndex.clear();
+    m_ClientNameIndex.clear();
+    m_PortIndex.clear();
+    for (int i = 0; i < m_ClientList.count(); ++i) {
+        ClientInfo ci = m_ClientList.at(i);
+        const int clientId = ci.getClientId();
+        const QString name = ci.getName().toCaseFolded();
+        m_ClientIndex.insert(clientId, i);
+        if (!m_ClientNameIndex.contains(name))
+            m_ClientNameIndex.insert(name, clientId);
+        const PortInfoList lstPorts = ci.getPorts();
+        for (int j = 0; j < lstPorts.count(); ++j) {
+            PortInfo pi = lstPorts.at(j);
+            m_PortIndex.insert(portKey(clientId, pi.getPort()), j);
+        }
+    }
+}
+
 /**
  * Constructor.
  *
@@ -369,6 +715,161 @@ bool MidiClient::realTimeInputEnabled()
     return d->m_Thread->m_RealTime;
 }
 
+/**
+ * Sets the scheduling policy and priority of the MIDI input thread, used
+ * when the real-time priority is enabled. The policy may be SCHED_FIFO or
+ * SCHED_RR, and the priority is limited to the valid range of the policy.
+ * The default is SCHED_RR with priority 6. The new values are applied the
+ * next time the input thread is started.
+ *
+ * @param policy The real-time scheduling policy
+ * @param priority The real-time priority
+ * @see setRealTimeInput(), startSequencerInput()
+ */
+void MidiClient::setRealTimePolicy(int policy, int priority)
+{
+    if ((policy != SCHED_FIFO) && (policy != SCHED_RR)) {
+        qWarning() << "unsupported real-time policy" << policy;
+        return;
+    }
+    d->m_RtPolicy = policy;
+    d->m_RtPriority = qBound(::sched_get_priority_min(policy), priority,
+                             ::sched_get_priority_max(policy));
+}
+
+/**
+ * Returns the real-time scheduling policy of the MIDI input thread.
+ * @return SCHED_FIFO or SCHED_RR
+ */
+int MidiClient::getRealTimePolicy()
+{
+    return d->m_RtPolicy;
+}
+
+/**
+ * Returns the real-time priority of the MIDI input thread.
+ * @return The real-time priority
+ */
+int MidiClient::getRealTimePriority()
+{
+    return d->m_RtPriority;
+}
+
+/**
+ * Pins the MIDI input thread to a set of CPU cores, for instance the
+ * cores isolated from the general scheduler. An empty list leaves the
+ * thread affinity unchanged. The new set is applied the next time the
+ * input thread is started.
+ *
+ * @param cpus List of CPU core numbers
+ */
+void MidiClient::setInputCpuAffinity(const QList<int>& cpus)
+{
+    d->m_InputCpus = cpus;
+}
+
+/**
+ * Returns the CPU cores the MIDI input thread is pinned to.
+ * @return List of CPU core numbers, empty if not pinned
+ */
+QList<int> MidiClient::getInputCpuAffinity()
+{
+    return d->m_InputCpus;
+}
+
+/**
+ * Enables locking the memory when the MIDI input thread starts, so it is
+ * never paged out. This calls mlockall(), which affects the whole process
+ * and may require the CAP_IPC_LOCK capability or a big enough
+ * RLIMIT_MEMLOCK. The thread also touches the first part of its stack
+ * before entering the input loop.
+ *
+ * @param enabled Memory locking enabled
+ */
+void MidiClient::setInputMemoryLocked(bool enabled)
+{
+    d->m_LockMemory = enabled;
+}
+
+/**
+ * Returns whether the memory is locked when the MIDI input thread starts.
+ * @return true if memory locking is enabled
+ */
+bool MidiClient::isInputMemoryLocked()
+{
+    return d->m_LockMemory;
+}
+
+/**
+ * Enables a debugging mode counting the page faults of the input thread
+ * while dispatching the input events, like the first touch of memory not
+ * locked or prefaulted. The faults are counted in getInputStatistics(),
+ * and a warning is printed the first time. This adds two system calls per
+ * dispatching round, and should not be used in production.
+ *
+ * This is a page fault check only, it does not detect memory allocations:
+ * doEvents() allocates a SequencerEvent for every received event, and an
+ * allocation served from memory already mapped causes no fault.
+ *
+ * @param enabled Page fault checking enabled
+ */
+void MidiClient::setInputFaultCheck(bool enabled)
+{
+    d->m_FaultCheck = enabled;
+}
+
+/**
+ * Returns whether the input page fault check is enabled.
+ * @return true if page faults are checked
+ */
+bool MidiClient::getInputFaultCheck()
+{
+    return d->m_FaultCheck;
+}
+
+/**
+ * Sets the poll timeout of the MIDI input thread. The thread wakes up at
+ * least this often to check whether it should stop, and the wakeup latency
+ * is measured on these wakeups. The default is 500 milliseconds. The new
+ * value is applied the next time the input thread is started.
+ *
+ * @param msecs Timeout in milliseconds
+ */
+void MidiClient::setInputTimeout(int msecs)
+{
+    d->m_InputTimeout = qMax(1, msecs);
+}
+
+/**
+ * Returns the poll timeout of the MIDI input thread.
+ * @return Timeout in milliseconds
+ */
+int MidiClient::getInputTimeout()
+{
+    return d->m_InputTimeout;
+}
+
+/**
+ * Gets the measurements of the MIDI input thread since it was started.
+ * This function does not lock, and may be called from any thread.
+ * @return The input thread statistics
+ */
+InputThreadStatistics MidiClient::getInputStatistics()
+{
+    InputThreadStatistics st;
+    st.wakeups = d->m_Wakeups.load();
+    st.minLatency = (st.wakeups > 0) ? d->m_LatencyMin.load() : 0;
+    st.meanLatency = (st.wakeups > 0) ? d->m_LatencyTotal.load() / qint64(st.wakeups) : 0;
+    st.maxLatency = d->m_LatencyMax.load();
+    st.dispatches = d->m_Dispatches.load();
+    st.pageFaults = d->m_PageFaults.load();
+    st.stampedEvents = d->m_StampedEvents.load();
+    st.minDispatchLatency = (st.stampedEvents > 0) ? d->m_DispatchMin.load() : 0;
+    st.meanDispatchLatency = (st.stampedEvents > 0) ? d->m_DispatchTotal.load() / qint64(st.stampedEvents) : 0;
+    st.maxDispatchLatency = d->m_DispatchMax.load();
+    return st;
+}
+
 /**
  * Open the sequencer device.
  *
@@ -585,11 +1086,16 @@ MidiClient::getSequencerType()
 void
 MidiClient::doEvents()
 {
+    bool measured = false;
     do {
         int err = 0;
         snd_seq_event_t* evp = nullptr;
         SequencerEvent* event = nullptr;
         err = snd_seq_event_input(d->m_SeqHandle, &evp);
+        if (err == -ENOSPC) {
+            // some announcements may have been lost
+            d->invalidateClientList();
+        }
         if ((err >= 0) && (evp != nullptr)) {
             switch (evp->type) {
 
@@ -635,20 +1141,23 @@ MidiClient::doEvents()
             case SND_SEQ_EVENT_PORT_SUBSCRIBED:
             case SND_SEQ_EVENT_PORT_UNSUBSCRIBED:
                 event = new SubscriptionEvent(evp);
+                readClient(evp->data.connect.sender.client);
+                if (evp->data.connect.dest.client != evp->data.connect.sender.client)
+                    readClient(evp->data.connect.dest.client);
                 break;
 
             case SND_SEQ_EVENT_PORT_CHANGE:
             case SND_SEQ_EVENT_PORT_EXIT:
             case SND_SEQ_EVENT_PORT_START:
                 event = new PortEvent(evp);
-                d->m_NeedRefreshClientList = true;
+                readClient(evp->data.addr.client);
                 break;
 
             case SND_SEQ_EVENT_CLIENT_CHANGE:
             case SND_SEQ_EVENT_CLIENT_EXIT:
             case SND_SEQ_EVENT_CLIENT_START:
                 event = new ClientEvent(evp);
-                d->m_NeedRefreshClientList = true;
+                readClient(evp->data.addr.client);
                 break;
 
             case SND_SEQ_EVENT_SONGPOS:
@@ -673,6 +1182,11 @@ MidiClient::doEvents()
                 event = new SequencerEvent(evp);
                 break;
             }
+            if (!measured && (evp->queue != SND_SEQ_QUEUE_DIRECT) &&
+                snd_seq_ev_is_real(evp) && snd_seq_ev_is_abstime(evp)) {
+                d->recordDispatchLatency(evp);
+                measured = true;
+            }
             // first, process the callback (if any)
             if (d->m_handler != nullptr) {
                 d->m_handler->handleSequencerEvent(event->clone());
@@ -704,6 +1218,10 @@ MidiClient::startSequencerInput()
     if (d->m_Thread == nullptr) {
         d->m_Thread = new SequencerInputThread(this, DEFAULT_INPUT_TIMEOUT);
     }
+    // the announcements received while stopped may have been lost
+    d->invalidateClientList();
+    d->resetInputStatistics();
+    d->m_Thread->m_Wait = d->m_InputTimeout;
     d->m_Thread->start( d->m_Thread->m_RealTime ?
             QThread::TimeCriticalPriority : QThread::InheritPriority );
 }
@@ -731,18 +1249,63 @@ MidiClient::stopSequencerInput()
 
 /**
  * Reads the ALSA sequencer's clients list.
+ *
+ * This is a full refresh, querying every client, port and subscription.
+ * While the input thread is running and this client is subscribed to the
+ * system announce port, the list is afterwards updated incrementally
+ * from the announcements, and readClient() is used instead.
  */
 void
 MidiClient::readClients()
 {
     ClientInfo cInfo;
-    freeClients();
+    QWriteLocker locker(&d->m_TopologyLock);
+    d->m_ClientList.clear();
     cInfo.setClient(-1);
     while (snd_seq_query_next_client(d->m_SeqHandle, cInfo.m_Info) >= 0) {
         cInfo.readPorts(this);
         d->m_ClientList.append(cInfo);
     }
     d->m_NeedRefreshClientList = false;
+    d->updateTopology();
+}
+
+/**
+ * Updates a single client of the clients list, after an announcement about
+ * the client, any of its ports, or any of its subscriptions. The client is
+ * removed from the list when it does not exist any more. Nothing is done
+ * when the list is already pending a full refresh.
+ * @param clientId The client ID
+ */
+void
+MidiClient::readClient(int clientId)
+{
+    QWriteLocker locker(&d->m_TopologyLock);
+    if (d->m_NeedRefreshClientList)
+        return;
+    ClientInfo cInfo;
+    if (snd_seq_get_any_client_info(d->m_SeqHandle, clientId, cInfo.m_Info) < 0) {
+        d->updateClient(clientId, nullptr);
+        return;
+    }
+    cInfo.readPorts(this);
+    d->updateClient(clientId, &cInfo);
+}
+
+/**
+ * Refreshes the clients list when it is invalid. With force, it is also
+ * refreshed when it is not being tracked from the announcements.
+ * @param force Refresh unless the clients list is being tracked
+ */
+void
+MidiClient::checkClientList(bool force)
+{
+    {
+        QReadLocker locker(&d->m_TopologyLock);
+        if (!d->m_NeedRefreshClientList && (!force || d->isTracking()))
+            return;
+    }
+    readClients();
 }
 
 /**
@@ -751,7 +1314,14 @@ MidiClient::readClients()
 void
 MidiClient::freeClients()
 {
+    QWriteLocker locker(&d->m_TopologyLock);
     d->m_ClientList.clear();
+    d->m_InputsAvail.clear();
+    d->m_OutputsAvail.clear();
+    d->m_ClientIndex.clear();
+    d->m_ClientNameIndex.clear();
+    d->m_PortIndex.clear();
+    d->m_NeedRefreshClientList = true;
 }
 
 /**
@@ -761,10 +1331,23 @@ MidiClient::freeClients()
 ClientInfoList
 MidiClient::getAvailableClients()
 {
-    if (d->m_NeedRefreshClientList)
-        readClients();
-    ClientInfoList lst = d->m_ClientList; // copy
-    return lst;
+    checkClientList(false);
+    QReadLocker locker(&d->m_TopologyLock);
+    return d->m_ClientList; // implicitly shared copy
+}
+
+/**
+ * Gets a counter incremented on every change of the clients list, either
+ * by a full refresh or by an announcement. Comparing it with a previous
+ * value tells whether the lists of clients and ports need to be fetched
+ * again. It is safe to call from any thread.
+ * @return the topology version number.
+ */
+quint64
+MidiClient::getTopologyVersion()
+{
+    QReadLocker locker(&d->m_TopologyLock);
+    return d->m_TopologyVersion;
 }
 
 /**
@@ -821,15 +1404,13 @@ MidiClient::getClientName()
 QString
 MidiClient::getClientName(const int clientId)
 {
-    ClientInfoList::Iterator it;
-    if (d->m_NeedRefreshClientList)
-        readClients();
-    for (it = d->m_ClientList.begin(); it != d->m_ClientList.end(); ++it) {
-        if ((*it).getClientId() == clientId) {
-            return (*it).getName();
-        }
-    }
-    return QString();
+    checkClientList(false);
+    QReadLocker locker(&d->m_TopologyLock);
+    const int i = d->m_ClientIndex.value(clientId, -1);
+    if (i < 0)
+        return QString();
+    ClientInfo ci = d->m_ClientList.at(i);
+    return ci.getName();
 }
 
 /**
@@ -1216,69 +1797,82 @@ MidiClient::getAvailableQueues()
 PortInfoList
 MidiClient::filterPorts(unsigned int filter)
 {
-    PortInfoList result;
-    ClientInfoList::ConstIterator itc;
-    PortInfoList::ConstIterator itp;
-
-    if (d->m_NeedRefreshClientList)
-        readClients();
-
-    for (itc = d->m_ClientList.constBegin(); itc != d->m_ClientList.constEnd(); ++itc) {
-        ClientInfo ci = (*itc);
-        if ((ci.getClientId() == SND_SEQ_CLIENT_SYSTEM) ||
-            (ci.getClientId() == d->m_Info.getClientId()))
-            continue;
-        PortInfoList lstPorts = ci.getPorts();
-        for(itp = lstPorts.constBegin(); itp != lstPorts.constEnd(); ++itp) {
-            PortInfo pi = (*itp);
-            unsigned int cap = pi.getCapability();
-            if ( ((filter & cap) != 0) &&
-                 ((SND_SEQ_PORT_CAP_NO_EXPORT & cap) == 0) ) {
-                result.append(pi);
-            }
-        }
-    }
-    return result;
+    checkClientList(false);
+    QReadLocker locker(&d->m_TopologyLock);
+    return filterClientPorts(d->m_ClientList, filter, d->m_Info.getClientId());
 }
 
 /**
  * Update the internal lists of user ports.
+ *
+ * The lists are rebuilt along with the clients list, so this only
+ * refreshes the clients list when it is not being tracked.
  */
 void
 MidiClient::updateAvailablePorts()
 {
-    d->m_InputsAvail.clear();
-    d->m_OutputsAvail.clear();
-    d->m_InputsAvail = filterPorts( SND_SEQ_PORT_CAP_READ |
-                                 SND_SEQ_PORT_CAP_SUBS_READ );
-    d->m_OutputsAvail = filterPorts( SND_SEQ_PORT_CAP_WRITE |
-                                  SND_SEQ_PORT_CAP_SUBS_WRITE );
+    checkClientList(true);
 }
 
 /**
  * Gets the available user input ports in the system.
+ *
+ * While the input thread is running and this client is subscribed to the
+ * system announce port, this returns a snapshot of the tracked topology
+ * without querying the sequencer, and it is safe to call from any thread.
+ * Otherwise the whole clients list is read again.
  * @return The list of available input ports.
  */
 PortInfoList
 MidiClient::getAvailableInputs()
 {
-    d->m_NeedRefreshClientList = true;
     updateAvailablePorts();
+    QReadLocker locker(&d->m_TopologyLock);
     return d->m_InputsAvail;
 }
 
 /**
  * Gets the available user output ports in the system.
+ *
+ * See getAvailableInputs() about when the sequencer is queried.
  * @return The list of available output ports.
  */
 PortInfoList
 MidiClient::getAvailableOutputs()
 {
-    d->m_NeedRefreshClientList = true;
     updateAvailablePorts();
+    QReadLocker locker(&d->m_TopologyLock);
     return d->m_OutputsAvail;
 }
 
+/**
+ * Gets the PortInfo of any port in the system.
+ *
+ * While the clients list is tracked from the system announcements (see
+ * getAvailableInputs()) the port is found in the cached list by its
+ * address, including its subscribers. Otherwise, or when the port is not
+ * in the list, the sequencer is queried.
+ * @param client An existing client number
+ * @param port An existing port number
+ * @return The PortInfo object
+ */
+PortInfo
+MidiClient::getPortInfo(int client, int port)
+{
+    {
+        QReadLocker locker(&d->m_TopologyLock);
+        if (!d->m_NeedRefreshClientList && d->isTracking()) {
+            const int i = d->m_ClientIndex.value(client, -1);
+            const int j = d->m_PortIndex.value(portKey(client, port), -1);
+            if ((i >= 0) && (j >= 0))
+                return d->m_ClientList.at(i).getPorts().at(j);
+        }
+    }
+    PortInfo info(this, client, port);
+    info.setClientName(getClientName(client));
+    return info;
+}
+
 /**
  * Adds a QObject to the listeners list. This object should override the method
  * QObject::customEvent() to receive SequencerEvent instances.
@@ -1670,7 +2264,6 @@ MidiClient::parseAddress( const QString& straddr, snd_seq_addr& addr )
 {
     bool ok(false);
     QString testClient, testPort;
-    ClientInfoList::ConstIterator cit;
     int pos = straddr.indexOf(':');
     if (pos > -1) {
         testClient = straddr.left(pos);
@@ -1683,16 +2276,12 @@ MidiClient::parseAddress( const QString& straddr, snd_seq_addr& addr )
     if (ok)
         addr.port = testPort.toInt(&ok);
     if (!ok) {
-        if (d->m_NeedRefreshClientList)
-            readClients();
-        for ( cit = d->m_ClientList.constBegin();
-              cit != d->m_ClientList.constEnd(); ++cit ) {
-            ClientInfo ci = *cit;
-            if (testClient.compare(ci.getName(), Qt::CaseInsensitive) == 0) {
-                addr.client = ci.getClientId();
-                addr.port = testPort.toInt(&ok);
-                return ok;
-            }
+        checkClientList(false);
+        QReadLocker locker(&d->m_TopologyLock);
+        const int clientId = d->m_ClientNameIndex.value(testClient.toCaseFolded(), -1);
+        if (clientId >= 0) {
+            addr.client = clientId;
+            addr.port = testPort.toInt(&ok);
         }
     }
     return ok;
@@ -1729,8 +2318,8 @@ void
 MidiClient::SequencerInputThread::setRealtimePriority()
 {
     struct sched_param p;
-    int rt, policy = SCHED_RR | SCHED_RESET_ON_FORK;
-    quint32 priority = 6;
+    int rt, policy = m_MidiClient->d->m_RtPolicy | SCHED_RESET_ON_FORK;
+    quint32 priority = m_MidiClient->d->m_RtPriority;
 #if defined(RTKIT_SUPPORT)
     bool ok;
     quint32 max_prio;
@@ -1781,10 +2370,47 @@ MidiClient::SequencerInputThread::setRealtimePriority()
         if (reply.type() == QDBusMessage::ErrorMessage )
             qWarning() << "error returned by RealtimeKit.MakeThreadRealtime:"
                         << reply.errorMessage();
-#endif
-    } else {
+#else
         qWarning() << "pthread_setschedparam() failed, err="
                    << rt << ::strerror(rt);
+#endif
+    }
+}
+
+/**
+ * Pins the input thread to the configured CPU cores.
+ */
+void
+MidiClient::SequencerInputThread::setCpuAffinity()
+{
+    const QList<int> cpus = m_MidiClient->d->m_InputCpus;
+    if (cpus.isEmpty())
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    foreach(int cpu, cpus) {
+        if ((cpu >= 0) && (cpu < CPU_SETSIZE))
+            CPU_SET(cpu, &set);
+    }
+    int rt = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+    if (rt != 0) {
+        qWarning() << "pthread_setaffinity_np() failed, err="
+                   << rt << ::strerror(rt);
+    }
+}
+
+/**
+ * Locks the process memory, and prefaults the input thread stack.
+ */
+void
+MidiClient::SequencerInputThread::lockMemory()
+{
+    if (::mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        qWarning() << "mlockall() failed, err=" << errno << ::strerror(errno);
+    }
+    volatile char stack[PREFAULT_STACK_SIZE];
+    for (int i = 0; i < PREFAULT_STACK_SIZE; i += 4096) {
+        stack[i] = 0;
     }
 }
 
@@ -1798,6 +2424,13 @@ MidiClient::SequencerInputThread::run()
         setRealtimePriority();
     }
     if (m_MidiClient != nullptr) {
+        MidiClientPrivate* d = m_MidiClient->d.data();
+        const bool faultCheck = d->m_FaultCheck;
+        bool faultWarned = false;
+        setCpuAffinity();
+        if (d->m_LockMemory) {
+            lockMemory();
+        }
         int npfd = snd_seq_poll_descriptors_count(m_MidiClient->getHandle(), POLLIN);
         pollfd* pfd = (pollfd *) calloc(npfd, sizeof(pollfd));
         try
@@ -1805,9 +2438,33 @@ MidiClient::SequencerInputThread::run()
             snd_seq_poll_descriptors(m_MidiClient->getHandle(), pfd, npfd, POLLIN);
             while (!stopped() && (m_MidiClient != nullptr))
             {
+                const qint64 before = monotonicTime();
                 int rt = poll(pfd, npfd, m_Wait);
-                if (rt > 0) {
-                    m_MidiClient->doEvents();
+                if (rt == 0) {
+                    // idle wakeup: measure how late the timeout expired
+                    qint64 latency = qMax(Q_INT64_C(0), monotonicTime() - before - m_Wait * Q_INT64_C(1000000));
+                    d->m_Wakeups.fetchAndAddRelaxed(1);
+                    d->m_LatencyTotal.fetchAndAddRelaxed(latency);
+                    if (latency < d->m_LatencyMin.load())
+                        d->m_LatencyMin.store(latency);
+                    if (latency > d->m_LatencyMax.load())
+                        d->m_LatencyMax.store(latency);
+                } else if (rt > 0) {
+                    d->m_Dispatches.fetchAndAddRelaxed(1);
+                    if (faultCheck) {
+                        const quint64 faults = threadPageFaults();
+                        m_MidiClient->doEvents();
+                        const quint64 count = threadPageFaults() - faults;
+                        if (count > 0) {
+                            d->m_PageFaults.fetchAndAddRelaxed(count);
+                            if (!faultWarned) {
+                                qWarning() << "page faults on the MIDI input path:" << count;
+                                faultWarned = true;
+                            }
+                        }
+                    } else {
+                        m_MidiClient->doEvents();
+                    }
                 }
             }
         }
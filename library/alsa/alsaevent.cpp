@@ -1197,6 +1197,140 @@ MidiCodec::encode(int c,
     return DRUMSTICK_ALSA_CHECK_WARNING(snd_midi_event_encode_byte(m_Info, c, ev));
 }
 
+/**
+ * Encode a raw MIDI byte stream into an array of sequencer events.
+ *
+ * The bytes are encoded until the stream is exhausted or the array is full.
+ * A message split at the end of the buffer is kept in the CODEC, and
+ * completed by the next call, as is the running status.
+ *
+ * The data of the variable length events (system exclusive messages, or
+ * chunks of the CODEC buffer size for longer ones) is kept in the CODEC
+ * buffer, which is overwritten by the next one. If sysexData is provided,
+ * the data is appended to it instead, and the events point into it; it is
+ * valid until sysexData is modified. Otherwise, the encoding stops after
+ * each variable length event, to let the caller use it.
+ *
+ * @param buf MIDI byte stream
+ * @param count Bytes of MIDI byte stream to encode
+ * @param events Result - array of sequencer events
+ * @param maxEvents Capacity of the events array
+ * @param consumed Optional result - number of encoded bytes
+ * @param sysexData Optional storage for the variable length event data
+ * @return Number of events written, or a negative error code
+ */
+long
+MidiCodec::encodeEvents(const unsigned char *buf,
+                        long count,
+                        snd_seq_event_t *events,
+                        long maxEvents,
+                        long *consumed,
+                        QByteArray *sysexData)
+{
+    long pos = 0, n = 0;
+    bool variable = false;
+    while (pos < count && n < maxEvents) {
+        snd_seq_event_t *ev = &events[n];
+        long rc = DRUMSTICK_ALSA_CHECK_WARNING(snd_midi_event_encode(m_Info, buf + pos, count - pos, ev));
+        if (rc < 0) {
+            if (n == 0) {
+                return rc;
+            }
+            break;
+        }
+        pos += rc;
+        if (ev->type == SND_SEQ_EVENT_NONE) {
+            continue;
+        }
+        ++n;
+        if (snd_seq_ev_is_variable(ev)) {
+            if (sysexData == nullptr) {
+                break;
+            }
+            // keep the offset until the storage stops growing
+            quintptr offset = sysexData->size();
+            sysexData->append(static_cast<const char *>(ev->data.ext.ptr), ev->data.ext.len);
+            ev->data.ext.ptr = reinterpret_cast<void *>(offset);
+            variable = true;
+        }
+    }
+    if (variable) {
+        char *base = sysexData->data();
+        for (long i = 0; i < n; ++i) {
+            if (snd_seq_ev_is_variable(&events[i])) {
+                events[i].data.ext.ptr = base + reinterpret_cast<quintptr>(events[i].data.ext.ptr);
+            }
+        }
+    }
+    if (consumed != nullptr) {
+        *consumed = pos;
+    }
+    return n;
+}
+
+/*
+ * Largest MIDI encoding of an event, without running status: registered
+ * and non registered parameters are decoded as four controller messages,
+ * and 14 bit controllers as two.
+ */
+static long
+maxDecodedSize(const snd_seq_event_t *ev)
+{
+    if (snd_seq_ev_is_variable(ev)) {
+        return long(ev->data.ext.len);
+    }
+    switch (ev->type) {
+    case SND_SEQ_EVENT_REGPARAM:
+    case SND_SEQ_EVENT_NONREGPARAM:
+        return 12;
+    case SND_SEQ_EVENT_CONTROL14:
+        return 6;
+    default:
+        return 3;
+    }
+}
+
+/**
+ * Decode an array of sequencer events into a raw MIDI byte stream.
+ *
+ * The events are decoded until the array is exhausted or the buffer can't
+ * hold the next event. The running status is applied across the events
+ * when enabled. Events without a MIDI representation are skipped.
+ *
+ * @param buf A buffer to get the results
+ * @param count Available bytes in the buffer
+ * @param events Array of sequencer events
+ * @param numEvents Number of events in the array
+ * @param decoded Optional result - number of processed events
+ * @return The number of written bytes
+ */
+long
+MidiCodec::decodeEvents(unsigned char *buf,
+                        long count,
+                        const snd_seq_event_t *events,
+                        long numEvents,
+                        long *decoded)
+{
+    long pos = 0, i = 0;
+    for (; i < numEvents; ++i) {
+        const snd_seq_event_t *ev = &events[i];
+        // check the room first: a failed decode may leave the running status changed
+        if (count - pos < maxDecodedSize(ev)) {
+            break;
+        }
+        long rc = snd_midi_event_decode(m_Info, buf + pos, count - pos, ev);
+        if (rc > 0) {
+            pos += rc;
+        } else if (rc == -ENOMEM) {
+            break;
+        }
+    }
+    if (decoded != nullptr) {
+        *decoded = i;
+    }
+    return pos;
+}
+
 /**
  * Enable MIDI running status (command merge)
  * @param enable True to enable, false to disable.
@@ -19,6 +19,7 @@
 #include "errorcheck.h"
 #include <drumstick/alsaclient.h>
 #include <drumstick/alsaqueue.h>
+#include <QSet>
 
 /**
  * @file alsaport.cpp
@@ -1165,9 +1166,8 @@ MidiPort::getReadSubscribers()
         int client = s.getAddr()->client;
         if ((client != SND_SEQ_CLIENT_SYSTEM) && (client != m_Info.getClient())) {
             int port = s.getAddr()->port;
-            PortInfo p(m_MidiClient, client, port);
+            PortInfo p = m_MidiClient->getPortInfo(client, port);
             if ((p.getCapability() & SND_SEQ_PORT_CAP_NO_EXPORT) == 0) {
-            	p.setClientName(m_MidiClient->getClientName(client));
                 lst << p;
             }
         }
@@ -1190,9 +1190,8 @@ MidiPort::getWriteSubscribers()
         int client = s.getAddr()->client;
         if ((client != SND_SEQ_CLIENT_SYSTEM) && (client != m_Info.getClient())) {
             int port = s.getAddr()->port;
-            PortInfo p(m_MidiClient, client, port);
+            PortInfo p = m_MidiClient->getPortInfo(client, port);
             if ((p.getCapability() & SND_SEQ_PORT_CAP_NO_EXPORT) == 0) {
-            	p.setClientName(m_MidiClient->getClientName(client));
                 lst << p;
             }
         }
@@ -1220,50 +1219,129 @@ MidiPort::containsAddress(const snd_seq_addr_t* addr, const PortInfoList& lst)
     return false;
 }
 
+/*
+ * Key of an ALSA address, for the subscription sets.
+ */
+static inline int
+addressKey(const snd_seq_addr_t* addr)
+{
+    return (addr->client << 8) | addr->port;
+}
+
+/*
+ * Subscription sets of a list of ports.
+ */
+static QSet<int>
+addressKeys(const PortInfoList& lst)
+{
+    QSet<int> keys;
+    keys.reserve(lst.count());
+    for (PortInfo p : lst) {
+        keys.insert(addressKey(p.getAddr()));
+    }
+    return keys;
+}
+
 /**
  * Update the write subscriptions
+ *
+ * The current and the desired connections are compared as sets, and then
+ * the missing subscriptions are made and the surplus ones are broken in a
+ * single pass. The subscribers list is read again once, at the end.
  * @param ports List of writable ports to be subscribed
  */
 void
 MidiPort::updateConnectionsTo(const PortInfoList& ports)
 {
-    PortInfoList subs(getReadSubscribers());
-    PortInfoList::ConstIterator i;
-    for (i = subs.constBegin(); i != subs.constEnd(); ++i) {
-        PortInfo s = *i;
-        if (!containsAddress(s.getAddr(), ports)) {
-            unsubscribeTo(s.getAddr());
+    if ((m_MidiClient == nullptr) || (m_MidiClient->getHandle() == nullptr)) {
+        return;
+    }
+    const PortInfoList subs(getReadSubscribers());
+    const QSet<int> current = addressKeys(subs);
+    const QSet<int> desired = addressKeys(ports);
+    QSet<int> removed;
+    for (PortInfo s : subs) {
+        const int key = addressKey(s.getAddr());
+        if (!desired.contains(key)) {
+            Subscription subscription;
+            subscription.setSender(m_Info.getAddr());
+            subscription.setDest(s.getAddr());
+            subscription.unsubscribe(m_MidiClient);
+            removed.insert(key);
         }
     }
-    for (i = ports.constBegin(); i != ports.constEnd(); ++i) {
-        PortInfo p = *i;
-        if (!containsAddress(p.getAddr(), subs)) {
+    if (!removed.isEmpty()) {
+        const int sender = addressKey(m_Info.getAddr());
+        SubscriptionsList kept;
+        SubscriptionsList::ConstIterator it;
+        for (it = m_Subscriptions.constBegin(); it != m_Subscriptions.constEnd(); ++it) {
+            Subscription subscription = *it;
+            if ((addressKey(subscription.getSender()) != sender) ||
+                !removed.contains(addressKey(subscription.getDest()))) {
+                kept.append(subscription);
+            }
+        }
+        m_Subscriptions = kept;
+    }
+    QSet<int> added;
+    for (PortInfo p : ports) {
+        const int key = addressKey(p.getAddr());
+        if (!current.contains(key) && !added.contains(key)) {
             subscribeTo(&p);
+            added.insert(key);
         }
     }
+    updateSubscribers();
 }
 
 /**
  * Update the read susbcriptions
+ *
+ * See updateConnectionsTo() about how the subscriptions are compared.
  * @param ports List of readable ports to be subscribed
  */
 void
 MidiPort::updateConnectionsFrom(const PortInfoList& ports)
 {
-    PortInfoList subs(getWriteSubscribers());
-    PortInfoList::ConstIterator i;
-    for (i = subs.constBegin(); i != subs.constEnd(); ++i) {
-        PortInfo s = *i;
-        if (!containsAddress(s.getAddr(), ports)) {
-            unsubscribeFrom(s.getAddr());
+    if ((m_MidiClient == nullptr) || (m_MidiClient->getHandle() == nullptr)) {
+        return;
+    }
+    const PortInfoList subs(getWriteSubscribers());
+    const QSet<int> current = addressKeys(subs);
+    const QSet<int> desired = addressKeys(ports);
+    QSet<int> removed;
+    for (PortInfo s : subs) {
+        const int key = addressKey(s.getAddr());
+        if (!desired.contains(key)) {
+            Subscription subscription;
+            subscription.setSender(s.getAddr());
+            subscription.setDest(m_Info.getAddr());
+            subscription.unsubscribe(m_MidiClient);
+            removed.insert(key);
         }
     }
-    for (i = ports.constBegin(); i != ports.constEnd(); ++i) {
-        PortInfo p = *i;
-        if (!containsAddress(p.getAddr(), subs)) {
+    if (!removed.isEmpty()) {
+        const int dest = addressKey(m_Info.getAddr());
+        SubscriptionsList kept;
+        SubscriptionsList::ConstIterator it;
+        for (it = m_Subscriptions.constBegin(); it != m_Subscriptions.constEnd(); ++it) {
+            Subscription subscription = *it;
+            if ((addressKey(subscription.getDest()) != dest) ||
+                !removed.contains(addressKey(subscription.getSender()))) {
+                kept.append(subscription);
+            }
+        }
+        m_Subscriptions = kept;
+    }
+    QSet<int> added;
+    for (PortInfo p : ports) {
+        const int key = addressKey(p.getAddr());
+        if (!current.contains(key) && !added.contains(key)) {
             subscribeFrom(&p);
+            added.insert(key);
         }
     }
+    updateSubscribers();
 }
 
 } // namespace ALSA
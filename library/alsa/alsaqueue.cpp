@@ -804,6 +804,37 @@ QueueTimer& MidiQueue::getTimer()
     return m_Timer;
 }
 
+/**
+ * Reads the queue position and tempo into a QueuePosition structure.
+ *
+ * Unlike getStatus() and getTempo(), this function uses temporary ALSA
+ * containers on the stack, so it does not allocate memory and can be
+ * called many times per second.
+ * @param pos A QueuePosition structure to be filled
+ * @return true if the queue status and tempo were read
+ */
+bool MidiQueue::getPosition(QueuePosition& pos)
+{
+    snd_seq_queue_status_t* status;
+    snd_seq_queue_tempo_t* tempo;
+    snd_seq_queue_status_alloca(&status);
+    snd_seq_queue_tempo_alloca(&tempo);
+    if ((DRUMSTICK_ALSA_CHECK_WARNING(snd_seq_get_queue_status(m_MidiClient->getHandle(), m_Id, status)) < 0) ||
+        (DRUMSTICK_ALSA_CHECK_WARNING(snd_seq_get_queue_tempo(m_MidiClient->getHandle(), m_Id, tempo)) < 0)) {
+        return false;
+    }
+    pos.tick = snd_seq_queue_status_get_tick_time(status);
+    pos.time = *snd_seq_queue_status_get_real_time(status);
+    pos.running = (snd_seq_queue_status_get_status(status) != 0);
+    pos.tempo = snd_seq_queue_tempo_get_tempo(tempo);
+    pos.ppq = snd_seq_queue_tempo_get_ppq(tempo);
+    pos.skewValue = snd_seq_queue_tempo_get_skew(tempo);
+    pos.skewBase = snd_seq_queue_tempo_get_skew_base(tempo);
+    pos.realBPM = ((pos.tempo == 0) || (pos.skewBase == 0)) ? 0.0f :
+                  6.0e7f / pos.tempo * pos.skewValue / pos.skewBase;
+    return true;
+}
+
 /**
  * Applies a QueueInfo object to the queue
  * @param value A QueueInfo object reference
@@ -834,6 +865,25 @@ void MidiQueue::setTimer(const QueueTimer& value)
     DRUMSTICK_ALSA_CHECK_WARNING(snd_seq_set_queue_timer(m_MidiClient->getHandle(), m_Id, m_Timer.m_Info));
 }
 
+/**
+ * Applies the best available timer to the queue.
+ *
+ * By default the timer is chosen by Timer::bestGlobalTimerId(), from the
+ * nominal resolution of the global timers. With measured, all the timers
+ * are briefly run at the given frequency and the one with the lowest jitter
+ * is used, see Timer::benchmarkTimers(). This takes a fraction of a second
+ * per timer.
+ * @param measured Choose the timer by measuring it
+ * @param frequency Timer frequency used for measuring, in Hz
+ */
+void MidiQueue::setBestTimer(bool measured, int frequency)
+{
+    QueueTimer qtimer;
+    qtimer.setId(measured ? Timer::bestMeasuredTimerId(frequency) :
+                            Timer::bestGlobalTimerId());
+    setTimer(qtimer);
+}
+
 /**
  * Gets the queue usage flag.
  *
@@ -922,6 +972,108 @@ void MidiQueue::setRealTimePosition(snd_seq_real_time_t* pos)
     m_MidiClient->outputDirect(&event);
 }
 
+/**
+ * Constructor
+ * @param queue The MidiQueue to be followed
+ */
+QueueClock::QueueClock(MidiQueue* queue) :
+    m_Queue(queue),
+    m_Last(),
+    m_ResyncInterval(1000),
+    m_Valid(false)
+{ }
+
+/**
+ * Sets the MidiQueue to be followed
+ * @param queue A MidiQueue object pointer
+ */
+void QueueClock::setQueue(MidiQueue* queue)
+{
+    m_Queue = queue;
+    m_Valid = false;
+}
+
+/**
+ * Gets the MidiQueue being followed
+ * @return A MidiQueue object pointer
+ */
+MidiQueue* QueueClock::getQueue() const
+{
+    return m_Queue;
+}
+
+/**
+ * Sets the maximum time between two readings of the queue position.
+ * @param msecs Interval in milliseconds. Zero reads the position every time.
+ */
+void QueueClock::setResyncInterval(int msecs)
+{
+    m_ResyncInterval = qMax(0, msecs);
+}
+
+/**
+ * Gets the maximum time between two readings of the queue position.
+ * @return Interval in milliseconds.
+ */
+int QueueClock::getResyncInterval() const
+{
+    return m_ResyncInterval;
+}
+
+/**
+ * Reads the queue position from the sequencer, starting a new
+ * extrapolation period.
+ * @return true if the position was read
+ */
+bool QueueClock::sync()
+{
+    if (m_Queue == nullptr) {
+        return false;
+    }
+    m_Valid = m_Queue->getPosition(m_Last);
+    m_Timer.start();
+    return m_Valid;
+}
+
+/**
+ * Forces a reading of the queue position on the next getPosition() call.
+ * This should be called after starting, stopping or relocating the queue,
+ * or after changing the tempo.
+ */
+void QueueClock::invalidate()
+{
+    m_Valid = false;
+}
+
+/**
+ * Gets the current queue position.
+ *
+ * The position is read from the sequencer if there is no previous reading
+ * or the resync interval has elapsed. Otherwise, when the queue is running,
+ * the time elapsed since the last reading is added to the clock time, and
+ * converted to ticks using the tempo and the skew factor.
+ * @return The extrapolated queue position
+ */
+QueuePosition QueueClock::getPosition()
+{
+    if (!m_Valid || m_Timer.hasExpired(m_ResyncInterval)) {
+        sync();
+    }
+    QueuePosition pos = m_Last;
+    if (m_Valid && m_Last.running) {
+        const qint64 elapsed = m_Timer.nsecsElapsed();
+        const qint64 nsecs = m_Last.time.tv_nsec + elapsed;
+        pos.time.tv_sec = m_Last.time.tv_sec + nsecs / 1000000000;
+        pos.time.tv_nsec = nsecs % 1000000000;
+        if ((m_Last.tempo > 0) && (m_Last.skewBase > 0)) {
+            double ticks = elapsed / (m_Last.tempo * 1000.0) * m_Last.ppq
+                           * m_Last.skewValue / m_Last.skewBase;
+            pos.tick = m_Last.tick + static_cast<snd_seq_tick_time_t>(ticks);
+        }
+    }
+    return pos;
+}
+
 } // namespace ALSA
 } // namespace drumstick
 
@@ -17,10 +17,16 @@
 */
 
 #include "errorcheck.h"
+#include <QAtomicInteger>
+#include <QGlobalStatic>
+#include <QMutex>
 #include <QReadLocker>
 #include <QWriteLocker>
 #include <cmath>
+#include <algorithm>
 #include <cstdio>
+#include <limits>
+#include <time.h>
 #include <drumstick/alsatimer.h>
 /**
  * @file alsatimer.cpp
@@ -1029,6 +1035,154 @@ TimerStatus::getSizeOfInfo() const
     return snd_timer_status_sizeof();
 }
 
+/**
+ * Timer statistics counters.
+ *
+ * The counters are updated by the timer input thread only, and may be read
+ * from any thread without locking. A snapshot taken while the timer is
+ * running may mix values of two consecutive periods.
+ */
+class TimerStatisticsData
+{
+public:
+    TimerStatisticsData() :
+        ticks(1),
+        resolution(0)
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        primed.store(0);
+        periods.store(0);
+        overruns.store(0);
+        total.store(0);
+        expected.store(0);
+        minPeriod.store(std::numeric_limits<qint64>::max());
+        maxPeriod.store(0);
+        totalJitter.store(0);
+        maxJitter.store(0);
+        for (int i = 0; i < TIMER_JITTER_BINS; ++i) {
+            histogram[i].store(0);
+        }
+    }
+
+    void record(qint64 period, long elapsedTicks)
+    {
+        const long nominalTicks = qMax(1L, ticks.load());
+        const qint64 expectedPeriod = qint64(elapsedTicks) * resolution.load();
+        const qint64 jitter = qAbs(period - expectedPeriod);
+        if (elapsedTicks > nominalTicks) {
+            overruns.fetchAndAddRelaxed(elapsedTicks / nominalTicks - 1);
+        }
+        periods.fetchAndAddRelaxed(1);
+        total.fetchAndAddRelaxed(period);
+        expected.fetchAndAddRelaxed(expectedPeriod);
+        totalJitter.fetchAndAddRelaxed(jitter);
+        if (period < minPeriod.load())
+            minPeriod.store(period);
+        if (period > maxPeriod.load())
+            maxPeriod.store(period);
+        if (jitter > maxJitter.load())
+            maxJitter.store(jitter);
+        int bin = 0;
+        for (qint64 usecs = jitter / 1000; (usecs > 0) && (bin < TIMER_JITTER_BINS - 1); usecs >>= 1) {
+            ++bin;
+        }
+        histogram[bin].fetchAndAddRelaxed(1);
+    }
+
+    QAtomicInteger<long> ticks;
+    QAtomicInteger<qint64> resolution;
+    QAtomicInt primed;
+    QAtomicInteger<quint64> periods;
+    QAtomicInteger<quint64> overruns;
+    QAtomicInteger<qint64> total;
+    QAtomicInteger<qint64> expected;
+    QAtomicInteger<qint64> minPeriod;
+    QAtomicInteger<qint64> maxPeriod;
+    QAtomicInteger<qint64> totalJitter;
+    QAtomicInteger<qint64> maxJitter;
+    QAtomicInteger<quint64> histogram[TIMER_JITTER_BINS];
+};
+
+/*
+ * The statistics counters of every Timer instance, kept in a side table
+ * out of the exported Timer class, so its layout does not change. An entry
+ * is claimed by the constructors and released by the destructor. The
+ * entries are linked in a list that only grows, and a released entry is
+ * reused by a later Timer, so the lookups walk the list without locking.
+ */
+struct TimerStatisticsEntry
+{
+    QAtomicPointer<const Timer> timer;
+    TimerStatisticsData data;
+    TimerStatisticsEntry *next;
+};
+
+struct TimerStatisticsTable
+{
+    ~TimerStatisticsTable()
+    {
+        TimerStatisticsEntry *entry = head.load();
+        while (entry != nullptr) {
+            TimerStatisticsEntry *next = entry->next;
+            delete entry;
+            entry = next;
+        }
+    }
+
+    QMutex mutex;
+    QAtomicPointer<TimerStatisticsEntry> head;
+};
+
+Q_GLOBAL_STATIC(TimerStatisticsTable, timerStatisticsTable)
+
+static void
+addTimerStatistics(const Timer* timer)
+{
+    QMutexLocker locker(&timerStatisticsTable->mutex);
+    TimerStatisticsEntry *entry = timerStatisticsTable->head.load();
+    for (; entry != nullptr; entry = entry->next) {
+        if (entry->timer.load() == nullptr) {
+            entry->data.ticks.store(1);
+            entry->data.resolution.store(0);
+            entry->data.reset();
+            entry->timer.storeRelease(timer);
+            return;
+        }
+    }
+    entry = new TimerStatisticsEntry;
+    entry->timer.store(timer);
+    entry->next = timerStatisticsTable->head.load();
+    timerStatisticsTable->head.storeRelease(entry);
+}
+
+static void
+removeTimerStatistics(const Timer* timer)
+{
+    QMutexLocker locker(&timerStatisticsTable->mutex);
+    TimerStatisticsEntry *entry = timerStatisticsTable->head.load();
+    for (; entry != nullptr; entry = entry->next) {
+        if (entry->timer.load() == timer) {
+            entry->timer.storeRelease(nullptr);
+            return;
+        }
+    }
+}
+
+static TimerStatisticsData*
+timerStatistics(const Timer* timer)
+{
+    TimerStatisticsEntry *entry = timerStatisticsTable->head.loadAcquire();
+    for (; entry != nullptr; entry = entry->next) {
+        if (entry->timer.loadAcquire() == timer)
+            return &entry->data;
+    }
+    return nullptr;
+}
+
 /**
  * Constructor.
  * Open flags can be a combination of the following constants:
@@ -1049,6 +1203,7 @@ Timer::Timer( const QString& deviceName, int openMode, QObject* parent )
 {
     DRUMSTICK_ALSA_CHECK_ERROR( snd_timer_open( &m_Info, m_deviceName.toLocal8Bit().data(),
                                  openMode ));
+    addTimerStatistics(this);
 }
 
 /**
@@ -1074,6 +1229,7 @@ Timer::Timer( const QString& deviceName, int openMode, snd_config_t* conf,
     DRUMSTICK_ALSA_CHECK_ERROR( snd_timer_open_lconf( &m_Info,
                                        m_deviceName.toLocal8Bit().data(),
                                        openMode, conf ));
+    addTimerStatistics(this);
 }
 
 /**
@@ -1102,6 +1258,7 @@ Timer::Timer( TimerId& id, int openMode, QObject* parent )
     DRUMSTICK_ALSA_CHECK_ERROR( snd_timer_open( &m_Info,
                                  m_deviceName.toLocal8Bit().data(),
                                  openMode ));
+    addTimerStatistics(this);
 }
 
 /**
@@ -1135,6 +1292,7 @@ Timer::Timer( int cls, int scls, int card, int dev, int sdev,
     DRUMSTICK_ALSA_CHECK_ERROR( snd_timer_open( &m_Info,
                                  m_deviceName.toLocal8Bit().data(),
                                  openMode ));
+    addTimerStatistics(this);
 }
 
 /**
@@ -1146,6 +1304,7 @@ Timer::~Timer()
     if (m_thread != nullptr)
         delete m_thread;
     DRUMSTICK_ALSA_CHECK_WARNING(snd_timer_close(m_Info));
+    removeTimerStatistics(this);
 }
 
 /**
@@ -1221,6 +1380,7 @@ void
 Timer::setTimerParams(const TimerParams& params)
 {
     DRUMSTICK_ALSA_CHECK_WARNING( snd_timer_params(m_Info, params.m_Info) );
+    timerStatistics(this)->ticks.store(snd_timer_params_get_ticks(params.m_Info));
 }
 
 /**
@@ -1285,10 +1445,19 @@ void
 Timer::doEvents()
 {
     snd_timer_tread_t tr;
+    TimerStatisticsData *stats = timerStatistics(this);
     while ( read(&tr, sizeof(tr)) == sizeof(tr) ) {
-        int msecs = ((tr.tstamp.tv_sec - m_last_time.tv_sec) * 1000) +
-                    round((tr.tstamp.tv_nsec - m_last_time.tv_nsec) / 1000000.0);
+        qint64 nsecs = (qint64(tr.tstamp.tv_sec - m_last_time.tv_sec) * 1000000000) +
+                       (tr.tstamp.tv_nsec - m_last_time.tv_nsec);
+        int msecs = round(nsecs / 1000000.0);
         m_last_time = tr.tstamp;
+        if (tr.event == SND_TIMER_EVENT_TICK) {
+            // the first period may start before the timer
+            if (stats->primed.load() != 0)
+                stats->record(nsecs, tr.val);
+            else
+                stats->primed.store(1);
+        }
         if ( m_handler != nullptr )
             m_handler->handleTimerEvent(tr.val, msecs);
         else
@@ -1301,7 +1470,10 @@ Timer::doEvents()
  */
 void Timer::startEvents()
 {
+    TimerStatisticsData *stats = timerStatistics(this);
     m_last_time = getTimerStatus().getTimestamp();
+    stats->resolution.store(getTimerInfo().getResolution());
+    stats->primed.store(0);
     if (m_thread == nullptr) {
         m_thread = new TimerInputThread(this, 500);
         m_thread->start();
@@ -1326,6 +1498,49 @@ void Timer::stopEvents()
     }
 }
 
+/**
+ * Gets a snapshot of the timer statistics, measured by the events
+ * dispatching thread since startEvents() or resetStatistics().
+ * This function does not lock, and may be called from any thread.
+ * @return The timer statistics
+ */
+TimerStatistics
+Timer::getStatistics() const
+{
+    const TimerStatisticsData *stats = timerStatistics(this);
+    TimerStatistics st;
+    st.periods = stats->periods.load();
+    st.overruns = stats->overruns.load();
+    st.nominalPeriod = stats->resolution.load() * qMax(1L, stats->ticks.load());
+    st.meanPeriod = 0;
+    st.minPeriod = 0;
+    st.maxPeriod = stats->maxPeriod.load();
+    st.meanJitter = 0;
+    st.maxJitter = stats->maxJitter.load();
+    st.drift = 0.0;
+    if (st.periods > 0) {
+        const qint64 expected = stats->expected.load();
+        st.meanPeriod = stats->total.load() / qint64(st.periods);
+        st.minPeriod = stats->minPeriod.load();
+        st.meanJitter = stats->totalJitter.load() / qint64(st.periods);
+        if (expected > 0)
+            st.drift = (stats->total.load() - expected) * 1.0e6 / expected;
+    }
+    for (int i = 0; i < TIMER_JITTER_BINS; ++i) {
+        st.histogram[i] = stats->histogram[i].load();
+    }
+    return st;
+}
+
+/**
+ * Clears the timer statistics.
+ */
+void
+Timer::resetStatistics()
+{
+    timerStatistics(this)->reset();
+}
+
 /**
  * Check and return the best available global TimerId in the system, meaning
  * the timer with higher frequency (or lesser period, resolution).
@@ -1402,6 +1617,146 @@ Timer::bestGlobalTimer(int openMode, QObject* parent)
     return new Timer(id, openMode, parent);
 }
 
+/*
+ * Process CPU time, in nanoseconds.
+ */
+static qint64 processCpuTime()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) < 0)
+        return 0;
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Maximum deviation of the nominal and mean periods from the requested
+ * period for a timer to be considered reachable.
+ */
+static const double PERIOD_TOLERANCE = 0.1;
+
+static bool closeToPeriod(qint64 period, qint64 requested)
+{
+    return qAbs(period - requested) <= requested * PERIOD_TOLERANCE;
+}
+
+/*
+ * Jitter in percent of the measured mean period.
+ */
+static double relativeToPeriod(qint64 jitter, qint64 period)
+{
+    return (period > 0) ? jitter * 100.0 / period : 0.0;
+}
+
+/*
+ * Ranking of the benchmark results: timers without measured periods go
+ * last, after the timers that can't get close to the requested period,
+ * then the lowest overruns, mean and maximum jitter relative to the
+ * period, and CPU load.
+ */
+static bool betterTimer(const TimerBenchmarkResult& a, const TimerBenchmarkResult& b)
+{
+    if ((a.stats.periods == 0) != (b.stats.periods == 0))
+        return a.stats.periods != 0;
+    if (a.reachable != b.reachable)
+        return a.reachable;
+    if (a.stats.overruns != b.stats.overruns)
+        return a.stats.overruns < b.stats.overruns;
+    if (a.relativeJitter != b.relativeJitter)
+        return a.relativeJitter < b.relativeJitter;
+    const double aMax = relativeToPeriod(a.stats.maxJitter, a.meanPeriod);
+    const double bMax = relativeToPeriod(b.stats.maxJitter, b.meanPeriod);
+    if (aMax != bMax)
+        return aMax < bMax;
+    return a.cpuLoad < b.cpuLoad;
+}
+
+/**
+ * Measures the available timers, and returns them ranked by quality.
+ *
+ * Each non slave timer found by TimerQuery is opened in turn and run at
+ * the requested frequency during the given time, collecting its
+ * statistics and the CPU time used by the process meanwhile. The timers
+ * that can't be opened are skipped, and the timers that did not tick
+ * (like the PCM timers of stopped devices) are ranked last. Before them
+ * go the timers not reachable: the ones whose nominal period (limited by
+ * the resolution) or measured mean period deviate more than 10% from the
+ * requested period. Within each group the timers are ranked by overruns,
+ * mean jitter and maximum jitter relative to the mean period, and CPU load.
+ *
+ * This function blocks the calling thread for about the number of timers
+ * times the duration.
+ * @param frequency Requested timer frequency in Hz
+ * @param duration Measuring time of each timer, in milliseconds
+ * @return The ranked list of results, the best one first
+ */
+TimerBenchmarkList
+Timer::benchmarkTimers(int frequency, int duration)
+{
+    TimerBenchmarkList results;
+    TimerQuery query("hw", 0);
+    TimerIdList lst = query.getTimers();
+    const qint64 requested = 1000000000LL / qMax(1, frequency);
+    TimerIdList::Iterator it;
+    for (it = lst.begin(); it != lst.end(); ++it) {
+        Timer* timer = nullptr;
+        try {
+            timer = new Timer(*it, SND_TIMER_OPEN_NONBLOCK | SND_TIMER_OPEN_TREAD);
+        } catch (const SequencerError&) {
+            continue;
+        }
+        TimerInfo info = timer->getTimerInfo();
+        if (info.isSlave() || (info.getResolution() <= 0)) {
+            delete timer;
+            continue;
+        }
+        TimerParams params;
+        long ticks = 1000000000L / info.getResolution() / qMax(1, frequency);
+        params.setAutoStart(true);
+        params.setTicks(qMax(1L, ticks));
+        params.setFilter(1 << SND_TIMER_EVENT_TICK);
+        timer->setTimerParams(params);
+        timer->start();
+        timer->startEvents();
+        const qint64 cpuStart = processCpuTime();
+        QThread::msleep(qMax(1, duration));
+        const qint64 cpuTime = processCpuTime() - cpuStart;
+        timer->stopEvents();
+        timer->stop();
+        TimerBenchmarkResult result;
+        result.id = *it;
+        result.name = info.getName();
+        result.stats = timer->getStatistics();
+        result.cpuLoad = cpuTime / (qMax(1, duration) * 1.0e4);
+        result.requestedPeriod = requested;
+        result.nominalPeriod = result.stats.nominalPeriod;
+        result.meanPeriod = result.stats.meanPeriod;
+        result.reachable = (result.stats.periods > 0) &&
+                           closeToPeriod(result.nominalPeriod, requested) &&
+                           closeToPeriod(result.meanPeriod, requested);
+        result.relativeJitter = relativeToPeriod(result.stats.meanJitter, result.meanPeriod);
+        results.append(result);
+        delete timer;
+    }
+    std::stable_sort(results.begin(), results.end(), betterTimer);
+    return results;
+}
+
+/**
+ * Measures the available timers, and returns the best one.
+ * See benchmarkTimers() for the ranking criteria.
+ * @param frequency Requested timer frequency in Hz
+ * @param duration Measuring time of each timer, in milliseconds
+ * @return The best measured TimerId, or bestGlobalTimerId() if none ticked
+ */
+TimerId
+Timer::bestMeasuredTimerId(int frequency, int duration)
+{
+    TimerBenchmarkList results = benchmarkTimers(frequency, duration);
+    if (results.isEmpty() || (results.first().stats.periods == 0))
+        return bestGlobalTimerId();
+    return results.first().id;
+}
+
 /**
  * Loop reading and dispatching timer events.
  */
@@ -45,6 +45,7 @@
 #include <drumstick/rtmidiinput.h>
 #include <drumstick/rtmidioutput.h>
 #include <drumstick/backendmanager.h>
+#include <drumstick/midithrurouter.h>
 
 // Widgets
 #include <drumstick/pianokeybd.h>
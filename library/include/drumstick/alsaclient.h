@@ -200,6 +200,31 @@ public:
     virtual void handleSequencerEvent(SequencerEvent* ev) = 0;
 };
 
+/**
+ * Input thread statistics.
+ *
+ * Measurements of the MidiClient input thread. The wakeup latency is the
+ * delay of the thread waking up after its poll timeout expired while idle,
+ * which shows the scheduling latency of the thread under its policy. The
+ * dispatch latency is the delay from the arrival of an event to its
+ * dispatching, measured on the first event of each dispatching round that
+ * carries a real-time stamp of a queue, like the events received by a port
+ * with timestamping enabled. All times are given in nanoseconds.
+ */
+struct InputThreadStatistics
+{
+    quint64 wakeups;        ///< Number of measured idle wakeups
+    qint64 minLatency;      ///< Shortest wakeup latency
+    qint64 meanLatency;     ///< Average wakeup latency
+    qint64 maxLatency;      ///< Longest wakeup latency
+    quint64 dispatches;     ///< Number of event dispatching rounds
+    quint64 pageFaults;     ///< Page faults while dispatching, when checked
+    quint64 stampedEvents;  ///< Number of measured dispatch latencies
+    qint64 minDispatchLatency;  ///< Shortest event dispatch latency
+    qint64 meanDispatchLatency; ///< Average event dispatch latency
+    qint64 maxDispatchLatency;  ///< Longest event dispatch latency
+};
+
 /**
  * Client management.
  *
@@ -266,8 +291,10 @@ public:
     ClientInfoList getAvailableClients();
     PortInfoList getAvailableInputs();
     PortInfoList getAvailableOutputs();
+    PortInfo getPortInfo(int client, int port);
     SystemInfo& getSystemInfo();
     QList<int> getAvailableQueues();
+    quint64 getTopologyVersion();
 
     PoolInfo& getPoolInfo();
     void setPoolInfo(const PoolInfo& info);
@@ -294,6 +321,18 @@ public:
     bool parseAddress( const QString& straddr, snd_seq_addr& result );
     void setRealTimeInput(bool enabled);
     bool realTimeInputEnabled();
+    void setRealTimePolicy(int policy, int priority);
+    int getRealTimePolicy();
+    int getRealTimePriority();
+    void setInputCpuAffinity(const QList<int>& cpus);
+    QList<int> getInputCpuAffinity();
+    void setInputMemoryLocked(bool enabled);
+    bool isInputMemoryLocked();
+    void setInputFaultCheck(bool enabled);
+    bool getInputFaultCheck();
+    void setInputTimeout(int msecs);
+    int getInputTimeout();
+    InputThreadStatistics getInputStatistics();
 
 signals:
     /** Signal emitted when an event is received
@@ -305,6 +344,8 @@ protected:
     void doEvents();
     void applyClientInfo();
     void readClients();
+    void readClient(int clientId);
+    void checkClientList(bool force);
     void freeClients();
     void updateAvailablePorts();
     PortInfoList filterPorts(unsigned int filter);
@@ -810,6 +810,17 @@ public:
                 snd_seq_event_t *ev);
     long encode(int c,
                 snd_seq_event_t *ev);
+    long encodeEvents(const unsigned char *buf,
+                      long count,
+                      snd_seq_event_t *events,
+                      long maxEvents,
+                      long *consumed = nullptr,
+                      QByteArray *sysexData = nullptr);
+    long decodeEvents(unsigned char *buf,
+                      long count,
+                      const snd_seq_event_t *events,
+                      long numEvents,
+                      long *decoded = nullptr);
     void enableRunningStatus(bool enable);
     void resetEncoder();
     void resetDecoder();
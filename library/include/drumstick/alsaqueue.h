@@ -20,6 +20,7 @@
 #define DRUMSTICK_ALSAQUEUE_H
 
 #include <QObject>
+#include <QElapsedTimer>
 
 extern "C" {
     #include <alsa/asoundlib.h>
@@ -182,6 +183,25 @@ private:
     snd_seq_queue_timer_t* m_Info;
 };
 
+/**
+ * Queue position snapshot.
+ *
+ * Plain data structure holding the musical and clock times of a queue,
+ * along with the tempo in effect, as read by MidiQueue::getPosition()
+ * without allocating any wrapper object, or as extrapolated by QueueClock.
+ */
+struct QueuePosition
+{
+    snd_seq_tick_time_t tick;   ///< Musical time, in ticks
+    snd_seq_real_time_t time;   ///< Clock time
+    unsigned int tempo;         ///< Nominal tempo, in microseconds per quarter note
+    int ppq;                    ///< Resolution, in ticks per quarter note
+    unsigned int skewValue;     ///< Tempo skew value
+    unsigned int skewBase;      ///< Tempo skew base
+    float realBPM;              ///< Effective tempo in BPM, including the skew
+    bool running;               ///< The queue is running
+};
+
 /**
  * Queue management.
  *
@@ -208,10 +228,12 @@ public:
     QueueStatus& getStatus();
     QueueTempo& getTempo();
     QueueTimer& getTimer();
+    bool getPosition(QueuePosition& pos);
     int getUsage();
     void setInfo(const QueueInfo& value);
     void setTempo(const QueueTempo& value);
     void setTimer(const QueueTimer& value);
+    void setBestTimer(bool measured = false, int frequency = 1000);
     void setUsage(int used);
 
 private:
@@ -224,6 +246,36 @@ private:
     QueueStatus m_Status;
 };
 
+/**
+ * Extrapolating queue clock.
+ *
+ * This class reads the queue position from the sequencer at most once
+ * every resync interval, and in between it extrapolates the position from
+ * the last reading using the elapsed time and the tempo. It is meant for
+ * animating playheads and time displays from GUI timers without querying
+ * the kernel on every frame. The position is read again when the tempo
+ * or the queue state may have changed, by calling sync().
+ */
+class DRUMSTICK_EXPORT QueueClock
+{
+public:
+    explicit QueueClock(MidiQueue* queue = nullptr);
+    void setQueue(MidiQueue* queue);
+    MidiQueue* getQueue() const;
+    void setResyncInterval(int msecs);
+    int getResyncInterval() const;
+    bool sync();
+    void invalidate();
+    QueuePosition getPosition();
+
+private:
+    MidiQueue* m_Queue;
+    QueuePosition m_Last;
+    QElapsedTimer m_Timer;
+    int m_ResyncInterval;
+    bool m_Valid;
+};
+
 /** @} */
 
 }} /* namespace drumstick::ALSA */
@@ -265,6 +265,61 @@ public:
     virtual void handleTimerEvent(int ticks, int msecs) = 0;
 };
 
+/**
+ * Number of bins of the TimerStatistics jitter histogram.
+ */
+const int TIMER_JITTER_BINS = 16;
+
+/**
+ * ALSA Timer statistics.
+ *
+ * Snapshot of the periods measured by a Timer between consecutive tick
+ * events, from the timestamps of the ALSA timer events. All times are
+ * given in nanoseconds. The jitter is the absolute difference between
+ * each measured period and the nominal duration of the elapsed ticks.
+ * The histogram bin 0 counts the jitter values below one microsecond,
+ * and the bin i counts the values from 2^(i-1) to 2^i microseconds, the
+ * last bin including any longer value.
+ */
+struct TimerStatistics
+{
+    quint64 periods;        ///< Number of measured periods
+    quint64 overruns;       ///< Number of periods lost, from the elapsed ticks
+    qint64 nominalPeriod;   ///< Nominal period: ticks per event times resolution
+    qint64 meanPeriod;      ///< Average period
+    qint64 minPeriod;       ///< Shortest period
+    qint64 maxPeriod;       ///< Longest period
+    qint64 meanJitter;      ///< Average jitter
+    qint64 maxJitter;       ///< Maximum jitter
+    double drift;           ///< Accumulated drift, in parts per million
+    quint64 histogram[TIMER_JITTER_BINS]; ///< Jitter histogram
+};
+
+/**
+ * ALSA Timer benchmark result.
+ *
+ * Statistics of a timer measured by Timer::benchmarkTimers(). A timer is
+ * reachable when both its nominal period, limited by its resolution, and
+ * its measured mean period are within 10% of the requested period.
+ */
+struct TimerBenchmarkResult
+{
+    TimerId id;             ///< Timer identifier
+    QString name;           ///< Timer name
+    TimerStatistics stats;  ///< Measured statistics
+    double cpuLoad;         ///< Process CPU time used while measuring, in percent of the elapsed time
+    qint64 requestedPeriod; ///< Requested period in nanoseconds: 1e9 / frequency
+    qint64 nominalPeriod;   ///< Achieved nominal period in nanoseconds
+    qint64 meanPeriod;      ///< Measured mean period in nanoseconds
+    bool reachable;         ///< The timer runs close to the requested frequency
+    double relativeJitter;  ///< Mean jitter in percent of the mean period
+};
+
+/**
+ * List of timer benchmark results
+ */
+typedef QList<TimerBenchmarkResult> TimerBenchmarkList;
+
 /**
  * ALSA Timer management.
  *
@@ -308,6 +363,8 @@ public:
     
     static TimerId bestGlobalTimerId();
     static Timer* bestGlobalTimer(int openMode, QObject* parent = nullptr);
+    static TimerBenchmarkList benchmarkTimers(int frequency = 1000, int duration = 250);
+    static TimerId bestMeasuredTimerId(int frequency = 1000, int duration = 250);
     /**
      * Gets the ALSA timer object.
      * @return ALSA timer object pointer.
@@ -334,6 +391,8 @@ public:
     void setHandler(TimerEventHandler* h) { m_handler = h; }
     void startEvents();
     void stopEvents();
+    TimerStatistics getStatistics() const;
+    void resetStatistics();
     
 protected:
     void doEvents();
@@ -0,0 +1,198 @@
+/*
+    Drumstick MIDI realtime input-output
+    Copyright (C) 2009-2021 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MIDITHRUROUTER_H
+#define MIDITHRUROUTER_H
+
+#include <QObject>
+#include <QScopedPointer>
+#include "macros.h"
+#include "rtmidiinput.h"
+#include "rtmidioutput.h"
+
+/**
+ * @file midithrurouter.h
+ * MIDIThruRouter class declaration
+ */
+
+namespace drumstick { namespace rt {
+
+    /**
+     * @addtogroup RT
+     * @{
+     */
+
+    /**
+     * @brief The MIDIThruRouter class forwards MIDI messages from one or more
+     * MIDI inputs to one or more MIDI outputs.
+     *
+     * The router is installed as the MIDI Thru device of the attached inputs,
+     * so messages are forwarded by direct calls on the input thread, before
+     * and independently of the Qt signals emitted by the input backends.
+     * Messages may be filtered by channel and note range, and transformed
+     * by channel remapping and transposition.
+     *
+     * The routing path takes no lock: the settings are published as
+     * immutable snapshots, and the statistics are atomic counters, so they
+     * may be polled from the GUI thread without delaying the input. The
+     * latency figures are the time spent in the calls to the destination
+     * outputs; they don't include the delay of the input backend before
+     * the message reaches the router.
+     */
+    class DRUMSTICK_EXPORT MIDIThruRouter : public MIDIOutput
+    {
+        Q_OBJECT
+
+    public:
+        /**
+         * @brief MIDIThruRouter constructor
+         * @param parent
+         */
+        explicit MIDIThruRouter(QObject *parent = nullptr);
+        /**
+         * @brief ~MIDIThruRouter destructor
+         */
+        virtual ~MIDIThruRouter();
+
+        /**
+         * @brief attachInput installs the router as the MIDI Thru device of an input
+         * @param input MIDI input
+         */
+        void attachInput(MIDIInput *input);
+        /**
+         * @brief detachInput removes the router from an input
+         * @param input MIDI input
+         */
+        void detachInput(MIDIInput *input);
+        /**
+         * @brief addOutput appends a destination
+         * @param output MIDI output
+         */
+        void addOutput(MIDIOutput *output);
+        /**
+         * @brief removeOutput removes a destination, waiting until no
+         * message is being forwarded to it
+         * @param output MIDI output
+         */
+        void removeOutput(MIDIOutput *output);
+        /**
+         * @brief outputs
+         * @return list of destinations
+         */
+        QList<MIDIOutput*> outputs() const;
+
+        /**
+         * @brief setChannelFilter
+         * @param mask bit mask of the accepted channels (bit 0 is channel 0)
+         */
+        void setChannelFilter(quint16 mask);
+        /**
+         * @brief channelFilter
+         * @return bit mask of the accepted channels
+         */
+        quint16 channelFilter() const;
+        /**
+         * @brief setNoteRange accepts only notes between low and high, inclusive
+         * @param low lowest note number
+         * @param high highest note number
+         */
+        void setNoteRange(int low, int high);
+        /**
+         * @brief setTranspose
+         * @param semitones interval added to note numbers
+         */
+        void setTranspose(int semitones);
+        /**
+         * @brief transpose
+         * @return interval added to note numbers
+         */
+        int transpose() const;
+        /**
+         * @brief setChannelMap redirects the messages of a channel
+         * @param inputChannel source channel
+         * @param outputChannel destination channel
+         */
+        void setChannelMap(int inputChannel, int outputChannel);
+        /**
+         * @brief setSystemMessagesEnabled
+         * @param enabled whether system messages and sysex are forwarded
+         */
+        void setSystemMessagesEnabled(bool enabled);
+
+        /**
+         * @brief forwardedMessages
+         * @return number of messages forwarded
+         */
+        quint64 forwardedMessages() const;
+        /**
+         * @brief filteredMessages
+         * @return number of messages discarded by the filters
+         */
+        quint64 filteredMessages() const;
+        /**
+         * @brief minLatency
+         * @return minimum time spent in the destination outputs forwarding a message, in nanoseconds
+         */
+        qint64 minLatency() const;
+        /**
+         * @brief maxLatency
+         * @return maximum time spent in the destination outputs forwarding a message, in nanoseconds
+         */
+        qint64 maxLatency() const;
+        /**
+         * @brief averageLatency
+         * @return average time spent in the destination outputs forwarding a message, in nanoseconds
+         */
+        qint64 averageLatency() const;
+        /**
+         * @brief resetStatistics clears the message counters and latencies
+         */
+        void resetStatistics();
+
+        // MIDIOutput interface
+        virtual void initialize(QSettings* settings) override;
+        virtual QString backendName() override;
+        virtual QString publicName() override;
+        virtual void setPublicName(QString name) override;
+        virtual QList<MIDIConnection> connections(bool advanced = false) override;
+        virtual void setExcludedConnections(QStringList conns) override;
+        virtual void open(const MIDIConnection& conn) override;
+        virtual void close() override;
+        virtual MIDIConnection currentConnection() override;
+
+    public Q_SLOTS:
+        virtual void sendNoteOff(int chan, int note, int vel) override;
+        virtual void sendNoteOn(int chan, int note, int vel) override;
+        virtual void sendKeyPressure(int chan, int note, int value) override;
+        virtual void sendController(int chan, int control, int value) override;
+        virtual void sendProgram(int chan, int program) override;
+        virtual void sendChannelPressure(int chan, int value) override;
+        virtual void sendPitchBend(int chan, int value) override;
+        virtual void sendSysex(const QByteArray& data) override;
+        virtual void sendSystemMsg(const int status) override;
+
+    private:
+        class MIDIThruRouterPrivate;
+        QScopedPointer<MIDIThruRouterPrivate> d;
+    };
+
+/** @} */
+
+}} // namespace drumstick::rt
+
+#endif // MIDITHRUROUTER_H
@@ -17,12 +17,14 @@
 */
 
 #include "alsamidiinput.h"
+#include <QAtomicInt>
 #include <QDebug>
 #include <QMap>
 #include <QStringList>
 #include <drumstick/alsaclient.h>
 #include <drumstick/alsaevent.h>
 #include <drumstick/alsaport.h>
+#include <drumstick/subscription.h>
 #include <drumstick/rtmidioutput.h>
 
 namespace drumstick { namespace rt {
@@ -49,6 +51,8 @@ namespace drumstick { namespace rt {
         QList<MIDIConnection> m_inputDevices;
         QStringList m_excludedNames;
         bool m_initialized;
+        QAtomicInt m_nativeThru;
+        Subscription *m_thruSubscription;
 
         explicit ALSAMIDIInputPrivate(ALSAMIDIInput *inp) :
             m_inp(inp),
@@ -60,7 +64,9 @@ namespace drumstick { namespace rt {
             m_thruEnabled(false),
             m_clientFilter(false),
             m_publicName(ALSAMIDIInput::DEFAULT_PUBLIC_NAME),
-            m_initialized(false)
+            m_initialized(false),
+            m_nativeThru(0),
+            m_thruSubscription(nullptr)
         {
             m_runtimeAlsaNum = getRuntimeALSALibraryNumber();
         }
@@ -95,6 +101,7 @@ namespace drumstick { namespace rt {
         void uninitialize() {
             //qDebug() << Q_FUNC_INFO << m_initialized;
             if (m_initialized) {
+                clearNativeThru();
                 if (m_port != nullptr) {
                     m_port->detach();
                     delete m_port;
@@ -180,6 +187,7 @@ namespace drumstick { namespace rt {
                 m_port->unsubscribeAll();
                 m_port->subscribeFrom(newDevice.second.toString());
                 m_client->startSequencerInput();
+                updateNativeThru();
                 return true;
             }
             return false;
@@ -188,12 +196,76 @@ namespace drumstick { namespace rt {
         void clearSubscription()
         {
             if (!m_currentInput.first.isEmpty() && m_initialized) {
+                clearNativeThru();
                 m_client->stopSequencerInput();
                 m_port->unsubscribeAll();
                 m_currentInput = MIDIConnection();
             }
         }
 
+        /*
+         * When the MIDI Thru device is also an ALSA output, the events are
+         * routed by the kernel sequencer through a direct subscription from
+         * the input source port to the output destination port, without
+         * any user space copy. Thru devices from other backends, or a
+         * MIDIThruRouter when filters or transforms are needed, keep using
+         * the user space path. The subscription is evaluated when the input
+         * is opened, when the thru device or its state changes, and when
+         * the ALSA output is connected or disconnected (its
+         * connectionChanged() signal). m_nativeThru is read by the input
+         * thread to skip the user space copy.
+         */
+        void updateNativeThru()
+        {
+            clearNativeThru();
+            if (!m_initialized || !m_thruEnabled || m_out == nullptr ||
+                m_currentInput.first.isEmpty() ||
+                m_out->backendName() != QStringLiteral("ALSA")) {
+                return;
+            }
+            MIDIConnection outConn = m_out->currentConnection();
+            snd_seq_addr_t src, dst;
+            if (outConn.first.isEmpty() ||
+                !m_client->parseAddress(m_currentInput.second.toString(), src) ||
+                !m_client->parseAddress(outConn.second.toString(), dst)) {
+                return;
+            }
+            if (nativeSubscriptionExists(src, dst)) {
+                // already connected by someone else: not owned here
+                m_nativeThru.storeRelease(1);
+                return;
+            }
+            m_thruSubscription = new Subscription();
+            m_thruSubscription->setSender(&src);
+            m_thruSubscription->setDest(&dst);
+            m_thruSubscription->subscribe(m_client);
+            const bool exists = nativeSubscriptionExists(src, dst);
+            m_nativeThru.storeRelease(exists ? 1 : 0);
+            if (!exists) {
+                delete m_thruSubscription;
+                m_thruSubscription = nullptr;
+            }
+        }
+
+        void clearNativeThru()
+        {
+            if (m_thruSubscription != nullptr) {
+                m_thruSubscription->unsubscribe(m_client);
+                delete m_thruSubscription;
+                m_thruSubscription = nullptr;
+            }
+            m_nativeThru.storeRelease(0);
+        }
+
+        bool nativeSubscriptionExists(const snd_seq_addr_t &src, const snd_seq_addr_t &dst)
+        {
+            snd_seq_port_subscribe_t *subs;
+            snd_seq_port_subscribe_alloca(&subs);
+            snd_seq_port_subscribe_set_sender(subs, &src);
+            snd_seq_port_subscribe_set_dest(subs, &dst);
+            return snd_seq_get_port_subscription(m_client->getHandle(), subs) == 0;
+        }
+
         void setPublicName(QString newName)
         {
             if (newName != m_publicName) {
@@ -206,11 +278,12 @@ namespace drumstick { namespace rt {
 
         void handleSequencerEvent(SequencerEvent* ev) override
         {
+            const bool thru = m_out != nullptr && m_thruEnabled && m_nativeThru.loadAcquire() == 0;
             if ( !SequencerEvent::isConnectionChange(ev) && m_initialized)
                 switch(ev->getSequencerType()) {
                 case SND_SEQ_EVENT_NOTEOFF: {
                         const NoteOffEvent* n = static_cast<const NoteOffEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
+                        if(thru) {
                             m_out->sendNoteOff(n->getChannel(), n->getKey(), n->getVelocity());
                         }
                         emit m_inp->midiNoteOff(n->getChannel(), n->getKey(), n->getVelocity());
@@ -218,7 +291,7 @@ namespace drumstick { namespace rt {
                     break;
                 case SND_SEQ_EVENT_NOTEON: {
                         const NoteOnEvent* n = static_cast<const NoteOnEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
+                        if(thru) {
                             m_out->sendNoteOn(n->getChannel(), n->getKey(), n->getVelocity());
                         }
                         emit m_inp->midiNoteOn(n->getChannel(), n->getKey(), n->getVelocity());
@@ -226,7 +299,7 @@ namespace drumstick { namespace rt {
                     break;
                 case SND_SEQ_EVENT_KEYPRESS: {
                         const KeyPressEvent* n = static_cast<const KeyPressEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
+                        if(thru) {
                             m_out->sendKeyPressure(n->getChannel(), n->getKey(), n->getVelocity());
                         }
                         emit m_inp->midiKeyPressure(n->getChannel(), n->getKey(), n->getVelocity());
@@ -235,7 +308,7 @@ namespace drumstick { namespace rt {
                 case SND_SEQ_EVENT_CONTROLLER:
                 case SND_SEQ_EVENT_CONTROL14: {
                         const ControllerEvent* n = static_cast<const ControllerEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
+                        if(thru) {
                             m_out->sendController(n->getChannel(), n->getParam(), n->getValue());
                         }
                         emit m_inp->midiController(n->getChannel(), n->getParam(), n->getValue());
@@ -243,7 +316,7 @@ namespace drumstick { namespace rt {
                     break;
                 case SND_SEQ_EVENT_PGMCHANGE: {
                         const ProgramChangeEvent* p = static_cast<const ProgramChangeEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
+                        if(thru) {
                             m_out->sendProgram(p->getChannel(), p->getValue());
                         }
                         emit m_inp->midiProgram(p->getChannel(), p->getValue());
@@ -251,7 +324,7 @@ namespace drumstick { namespace rt {
                     break;
                 case SND_SEQ_EVENT_CHANPRESS: {
                         const ChanPressEvent* n = static_cast<const ChanPressEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
+                        if(thru) {
                             m_out->sendChannelPressure(n->getChannel(), n->getValue());
                         }
                         emit m_inp->midiChannelPressure(n->getChannel(), n->getValue());
@@ -259,7 +332,7 @@ namespace drumstick { namespace rt {
                     break;
                 case SND_SEQ_EVENT_PITCHBEND: {
                         const PitchBendEvent* n = static_cast<const PitchBendEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
+                        if(thru) {
                             m_out->sendPitchBend(n->getChannel(), n->getValue());
                         }
                         emit m_inp->midiPitchBend(n->getChannel(), n->getValue());
@@ -268,7 +341,7 @@ namespace drumstick { namespace rt {
                 case SND_SEQ_EVENT_SYSEX: {
                         const SysExEvent* n = static_cast<const SysExEvent*>(ev);
                         QByteArray data(n->getData(), n->getLength());
-                        if(m_out != nullptr && m_thruEnabled) {
+                        if(thru) {
                             m_out->sendSysex(data);
                         }
                         emit m_inp->midiSysex(data);
@@ -277,7 +350,7 @@ namespace drumstick { namespace rt {
                 case SND_SEQ_EVENT_SYSTEM: {
                         const SystemEvent* n = static_cast<const SystemEvent*>(ev);
                         int status = (int) n->getRaw8(0);
-                        if(m_out != nullptr && m_thruEnabled) {
+                        if(thru) {
                             m_out->sendSystemMsg(status);
                         }
                         if (status < 0xF7)
@@ -353,12 +426,26 @@ namespace drumstick { namespace rt {
 
     void ALSAMIDIInput::setMIDIThruDevice(MIDIOutput *device)
     {
+        if (d->m_out != nullptr) {
+            disconnect(d->m_out, nullptr, this, SLOT(thruConnectionChanged()));
+        }
         d->m_out = device;
+        if (device != nullptr && device->backendName() == QStringLiteral("ALSA")) {
+            // the signal is declared by the ALSA output plugin
+            connect(device, SIGNAL(connectionChanged()), this, SLOT(thruConnectionChanged()));
+        }
+        d->updateNativeThru();
+    }
+
+    void ALSAMIDIInput::thruConnectionChanged()
+    {
+        d->updateNativeThru();
     }
 
     void ALSAMIDIInput::enableMIDIThru(bool enable)
     {
         d->m_thruEnabled = enable;
+        d->updateNativeThru();
     }
 
     bool ALSAMIDIInput::isEnabledMIDIThru()
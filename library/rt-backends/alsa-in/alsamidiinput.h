@@ -52,6 +52,9 @@ namespace rt {
 
         static const QString DEFAULT_PUBLIC_NAME;
 
+    private Q_SLOTS:
+        void thruConnectionChanged();
+
     private:
         class ALSAMIDIInputPrivate;
         ALSAMIDIInputPrivate * const d;
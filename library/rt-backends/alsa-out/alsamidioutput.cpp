@@ -317,12 +317,14 @@ namespace rt {
     {
         auto b = d->setSubscription(name);
         if (!b) qWarning() << "failed subscription to" << name.first;
+        emit connectionChanged();
     }
 
     void ALSAMIDIOutput::close()
     {
         d->clearSubscription();
         d->uninitialize();
+        emit connectionChanged();
     }
 
 } // namespace rt
@@ -46,6 +46,10 @@ namespace rt {
 
         static const QString DEFAULT_PUBLIC_NAME;
 
+    signals:
+        /* emitted after the output port is connected or disconnected */
+        void connectionChanged();
+
     public slots:
         virtual void sendNoteOn(int chan, int note, int vel) override;
         virtual void sendNoteOff(int chan, int note, int vel) override;
@@ -23,131 +23,231 @@
 namespace drumstick {
 namespace rt {
 
+const int MIDIParser::MAX_SYSEX_SIZE = 65536;
+
+/*
+ * Number of data bytes following each status byte, indexed by the
+ * high nibble for channel messages and by the low nibble for system
+ * messages (0xF0..0xFF). System exclusive is handled separately.
+ */
+static const quint8 CHANNEL_DATA_LENGTH[8] = {
+    2,  // 0x80 note off
+    2,  // 0x90 note on
+    2,  // 0xA0 key pressure
+    2,  // 0xB0 control change
+    1,  // 0xC0 program change
+    1,  // 0xD0 channel pressure
+    2,  // 0xE0 pitch bend
+    0   // 0xF0 system messages
+};
+
+static const quint8 SYSTEM_DATA_LENGTH[16] = {
+    0,  // 0xF0 sysex
+    1,  // 0xF1 MTC quarter frame
+    2,  // 0xF2 song position pointer
+    1,  // 0xF3 song select
+    0,  // 0xF4 undefined
+    0,  // 0xF5 undefined
+    0,  // 0xF6 tune request
+    0,  // 0xF7 end of sysex
+    0, 0, 0, 0, 0, 0, 0, 0  // 0xF8..0xFF realtime
+};
+
 class MIDIParser::MIDIParserPrivate {
 public:
-    MIDIParserPrivate(): m_in(nullptr), m_out(nullptr), m_running_status(0) { }
+    MIDIParserPrivate():
+        m_in(nullptr),
+        m_out(nullptr),
+        m_status(0),
+        m_needed(0),
+        m_count(0),
+        m_inSysex(false),
+        m_sysexOverflow(false)
+    {
+        m_data[0] = m_data[1] = 0;
+        m_sysex.reserve(MAX_SYSEX_SIZE);
+    }
+
     MIDIInput *m_in;
     MIDIOutput *m_out;
-    unsigned char m_running_status;
-    QByteArray m_buffer;
+    quint8 m_status;    // current status, also the running status
+    int m_needed;       // data bytes required by the current status
+    int m_count;        // data bytes already received
+    quint8 m_data[2];
+    bool m_inSysex;
+    bool m_sysexOverflow;
+    QByteArray m_sysex;
 
-    void processNoteOff(const int chan, const int note, const int vel)
+    bool thru() const
     {
-        //qDebug() << "NoteOff(" << hex << chan << "," << note << "," << vel << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendNoteOff(chan, note, vel);
-        }
-        if (m_in != nullptr) {
-            emit m_in->midiNoteOff(chan, note, vel);
-        }
+        return m_out != nullptr && m_in->isEnabledMIDIThru();
     }
 
-    void processNoteOn(const int chan, const int note, const int vel)
+    void setStatus(quint8 status)
     {
-        //qDebug() << "NoteOn(" << hex << chan << "," << note << "," << vel << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendNoteOn(chan, note, vel);
-        }
-        if (m_in != nullptr) {
-            emit m_in->midiNoteOn(chan, note, vel);
-        }
+        m_status = status;
+        m_needed = (status < MIDI_STATUS_SYSEX) ?
+                    CHANNEL_DATA_LENGTH[(status >> 4) & 0x07] :
+                    SYSTEM_DATA_LENGTH[status & 0x0f];
+        m_count = 0;
     }
 
-    void processKeyPressure(const int chan, const int note, const int value)
+    void processChannelMessage()
     {
-        //qDebug() << "KeyPressure(" << hex << chan << "," << note << "," << value << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendKeyPressure(chan, note, value);
-        }
-        if (m_in != nullptr) {
-            emit m_in->midiKeyPressure(chan, note, value);
+        if (m_in == nullptr) {
+            return;
         }
-    }
-
-    void processController(const int chan, const int control, const int value)
-    {
-        //qDebug() << "Controller(" << chan << "," << control << "," << value << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendController(chan, control, value);
-        }
-        if (m_in != nullptr) {
-            emit m_in->midiController(chan, control, value);
+        const int chan = m_status & MIDI_CHANNEL_MASK;
+        const int m1 = m_data[0];
+        const int m2 = m_data[1];
+        const bool sendThru = thru();
+        switch(m_status & MIDI_STATUS_MASK) {
+        case MIDI_STATUS_NOTEOFF:
+            if (sendThru) {
+                m_out->sendNoteOff(chan, m1, m2);
+            }
+            emit m_in->midiNoteOff(chan, m1, m2);
+            break;
+        case MIDI_STATUS_NOTEON:
+            if (sendThru) {
+                m_out->sendNoteOn(chan, m1, m2);
+            }
+            emit m_in->midiNoteOn(chan, m1, m2);
+            break;
+        case MIDI_STATUS_KEYPRESURE:
+            if (sendThru) {
+                m_out->sendKeyPressure(chan, m1, m2);
+            }
+            emit m_in->midiKeyPressure(chan, m1, m2);
+            break;
+        case MIDI_STATUS_CONTROLCHANGE:
+            if (sendThru) {
+                m_out->sendController(chan, m1, m2);
+            }
+            emit m_in->midiController(chan, m1, m2);
+            break;
+        case MIDI_STATUS_PROGRAMCHANGE:
+            if (sendThru) {
+                m_out->sendProgram(chan, m1);
+            }
+            emit m_in->midiProgram(chan, m1);
+            break;
+        case MIDI_STATUS_CHANNELPRESSURE:
+            if (sendThru) {
+                m_out->sendChannelPressure(chan, m1);
+            }
+            emit m_in->midiChannelPressure(chan, m1);
+            break;
+        case MIDI_STATUS_PITCHBEND: {
+                int v = m1 + m2 * 0x80 - 0x2000;
+                if (sendThru) {
+                    m_out->sendPitchBend(chan, v);
+                }
+                emit m_in->midiPitchBend(chan, v);
+            }
+            break;
         }
     }
 
-    void processProgram(const int chan, const int program)
+    void processSystemCommon(const int status)
     {
-        //qDebug() << "Program(" << hex << chan << "," << program << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendProgram(chan, program);
+        if (m_in == nullptr) {
+            return;
         }
-        if (m_in != nullptr) {
-            emit m_in->midiProgram(chan, program);
+        if (thru()) {
+            m_out->sendSystemMsg(status);
         }
+        emit m_in->midiSystemCommon(status);
     }
 
-    void processChannelPressure(const int chan, const int value)
+    void processSystemRealtime(const int status)
     {
-        //qDebug() << "ChannelPressure(" << chan << "," << value << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendChannelPressure(chan, value);
+        if (m_in == nullptr) {
+            return;
         }
-        if (m_in != nullptr) {
-            emit m_in->midiChannelPressure(chan, value);
+        if (thru()) {
+            m_out->sendSystemMsg(status);
         }
+        emit m_in->midiSystemRealtime(status);
     }
 
-    void processPitchBend(const int chan, const int value)
+    void processSysex()
     {
-        //qDebug() << "PitchBend(" << chan << "," << value << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendPitchBend(chan, value);
+        if (m_in == nullptr) {
+            return;
         }
-        if (m_in != nullptr) {
-            emit m_in->midiPitchBend(chan, value);
+        if (thru()) {
+            m_out->sendSysex(m_sysex);
         }
+        emit m_in->midiSysex(m_sysex);
     }
 
-    void processSysex(const QByteArray &data)
+    void beginSysex()
     {
-        //qDebug() << "Sysex(" << data.toHex() << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendSysex(data);
-        }
-        if (m_in != nullptr) {
-            emit m_in->midiSysex(data);
-        }
+        m_inSysex = true;
+        m_sysexOverflow = false;
+        m_sysex.resize(0);
+        m_sysex.append(static_cast<char>(MIDI_STATUS_SYSEX));
     }
 
-    void processSystemCommon(const int status)
+    void endSysex(bool complete)
     {
-        //qDebug() << "common SystemMsg(" << hex << status << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendSystemMsg(status);
-        }
-        if (m_in != nullptr) {
-            emit m_in->midiSystemCommon(status);
+        if (complete && !m_sysexOverflow) {
+            m_sysex.append(static_cast<char>(MIDI_STATUS_ENDSYSEX));
+            processSysex();
         }
+        m_inSysex = false;
+        m_sysex.resize(0);
     }
 
-    void processSystemRealtime(unsigned char byte)
+    void parse(const quint8 byte)
     {
-        //qDebug() << "realtime SystemMsg(" << hex << byte << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendSystemMsg(byte);
-        }
-        if (m_in != nullptr) {
-            emit m_in->midiSystemRealtime(byte);
-        }
+        if (byte >= MIDI_STATUS_REALTIME) {
+            // realtime messages may appear anywhere, even inside sysex
+            processSystemRealtime(byte);
+        } else if (byte & 0x80) {
+            // any status byte terminates a sysex
+            if (m_inSysex) {
+                endSysex(byte == MIDI_STATUS_ENDSYSEX);
+            }
+            if (byte == MIDI_STATUS_SYSEX) {
+                m_status = 0;
+                beginSysex();
+            } else if (byte == MIDI_STATUS_ENDSYSEX) {
+                m_status = 0;
+            } else {
+                setStatus(byte);
+                if (m_needed == 0) {
+                    // system common without data cancels running status
+                    processSystemCommon(byte);
+                    m_status = 0;
+                }
+            }
+        } else if (m_inSysex) {
+            if (m_sysex.size() < MAX_SYSEX_SIZE - 1) {
+                m_sysex.append(static_cast<char>(byte));
+            } else {
+                m_sysexOverflow = true;
+            }
+        } else if (m_status != 0) {
+            m_data[m_count++] = byte;
+            if (m_count == m_needed) {
+                if (m_status < MIDI_STATUS_SYSEX) {
+                    processChannelMessage();
+                    m_count = 0; // keep running status
+                } else {
+                    processSystemCommon(m_status);
+                    m_status = 0;
+                }
+            }
+        } // else: orphan data byte without status, ignored
     }
-
 };
 
 MIDIParser::MIDIParser(MIDIInput *in, QObject *parent) :
     QObject(parent),
     d(new MIDIParser::MIDIParserPrivate)
 {
-    d->m_buffer.clear();
     d->m_in = in;
 }
 
@@ -161,98 +261,36 @@ void MIDIParser::setMIDIThruDevice(MIDIOutput *device)
     d->m_out = device;
 }
 
-void MIDIParser::parse(unsigned char byte)
+/*
+ * Decodes a buffer of raw MIDI bytes, emitting the input signals for every
+ * complete message. Incomplete messages are kept until the next call.
+ * No memory is allocated while parsing, except when a sysex message is
+ * retained by a receiver.
+ */
+void MIDIParser::parse(const unsigned char *data, size_t size)
 {
-    if (byte >= MIDI_STATUS_REALTIME) { // system realtime
-        d->processSystemRealtime(byte);
-        return;
-    } else
-        d->m_buffer.append(byte);
-
-    while(d->m_buffer.length() > 0) {
-        int chan, m1, m2, v;
-        unsigned char status = static_cast<unsigned>(d->m_buffer.at(0));
-        if (status == MIDI_STATUS_SYSEX) { // system exclusive
-            if (byte == MIDI_STATUS_ENDSYSEX) {
-                d->processSysex(d->m_buffer);
-                d->m_buffer.clear();
-            } else
-                return;
-        } else
-        if (status > MIDI_STATUS_SYSEX &&
-            status < MIDI_STATUS_ENDSYSEX) { // system common
-            d->processSystemCommon(status);
-            d->m_buffer.clear();
-        } else
-        if (status < MIDI_STATUS_SYSEX &&
-            status >= MIDI_STATUS_NOTEOFF) { // channel message
-            d->m_running_status = status;
-            chan = status & MIDI_CHANNEL_MASK;
-            status = status & MIDI_STATUS_MASK;
-            switch(status) {
-            case MIDI_STATUS_NOTEOFF:
-                if (d->m_buffer.length() < 3)
-                    return;
-                m1 = static_cast<unsigned>(d->m_buffer.at(1));
-                m2 = static_cast<unsigned>(d->m_buffer.at(2));
-                d->processNoteOff(chan, m1, m2);
-                break;
-            case MIDI_STATUS_NOTEON:
-                if (d->m_buffer.length() < 3)
-                    return;
-                m1 = static_cast<unsigned>(d->m_buffer.at(1));
-                m2 = static_cast<unsigned>(d->m_buffer.at(2));
-                d->processNoteOn(chan, m1, m2);
-                break;
-            case MIDI_STATUS_KEYPRESURE:
-                if (d->m_buffer.length() < 3)
-                    return;
-                m1 = static_cast<unsigned>(d->m_buffer.at(1));
-                m2 = static_cast<unsigned>(d->m_buffer.at(2));
-                d->processKeyPressure(chan, m1, m2);
-                break;
-            case MIDI_STATUS_CONTROLCHANGE:
-                if (d->m_buffer.length() < 3)
-                    return;
-                m1 = static_cast<unsigned>(d->m_buffer.at(1));
-                m2 = static_cast<unsigned>(d->m_buffer.at(2));
-                d->processController(chan, m1, m2);
-                break;
-            case MIDI_STATUS_PROGRAMCHANGE:
-                if (d->m_buffer.length() < 2)
-                    return;
-                m1 = static_cast<unsigned>(d->m_buffer.at(1));
-                d->processProgram(chan, m1);
-                break;
-            case MIDI_STATUS_CHANNELPRESSURE:
-                if (d->m_buffer.length() < 2)
-                    return;
-                m1 = static_cast<unsigned>(d->m_buffer.at(1));
-                d->processChannelPressure(chan, m1);
-                break;
-            case MIDI_STATUS_PITCHBEND:
-                if (d->m_buffer.length() < 3)
-                    return;
-                m1 = static_cast<unsigned>(d->m_buffer.at(1));
-                m2 = static_cast<unsigned>(d->m_buffer.at(2));
-                v = m1 + m2 * 0x80 - 0x2000;
-                d->processPitchBend(chan, v);
-                break;
-            }
-            d->m_buffer.clear();
-        } else { // running status
-            d->m_buffer.insert(0, d->m_running_status);
-        }
+    for (size_t i = 0; i < size; ++i) {
+        d->parse(data[i]);
     }
 }
 
+void MIDIParser::reset()
+{
+    d->m_status = 0;
+    d->m_count = 0;
+    d->m_inSysex = false;
+    d->m_sysex.resize(0);
+}
+
+void MIDIParser::parse(unsigned char byte)
+{
+    d->parse(byte);
+}
+
 void MIDIParser::parse(QByteArray bytes)
 {
-    foreach(unsigned char byte, bytes) {
-        parse(byte);
-    }
+    parse(reinterpret_cast<const unsigned char *>(bytes.constData()), static_cast<size_t>(bytes.size()));
 }
 
 } // namespace rt
 } // namespace drumstick
-
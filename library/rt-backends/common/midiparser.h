@@ -32,6 +32,10 @@ public:
     explicit MIDIParser(MIDIInput *in = nullptr, QObject *parent = nullptr);
     virtual ~MIDIParser();
     void setMIDIThruDevice(MIDIOutput* device);
+    void parse(const unsigned char *data, size_t size);
+    void reset();
+
+    static const int MAX_SYSEX_SIZE;
 
 public slots:
     void parse(unsigned char byte);
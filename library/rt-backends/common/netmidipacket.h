@@ -0,0 +1,73 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2021 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NETMIDIPACKET_H
+#define NETMIDIPACKET_H
+
+#include <QtGlobal>
+#include <QtEndian>
+
+namespace drumstick {
+namespace rt {
+
+/*
+ * Timestamped network MIDI datagram header, shared by net-in and net-out.
+ *
+ * offset size
+ *   0     2   magic 'D' 'M' (never a MIDI status byte)
+ *   2     1   version
+ *   3     1   flags (reserved, zero)
+ *   4     4   sequence number, big endian
+ *   8     8   sender timestamp in microseconds, big endian
+ *  16     -   MIDI payload, several messages with running status
+ *
+ * Plain (untimestamped) datagrams always begin with a status byte,
+ * so both formats can be distinguished by the first byte.
+ */
+
+const quint8 NETMIDI_MAGIC0 = 'D';
+const quint8 NETMIDI_MAGIC1 = 'M';
+const quint8 NETMIDI_VERSION = 1;
+const int NETMIDI_HEADER_SIZE = 16;
+
+inline void writeNetMIDIHeader(uchar *buffer, quint32 sequence, quint64 timestamp)
+{
+    buffer[0] = NETMIDI_MAGIC0;
+    buffer[1] = NETMIDI_MAGIC1;
+    buffer[2] = NETMIDI_VERSION;
+    buffer[3] = 0;
+    qToBigEndian<quint32>(sequence, buffer + 4);
+    qToBigEndian<quint64>(timestamp, buffer + 8);
+}
+
+inline bool readNetMIDIHeader(const uchar *buffer, int size, quint32 &sequence, quint64 &timestamp)
+{
+    if (size < NETMIDI_HEADER_SIZE ||
+        buffer[0] != NETMIDI_MAGIC0 ||
+        buffer[1] != NETMIDI_MAGIC1 ||
+        buffer[2] != NETMIDI_VERSION) {
+        return false;
+    }
+    sequence = qFromBigEndian<quint32>(buffer + 4);
+    timestamp = qFromBigEndian<quint64>(buffer + 8);
+    return true;
+}
+
+}}
+
+#endif // NETMIDIPACKET_H
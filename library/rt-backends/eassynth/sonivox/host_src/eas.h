@@ -297,6 +297,44 @@ EAS_PUBLIC EAS_RESULT EAS_SetSynthPolyphony (EAS_DATA_HANDLE pEASData, EAS_I32 s
 */
 EAS_PUBLIC EAS_RESULT EAS_GetSynthPolyphony (EAS_DATA_HANDLE pEASData, EAS_I32 synthNum, EAS_I32 *pPolyphonyCount);
 
+/*----------------------------------------------------------------------------
+ * EAS_GetActiveVoices()
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Returns the number of voices currently allocated by the voice manager,
+ * including voices that are releasing or being stolen
+ *
+ * Inputs:
+ * pEASData         - pointer to overall EAS data structure
+ * pActiveVoices    - pointer to variable to receive the voice count
+ *
+ * Outputs:
+ *
+ * Side Effects:
+ *
+ *----------------------------------------------------------------------------
+*/
+EAS_PUBLIC EAS_RESULT EAS_GetActiveVoices (EAS_DATA_HANDLE pEASData, EAS_I32 *pActiveVoices);
+
+/*----------------------------------------------------------------------------
+ * EAS_GetStolenVoices()
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Returns the number of voices stolen by the voice manager since the
+ * library was initialized. The counter wraps around.
+ *
+ * Inputs:
+ * pEASData         - pointer to overall EAS data structure
+ * pStolenVoices    - pointer to variable to receive the voice count
+ *
+ * Outputs:
+ *
+ * Side Effects:
+ *
+ *----------------------------------------------------------------------------
+*/
+EAS_PUBLIC EAS_RESULT EAS_GetStolenVoices (EAS_DATA_HANDLE pEASData, EAS_U32 *pStolenVoices);
+
 /*----------------------------------------------------------------------------
  * EAS_SetPolyphony()
  *----------------------------------------------------------------------------
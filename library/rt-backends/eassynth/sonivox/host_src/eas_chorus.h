@@ -31,6 +31,8 @@
 #ifndef EAS_CHORUS_H
 #define EAS_CHORUS_H
 
+#include "eas_types.h"
+
 /* enumerated parameter settings for Chorus effect */
 typedef enum
 {
@@ -49,5 +51,19 @@ typedef enum
     EAS_PARAM_CHORUS_PRESET4
 } E_CHORUS_PRESETS;
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* selects the SIMD or the scalar chorus taps, returns the previous setting */
+EAS_BOOL ChorusEnableSIMD (EAS_BOOL enable);
+
+/* returns EAS_TRUE if the SIMD chorus taps are built and enabled */
+EAS_BOOL ChorusSIMDEnabled (void);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
 
 #endif
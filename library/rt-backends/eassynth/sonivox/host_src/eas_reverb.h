@@ -31,6 +31,8 @@
 #ifndef _EAS_REVERB_H
 #define _EAS_REVERB_H
 
+#include "eas_types.h"
+
 
 /* enumerated parameter settings for Reverb effect */
 typedef enum
@@ -50,5 +52,19 @@ typedef enum
     EAS_PARAM_REVERB_ROOM,
 } E_REVERB_PRESETS;
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* selects the SIMD or the scalar reverb mixer, returns the previous setting */
+EAS_BOOL ReverbEnableSIMD (EAS_BOOL enable);
+
+/* returns EAS_TRUE if the SIMD reverb mixer is built and enabled */
+EAS_BOOL ReverbSIMDEnabled (void);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
 
 #endif /* _REVERB_H */
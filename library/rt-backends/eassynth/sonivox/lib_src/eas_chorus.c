@@ -70,6 +70,56 @@ static const EAS_I16 EAS_chorusShape[CHORUS_SHAPE_SIZE] = {
     -12539, -11039, -9512, -7962, -6393, -4808, -3212, -1608
 };
 
+/*----------------------------------------------------------------------------
+ * SIMD taps
+ *----------------------------------------------------------------------------
+ * The table and delay line look-ups of the chorus are gathers and stay in
+ * scalar code, in the same order as before. The linear interpolation of
+ * the LFO and of the delay taps, the tap position and the final mix are
+ * computed for blocks of samples with SSE2 intrinsics, interleaving both
+ * channels. The results are bit-exact with the scalar code.
+ * The SIMD taps can be disabled at run time with ChorusEnableSIMD().
+ *----------------------------------------------------------------------------
+*/
+#if defined(_SIMD_KERNELS) && (defined(__SSE2__) || defined(_M_X64)) && (NUM_OUTPUT_CHANNELS == 2)
+#include <emmintrin.h>
+#define CHORUS_SIMD_SSE2
+#endif
+
+#define CHORUS_SIMD_BLOCK_FRAMES    64
+
+static EAS_BOOL chorusSimdEnabled = EAS_TRUE;
+
+/*----------------------------------------------------------------------------
+ * ChorusEnableSIMD
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Selects the SIMD or the scalar taps. Returns the previous setting.
+ *----------------------------------------------------------------------------
+*/
+EAS_BOOL ChorusEnableSIMD (EAS_BOOL enable)
+{
+    EAS_BOOL previous = chorusSimdEnabled;
+    chorusSimdEnabled = enable;
+    return previous;
+}
+
+/*----------------------------------------------------------------------------
+ * ChorusSIMDEnabled
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Returns EAS_TRUE if the SIMD taps are built and enabled.
+ *----------------------------------------------------------------------------
+*/
+EAS_BOOL ChorusSIMDEnabled (void)
+{
+#if defined(CHORUS_SIMD_SSE2)
+    return chorusSimdEnabled;
+#else
+    return EAS_FALSE;
+#endif
+}
+
 /*----------------------------------------------------------------------------
  * InitializeChorus()
  *----------------------------------------------------------------------------
@@ -232,6 +282,173 @@ static EAS_I16 WeightedTap(const EAS_I16 *array, EAS_I16 indexReference, EAS_I32
     return(val1 + (EAS_I16)MULT_EG1_EG1(val2-val1,fraction));
 }
 
+#if defined(CHORUS_SIMD_SSE2)
+/*----------------------------------------------------------------------------
+ * ChorusFetch()
+ *----------------------------------------------------------------------------
+ * Purpose: first half of WeightedTap(), returns the two adjacent values
+ * and the fraction without interpolating them
+ *----------------------------------------------------------------------------
+*/
+static void ChorusFetch(const EAS_I16 *array, EAS_I16 indexReference, EAS_I32 indexDesired, EAS_I16 indexLimit,
+                        EAS_I16 *pVal1, EAS_I16 *pVal2, EAS_I16 *pFraction)
+{
+    EAS_I16 index;
+
+    /*lint -e{704} use shift for performance */
+    index = (EAS_I16)(indexDesired >> 16);
+    /*lint -e{704} use shift for performance */
+    *pFraction = (EAS_I16)((indexDesired>>1) & 0x07FFF);
+
+    index = indexReference - index;
+    while (index < 0)
+    {
+        index += indexLimit;
+    }
+
+    *pVal1 = array[index];
+    *pVal2 = (index == 0) ? array[indexLimit-1] : array[index-1];
+}
+
+/*----------------------------------------------------------------------------
+ * ChorusInterpolateSSE2()
+ *----------------------------------------------------------------------------
+ * Purpose: second half of WeightedTap() for eight values:
+ * val1 + (EAS_I16) MULT_EG1_EG1(val2 - val1, fraction), wrapped to 16 bits
+ *----------------------------------------------------------------------------
+*/
+static __m128i ChorusInterpolateSSE2(__m128i val1, __m128i val2, __m128i fraction)
+{
+    __m128i lo1 = _mm_mullo_epi16(val1, fraction);
+    __m128i hi1 = _mm_mulhi_epi16(val1, fraction);
+    __m128i lo2 = _mm_mullo_epi16(val2, fraction);
+    __m128i hi2 = _mm_mulhi_epi16(val2, fraction);
+
+    /* (val2 - val1) * fraction fits in 32 bits because fraction < 32768 */
+    __m128i diff0 = _mm_sub_epi32(_mm_unpacklo_epi16(lo2, hi2), _mm_unpacklo_epi16(lo1, hi1));
+    __m128i diff1 = _mm_sub_epi32(_mm_unpackhi_epi16(lo2, hi2), _mm_unpackhi_epi16(lo1, hi1));
+    diff0 = _mm_srai_epi32(diff0, NUM_EG1_FRAC_BITS);
+    diff1 = _mm_srai_epi32(diff1, NUM_EG1_FRAC_BITS);
+
+    /* truncate to 16 bits before packing, like the EAS_I16 casts */
+    diff0 = _mm_srai_epi32(_mm_slli_epi32(diff0, 16), 16);
+    diff1 = _mm_srai_epi32(_mm_slli_epi32(diff1, 16), 16);
+    return _mm_add_epi16(val1, _mm_packs_epi32(diff0, diff1));
+}
+
+/*----------------------------------------------------------------------------
+ * ChorusProcessSSE2()
+ *----------------------------------------------------------------------------
+ * Purpose: same as the scalar ChorusProcess() loops, for both channels
+ *----------------------------------------------------------------------------
+*/
+static void ChorusProcessSSE2 (S_CHORUS_OBJECT *pChorusData, EAS_PCM *pSrc, EAS_PCM *pDst, EAS_I32 numSamples)
+{
+    EAS_I16 val1[CHORUS_SIMD_BLOCK_FRAMES * NUM_OUTPUT_CHANNELS];
+    EAS_I16 val2[CHORUS_SIMD_BLOCK_FRAMES * NUM_OUTPUT_CHANNELS];
+    EAS_I16 fraction[CHORUS_SIMD_BLOCK_FRAMES * NUM_OUTPUT_CHANNELS];
+    int32_t position[CHORUS_SIMD_BLOCK_FRAMES * NUM_OUTPUT_CHANNELS];   /* EAS_I32 may be 64-bit */
+    const __m128i depth = _mm_set1_epi16(pChorusData->m_nDepth);
+    const __m128i level = _mm_set1_epi16(pChorusData->m_nLevel);
+    const __m128i tapPosition = _mm_set1_epi32(((EAS_I32)pChorusData->chorusTapPosition) << 16);
+    EAS_I32 numFrames;
+    EAS_I32 numValues;
+    EAS_I32 ix;
+    EAS_I16 lfoValue;
+    EAS_PCM tap;
+    EAS_I32 tempValue;
+
+    while (numSamples > 0)
+    {
+        numFrames = (numSamples < CHORUS_SIMD_BLOCK_FRAMES) ? numSamples : CHORUS_SIMD_BLOCK_FRAMES;
+        numValues = numFrames * NUM_OUTPUT_CHANNELS;
+
+        //fetch the lfo shape values and advance the lfo phases
+        for (ix = 0; ix < numFrames; ix++)
+        {
+            ChorusFetch(EAS_chorusShape, 0, pChorusData->lfoLPhase, CHORUS_SHAPE_SIZE,
+                        &val1[2*ix], &val2[2*ix], &fraction[2*ix]);
+            pChorusData->lfoLPhase += pChorusData->m_nRate;
+            while (pChorusData->lfoLPhase >= (CHORUS_SHAPE_SIZE<<16))
+            {
+                pChorusData->lfoLPhase -= (CHORUS_SHAPE_SIZE<<16);
+            }
+
+            ChorusFetch(EAS_chorusShape, 0, pChorusData->lfoRPhase, CHORUS_SHAPE_SIZE,
+                        &val1[2*ix+1], &val2[2*ix+1], &fraction[2*ix+1]);
+            pChorusData->lfoRPhase += pChorusData->m_nRate;
+            while (pChorusData->lfoRPhase >= (CHORUS_SHAPE_SIZE<<16))
+            {
+                pChorusData->lfoRPhase -= (CHORUS_SHAPE_SIZE<<16);
+            }
+        }
+
+        //interpolate the lfo and compute the fractional tap positions
+        for (ix = 0; ix + 8 <= numValues; ix += 8)
+        {
+            __m128i lfo = ChorusInterpolateSSE2(_mm_loadu_si128((const __m128i*) &val1[ix]),
+                                                _mm_loadu_si128((const __m128i*) &val2[ix]),
+                                                _mm_loadu_si128((const __m128i*) &fraction[ix]));
+            __m128i lo = _mm_mullo_epi16(lfo, depth);
+            __m128i hi = _mm_mulhi_epi16(lfo, depth);
+            _mm_storeu_si128((__m128i*) &position[ix],
+                             _mm_add_epi32(_mm_slli_epi32(_mm_unpacklo_epi16(lo, hi), 1), tapPosition));
+            _mm_storeu_si128((__m128i*) &position[ix+4],
+                             _mm_add_epi32(_mm_slli_epi32(_mm_unpackhi_epi16(lo, hi), 1), tapPosition));
+        }
+        for (; ix < numValues; ix++)
+        {
+            lfoValue = val1[ix] + (EAS_I16)MULT_EG1_EG1(val2[ix]-val1[ix],fraction[ix]);
+            /*lint -e{703} use shift for performance */
+            position[ix] = pChorusData->m_nDepth * (((EAS_I32)lfoValue) << 1);
+            position[ix] += ((EAS_I32)pChorusData->chorusTapPosition) << 16;
+        }
+
+        //feed the input into the delay lines and fetch the delayed values
+        for (ix = 0; ix < numFrames; ix++)
+        {
+            pChorusData->chorusDelayL[pChorusData->chorusIndexL] = pSrc[2*ix];
+            ChorusFetch(pChorusData->chorusDelayL, pChorusData->chorusIndexL, position[2*ix], CHORUS_L_SIZE,
+                        &val1[2*ix], &val2[2*ix], &fraction[2*ix]);
+            if ((pChorusData->chorusIndexL+=1) >= CHORUS_L_SIZE)
+                pChorusData->chorusIndexL = 0;
+
+            pChorusData->chorusDelayR[pChorusData->chorusIndexR] = pSrc[2*ix+1];
+            ChorusFetch(pChorusData->chorusDelayR, pChorusData->chorusIndexR, position[2*ix+1], CHORUS_R_SIZE,
+                        &val1[2*ix+1], &val2[2*ix+1], &fraction[2*ix+1]);
+            if ((pChorusData->chorusIndexR+=1) >= CHORUS_R_SIZE)
+                pChorusData->chorusIndexR = 0;
+        }
+
+        //interpolate the taps, scale by chorus level, sum with the input and saturate
+        for (ix = 0; ix + 8 <= numValues; ix += 8)
+        {
+            __m128i tapValue = ChorusInterpolateSSE2(_mm_loadu_si128((const __m128i*) &val1[ix]),
+                                                     _mm_loadu_si128((const __m128i*) &val2[ix]),
+                                                     _mm_loadu_si128((const __m128i*) &fraction[ix]));
+            __m128i input = _mm_loadu_si128((const __m128i*) &pSrc[ix]);
+            __m128i lo = _mm_mullo_epi16(tapValue, level);
+            __m128i hi = _mm_mulhi_epi16(tapValue, level);
+            __m128i sum0 = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), NUM_EG1_FRAC_BITS),
+                                         _mm_srai_epi32(_mm_unpacklo_epi16(input, input), 16));
+            __m128i sum1 = _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), NUM_EG1_FRAC_BITS),
+                                         _mm_srai_epi32(_mm_unpackhi_epi16(input, input), 16));
+            _mm_storeu_si128((__m128i*) &pDst[ix], _mm_packs_epi32(sum0, sum1));
+        }
+        for (; ix < numValues; ix++)
+        {
+            tap = val1[ix] + (EAS_I16)MULT_EG1_EG1(val2[ix]-val1[ix],fraction[ix]);
+            tempValue = MULT_EG1_EG1(tap, pChorusData->m_nLevel);
+            pDst[ix] = (EAS_I16)SATURATE(tempValue + pSrc[ix]);
+        }
+
+        pSrc += numValues;
+        pDst += numValues;
+        numSamples -= numFrames;
+    }
+}
+#endif
+
 /*----------------------------------------------------------------------------
  * ChorusProcess()
  *----------------------------------------------------------------------------
@@ -282,6 +499,14 @@ static void ChorusProcess (EAS_VOID_PTR pInstData, EAS_PCM *pSrc, EAS_PCM *pDst,
         ChorusUpdate(pChorusData);
     }
 
+#if defined(CHORUS_SIMD_SSE2)
+    if (chorusSimdEnabled)
+    {
+        ChorusProcessSSE2(pChorusData, pSrc, pDst, numSamples);
+        return;
+    }
+#endif
+
     for (nChannelNumber = 0; nChannelNumber < NUM_OUTPUT_CHANNELS; nChannelNumber++)
     {
 
@@ -59,6 +59,119 @@ const S_EFFECTS_INTERFACE EAS_Reverb =
     ReverbSetParam
 };
 
+/*----------------------------------------------------------------------------
+ * SIMD mixer
+ *----------------------------------------------------------------------------
+ * The late reverb network is recursive sample by sample and always runs
+ * in scalar code. When the early reflections are silent (all their gains
+ * and filter states are zero, which is the case for every built-in room)
+ * the late output of the whole buffer is collected first and then scaled
+ * by the wet level and mixed into the output with SSE2 intrinsics.
+ * The results are bit-exact with the scalar code.
+ * The SIMD mixer can be disabled at run time with ReverbEnableSIMD().
+ *----------------------------------------------------------------------------
+*/
+#if defined(_SIMD_KERNELS) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define REVERB_SIMD_SSE2
+#endif
+
+#define REVERB_SIMD_MAX_FRAMES      256
+
+static EAS_BOOL reverbSimdEnabled = EAS_TRUE;
+
+/*----------------------------------------------------------------------------
+ * ReverbEnableSIMD
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Selects the SIMD or the scalar mixer. Returns the previous setting.
+ *----------------------------------------------------------------------------
+*/
+EAS_BOOL ReverbEnableSIMD (EAS_BOOL enable)
+{
+    EAS_BOOL previous = reverbSimdEnabled;
+    reverbSimdEnabled = enable;
+    return previous;
+}
+
+/*----------------------------------------------------------------------------
+ * ReverbSIMDEnabled
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Returns EAS_TRUE if the SIMD mixer is built and enabled.
+ *----------------------------------------------------------------------------
+*/
+EAS_BOOL ReverbSIMDEnabled (void)
+{
+#if defined(REVERB_SIMD_SSE2)
+    return reverbSimdEnabled;
+#else
+    return EAS_FALSE;
+#endif
+}
+
+#if defined(REVERB_SIMD_SSE2)
+/*----------------------------------------------------------------------------
+ * ReverbEarlySilent
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Returns EAS_TRUE if the early reflection generators produce no output,
+ * so they can be skipped without changing the result.
+ *----------------------------------------------------------------------------
+*/
+static EAS_BOOL ReverbEarlySilent (const S_REVERB_OBJECT *pReverbData)
+{
+    EAS_INT j;
+
+    if (pReverbData->m_sEarlyL.m_zLpf != 0 || pReverbData->m_sEarlyR.m_zLpf != 0)
+        return EAS_FALSE;
+
+    for (j = 0; j < REVERB_MAX_NUM_REFLECTIONS; j++)
+    {
+        if (pReverbData->m_sEarlyL.m_nGain[j] != 0 || pReverbData->m_sEarlyR.m_nGain[j] != 0)
+            return EAS_FALSE;
+    }
+    return EAS_TRUE;
+}
+
+/*----------------------------------------------------------------------------
+ * ReverbMixSSE2
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Scales the late reverb output by the wet level and sums it with the
+ * output buffer, saturating. Same arithmetic as the scalar code:
+ * MULT_EG1_EG1(late, wet << 1) == (late * wet) >> 14
+ *----------------------------------------------------------------------------
+*/
+static void ReverbMixSSE2 (EAS_PCM *pOutputBuffer, const EAS_PCM *pLate, EAS_I16 nWet, EAS_I32 numValues)
+{
+    const __m128i wet = _mm_set1_epi16(nWet);
+    EAS_I32 tempValue;
+    EAS_I32 i;
+
+    for (i = 0; i + 8 <= numValues; i += 8)
+    {
+        __m128i late = _mm_loadu_si128((const __m128i*) (pLate + i));
+        __m128i out = _mm_loadu_si128((const __m128i*) (pOutputBuffer + i));
+        __m128i lo = _mm_mullo_epi16(late, wet);
+        __m128i hi = _mm_mulhi_epi16(late, wet);
+        __m128i sum0 = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 14),
+                                     _mm_srai_epi32(_mm_unpacklo_epi16(out, out), 16));
+        __m128i sum1 = _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 14),
+                                     _mm_srai_epi32(_mm_unpackhi_epi16(out, out), 16));
+        _mm_storeu_si128((__m128i*) (pOutputBuffer + i), _mm_packs_epi32(sum0, sum1));
+    }
+
+    for (; i < numValues; i++)
+    {
+        /*lint -e{701} use shift for performance */
+        tempValue = MULT_EG1_EG1(pLate[i], (nWet << 1));
+        tempValue += pOutputBuffer[i];
+        pOutputBuffer[i] = (EAS_PCM) SATURATE(tempValue);
+    }
+}
+#endif
+
 
 
 /*----------------------------------------------------------------------------
@@ -540,6 +653,14 @@ static EAS_RESULT Reverb(S_REVERB_OBJECT *pReverbData, EAS_INT nNumSamplesToAdd,
     EAS_I32 tempValue;
 
 
+#if defined(REVERB_SIMD_SSE2)
+    EAS_PCM late[REVERB_SIMD_MAX_FRAMES * NUM_OUTPUT_CHANNELS];
+    EAS_PCM *pLate = NULL;
+
+    if (reverbSimdEnabled && (nNumSamplesToAdd <= REVERB_SIMD_MAX_FRAMES) && ReverbEarlySilent(pReverbData))
+        pLate = late;
+#endif
+
     // get the base address
     nBase = pReverbData->m_nBaseIndex;
 
@@ -672,6 +793,22 @@ static EAS_RESULT Reverb(S_REVERB_OBJECT *pReverbData, EAS_INT nNumSamplesToAdd,
 
         // ********** mixer and feedback - end
 
+#if defined(REVERB_SIMD_SSE2)
+        if (pLate != NULL)
+        {
+            // early reflections are silent, the late output is mixed after the loop
+            *pLate++ = pReverbData->m_nRevOutFbkL;
+            *pLate++ = pReverbData->m_nRevOutFbkR;
+
+            // decrement base addr for next sample period
+            nBase--;
+
+            pReverbData->m_nSin += pReverbData->m_nSinIncrement;
+            pReverbData->m_nCos += pReverbData->m_nCosIncrement;
+            continue;
+        }
+#endif
+
         // ********** start early reflection generator, left
         //psEarly = &(pReverbData->m_sEarlyL);
 
@@ -769,6 +906,11 @@ static EAS_RESULT Reverb(S_REVERB_OBJECT *pReverbData, EAS_INT nNumSamplesToAdd,
     // store the most up to date version
     pReverbData->m_nBaseIndex = nBase;
 
+#if defined(REVERB_SIMD_SSE2)
+    if (pLate != NULL)
+        ReverbMixSSE2(pOutputBuffer, late, pReverbData->m_nWet, nNumSamplesToAdd * NUM_OUTPUT_CHANNELS);
+#endif
+
     return EAS_SUCCESS;
 }   /* end Reverb */
 
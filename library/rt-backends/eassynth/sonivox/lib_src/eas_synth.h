@@ -323,8 +323,8 @@ typedef struct s_synth_tag
     EAS_U16                 numActiveVoices;
     EAS_U16                 masterVolume;
     EAS_U8                  channelsByPriority[NUM_SYNTH_CHANNELS];
-    EAS_U8                  poolCount[NUM_SYNTH_CHANNELS];
-    EAS_U8                  poolAlloc[NUM_SYNTH_CHANNELS];
+    EAS_U16                 poolCount[NUM_SYNTH_CHANNELS];
+    EAS_U16                 poolAlloc[NUM_SYNTH_CHANNELS];
     EAS_U8                  synthFlags;
     EAS_I8                  globalTranspose;
     EAS_U8                  vSynthNum;
@@ -384,6 +384,9 @@ typedef struct s_voice_mgr_tag
 
     EAS_U16                 age;
 
+    /* voices stolen since initialization */
+    EAS_U32                 stolenVoices;
+
 /* limits the number of voice starts in a frame for split architecture */
 #ifdef MAX_VOICE_STARTS
     EAS_U16                 numVoiceStarts;
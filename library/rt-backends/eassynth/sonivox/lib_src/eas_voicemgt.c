@@ -388,7 +388,7 @@ EAS_RESULT VMInitMIDI (S_EAS_DATA *pEASData, S_SYNTH **ppSynth)
     pSynth->masterVolume = DEFAULT_SYNTH_MASTER_VOLUME;
     pSynth->refCount = 1;
     pSynth->priority = DEFAULT_SYNTH_PRIORITY;
-    pSynth->poolAlloc[0] = (EAS_U8) pEASData->pVoiceMgr->maxPolyphony;
+    pSynth->poolAlloc[0] = (EAS_U16) pEASData->pVoiceMgr->maxPolyphony;
 
     VMInitializeAllChannels(pEASData->pVoiceMgr, pSynth);
 
@@ -469,9 +469,9 @@ void VMReset (S_VOICE_MGR *pVoiceMgr, S_SYNTH *pSynth, EAS_BOOL force)
 
         /* set polyphony */
         if (pSynth->maxPolyphony < pVoiceMgr->maxPolyphony)
-            pSynth->poolAlloc[0] = (EAS_U8) pVoiceMgr->maxPolyphony;
+            pSynth->poolAlloc[0] = (EAS_U16) pVoiceMgr->maxPolyphony;
         else
-            pSynth->poolAlloc[0] = (EAS_U8) pSynth->maxPolyphony;
+            pSynth->poolAlloc[0] = (EAS_U16) pSynth->maxPolyphony;
 
         /* clear reset flag */
         pSynth->synthFlags &= ~SYNTH_FLAG_RESET_IS_REQUESTED;
@@ -842,7 +842,7 @@ void VMUpdateMIPTable (S_VOICE_MGR *pVoiceMgr, S_SYNTH *pSynth)
         else
         {
             currentPool++;
-            pSynth->poolAlloc[currentPool] = (EAS_U8) (pChannel->mip - currentMIP);
+            pSynth->poolAlloc[currentPool] = (EAS_U16) (pChannel->mip - currentMIP);
             currentMIP = pChannel->mip;
         }
     }
@@ -2116,6 +2116,7 @@ EAS_RESULT VMStealVoice (S_VOICE_MGR *pVoiceMgr, S_SYNTH *pSynth, EAS_INT *pVoic
     }
 #endif
 
+    pVoiceMgr->stolenVoices++;
     *pVoiceNumber = (EAS_U16) bestCandidate;
     return EAS_SUCCESS;
 }
@@ -3092,7 +3093,7 @@ EAS_RESULT VMSetSynthPolyphony (S_VOICE_MGR *pVoiceMgr, EAS_I32 synth, EAS_I32 p
             if (pVoiceMgr->pSynth[i]->synthFlags & SYNTH_FLAG_SP_MIDI_ON)
                 VMMIPUpdateChannelMuting(pVoiceMgr, pVoiceMgr->pSynth[i]);
             else
-                pVoiceMgr->pSynth[i]->poolAlloc[0] = (EAS_U8) polyphonyCount;
+                pVoiceMgr->pSynth[i]->poolAlloc[0] = (EAS_U16) polyphonyCount;
         }
     }
 
@@ -3262,7 +3263,7 @@ EAS_RESULT VMSetPolyphony (S_VOICE_MGR *pVoiceMgr, S_SYNTH *pSynth, EAS_I32 poly
     if (pSynth->synthFlags & SYNTH_FLAG_SP_MIDI_ON)
         VMMIPUpdateChannelMuting(pVoiceMgr, pSynth);
     else
-        pSynth->poolAlloc[0] = (EAS_U8) polyphonyCount;
+        pSynth->poolAlloc[0] = (EAS_U16) polyphonyCount;
 
     /* are we under polyphony limit? */
     if (pSynth->numActiveVoices <= polyphonyCount)
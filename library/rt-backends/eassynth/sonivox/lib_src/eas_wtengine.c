@@ -60,6 +60,213 @@ extern void WT_Interpolate (S_WT_VOICE *pWTVoice, S_WT_INT_FRAME *pWTIntFrame);
 extern void WT_VoiceFilter (S_FILTER_CONTROL*pFilter, S_WT_INT_FRAME *pWTIntFrame);
 #endif
 
+/*----------------------------------------------------------------------------
+ * SIMD kernels
+ *----------------------------------------------------------------------------
+ * When _SIMD_KERNELS is defined and the target has SSE2, the interpolators
+ * and the voice gain process the bulk of each frame with SSE2 intrinsics.
+ * The results are bit-exact with the scalar code, which still processes
+ * the remaining samples, the loop wrap points and any unusual input.
+ * The SIMD kernels can be disabled at run time with WT_EnableSIMD().
+ *----------------------------------------------------------------------------
+*/
+#if defined(_SIMD_KERNELS) && (defined(__SSE2__) || defined(_M_X64))
+#include <string.h>
+#include <emmintrin.h>
+#define WT_SIMD_SSE2
+#endif
+
+#define WT_SIMD_INTERPOLATE_BLOCK   8
+#define WT_SIMD_GAIN_BLOCK          4
+
+static EAS_BOOL wtSimdEnabled = EAS_TRUE;
+
+/*----------------------------------------------------------------------------
+ * WT_EnableSIMD
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Selects the SIMD or the scalar kernels. Returns the previous setting.
+ *----------------------------------------------------------------------------
+*/
+EAS_BOOL WT_EnableSIMD (EAS_BOOL enable)
+{
+    EAS_BOOL previous = wtSimdEnabled;
+    wtSimdEnabled = enable;
+    return previous;
+}
+
+/*----------------------------------------------------------------------------
+ * WT_SIMDEnabled
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Returns EAS_TRUE if the SIMD kernels are built and enabled.
+ *----------------------------------------------------------------------------
+*/
+EAS_BOOL WT_SIMDEnabled (void)
+{
+#if defined(WT_SIMD_SSE2)
+    return wtSimdEnabled;
+#else
+    return EAS_FALSE;
+#endif
+}
+
+#if defined(WT_SIMD_SSE2)
+/*----------------------------------------------------------------------------
+ * WT_LoadPairSSE2
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Returns the pair of adjacent samples at the given phase, as the low and
+ * high halves of a 32 bit value.
+ *----------------------------------------------------------------------------
+*/
+static int WT_LoadPairSSE2 (const EAS_SAMPLE *pSamples, EAS_I32 phase)
+{
+    /*lint -e{704} <avoid divide>*/
+    const EAS_SAMPLE *p = pSamples + (phase >> NUM_PHASE_FRAC_BITS);
+#if defined(_8_BIT_SAMPLES)
+    /*lint -e{701} <avoid multiply for performance>*/
+    return (int)((EAS_U16)(p[0] << 8) | ((EAS_U32)(EAS_U16)(p[1] << 8) << 16));
+#else
+    EAS_I32 pair = 0;
+    memcpy(&pair, p, 2 * sizeof(EAS_SAMPLE));
+    return (int) pair;
+#endif
+}
+
+/*----------------------------------------------------------------------------
+ * WT_InterpolateBlockSSE2
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Computes WT_SIMD_INTERPOLATE_BLOCK interpolated samples starting at the
+ * given phase, without loop wrapping.
+ *
+ * The scalar code computes s1 + ((s2 - s1) * f >> 15), which is equal to
+ * (s1 * (32767 - f) + s2 * f + s1) >> 15. The weighted sum is computed by
+ * pmaddwd on (s1, s2) and (32767 - f, f) pairs of 16 bit values.
+ *----------------------------------------------------------------------------
+*/
+static void WT_InterpolateBlockSSE2 (EAS_PCM *pOutputBuffer, const EAS_SAMPLE *pSamples, EAS_I32 phaseFrac, EAS_I32 phaseInc)
+{
+    __m128i phase, step, fracMask, frac, weights, samp, acc, result[2];
+    int i;
+
+    fracMask = _mm_set1_epi32(PHASE_FRAC_MASK);
+    phase = _mm_set_epi32((int)(phaseFrac + 3 * phaseInc), (int)(phaseFrac + 2 * phaseInc),
+                          (int)(phaseFrac + phaseInc), (int) phaseFrac);
+    step = _mm_set1_epi32((int)(4 * phaseInc));
+
+    for (i = 0; i < 2; i++)
+    {
+        samp = _mm_set_epi32(WT_LoadPairSSE2(pSamples, phaseFrac + 3 * phaseInc),
+                             WT_LoadPairSSE2(pSamples, phaseFrac + 2 * phaseInc),
+                             WT_LoadPairSSE2(pSamples, phaseFrac + phaseInc),
+                             WT_LoadPairSSE2(pSamples, phaseFrac));
+        frac = _mm_and_si128(phase, fracMask);
+        weights = _mm_or_si128(_mm_sub_epi32(fracMask, frac), _mm_slli_epi32(frac, 16));
+        acc = _mm_madd_epi16(samp, weights);
+        acc = _mm_add_epi32(acc, _mm_srai_epi32(_mm_slli_epi32(samp, 16), 16));
+        result[i] = _mm_srai_epi32(acc, NUM_PHASE_FRAC_BITS + 2);
+        phase = _mm_add_epi32(phase, step);
+        phaseFrac += 4 * phaseInc;
+    }
+
+    _mm_storeu_si128((__m128i *) pOutputBuffer, _mm_packs_epi32(result[0], result[1]));
+}
+
+#if (NUM_OUTPUT_CHANNELS == 2)
+/*----------------------------------------------------------------------------
+ * WT_MultiplySSE2
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Multiplies 32 bit lanes in the range [-65536, 65535] by a 16 bit gain
+ * (in the low half of each lane), with pmaddwd on the 15 low bits and the
+ * high bits separately. The product must fit in 32 bits.
+ *----------------------------------------------------------------------------
+*/
+static __m128i WT_MultiplySSE2 (__m128i value, __m128i gain)
+{
+    __m128i low = _mm_and_si128(value, _mm_set1_epi32(0x7fff));
+    __m128i high = _mm_and_si128(_mm_srai_epi32(value, 15), _mm_set1_epi32(0xffff));
+    return _mm_add_epi32(_mm_madd_epi16(low, gain), _mm_slli_epi32(_mm_madd_epi16(high, gain), 15));
+}
+
+/*----------------------------------------------------------------------------
+ * WT_AccumulateSSE2
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Adds four interleaved 32 bit samples to the mix buffer, which is 64 bits
+ * wide where EAS_I32 is a long on LP64 targets.
+ *----------------------------------------------------------------------------
+*/
+static void WT_AccumulateSSE2 (EAS_I32 *pMixBuffer, __m128i value)
+{
+    __m128i *pMix = (__m128i *) pMixBuffer;
+    __m128i sign;
+
+    if (sizeof(EAS_I32) == 4)
+    {
+        _mm_storeu_si128(pMix, _mm_add_epi32(_mm_loadu_si128(pMix), value));
+        return;
+    }
+    sign = _mm_srai_epi32(value, 31);
+    _mm_storeu_si128(pMix, _mm_add_epi64(_mm_loadu_si128(pMix), _mm_unpacklo_epi32(value, sign)));
+    pMix++;
+    _mm_storeu_si128(pMix, _mm_add_epi64(_mm_loadu_si128(pMix), _mm_unpackhi_epi32(value, sign)));
+}
+
+/*----------------------------------------------------------------------------
+ * WT_VoiceGainSSE2
+ *----------------------------------------------------------------------------
+ * Purpose:
+ * Applies the gain ramp and the left and right gains to blocks of
+ * WT_SIMD_GAIN_BLOCK samples. Returns the number of samples processed.
+ *
+ * The ramp stays within 16 bits of integer part, so all the products of
+ * the scalar code fit in 32 bit lanes.
+ *----------------------------------------------------------------------------
+*/
+static EAS_I32 WT_VoiceGainSSE2 (S_WT_VOICE *pWTVoice, S_WT_INT_FRAME *pWTIntFrame, EAS_I32 *pGain, EAS_I32 gainIncrement)
+{
+    EAS_I32 *pMixBuffer = pWTIntFrame->pMixBuffer;
+    const EAS_PCM *pInputBuffer = pWTIntFrame->pAudioBuffer;
+    EAS_I32 numBlocks = pWTIntFrame->numSamples / WT_SIMD_GAIN_BLOCK;
+    EAS_I32 gain = *pGain;
+    __m128i gains, step, mask, input, left, right, tmp;
+
+    mask = _mm_set1_epi32(0xffff);
+    gains = _mm_set_epi32((int)(gain + 4 * gainIncrement), (int)(gain + 3 * gainIncrement),
+                          (int)(gain + 2 * gainIncrement), (int)(gain + gainIncrement));
+    step = _mm_set1_epi32((int)(WT_SIMD_GAIN_BLOCK * gainIncrement));
+    left = _mm_set1_epi32(pWTVoice->gainLeft & 0xffff);
+    right = _mm_set1_epi32(pWTVoice->gainRight & 0xffff);
+
+    while (numBlocks--)
+    {
+        /* scale samples by the 16 bit integer part of the gain ramp */
+        input = _mm_loadl_epi64((const __m128i *) pInputBuffer);
+        input = _mm_and_si128(_mm_unpacklo_epi16(input, input), mask);
+        tmp = _mm_and_si128(_mm_srai_epi32(gains, 16), mask);
+        tmp = _mm_srai_epi32(_mm_madd_epi16(tmp, input), 14);
+
+        /* left and right channels, interleaved */
+        input = _mm_srai_epi32(WT_MultiplySSE2(tmp, left), NUM_MIXER_GUARD_BITS);
+        tmp = _mm_srai_epi32(WT_MultiplySSE2(tmp, right), NUM_MIXER_GUARD_BITS);
+        WT_AccumulateSSE2(pMixBuffer, _mm_unpacklo_epi32(input, tmp));
+        WT_AccumulateSSE2(pMixBuffer + 4, _mm_unpackhi_epi32(input, tmp));
+
+        gains = _mm_add_epi32(gains, step);
+        pInputBuffer += WT_SIMD_GAIN_BLOCK;
+        pMixBuffer += 2 * WT_SIMD_GAIN_BLOCK;
+    }
+
+    numBlocks = pWTIntFrame->numSamples / WT_SIMD_GAIN_BLOCK;
+    *pGain = gain + numBlocks * WT_SIMD_GAIN_BLOCK * gainIncrement;
+    return numBlocks * WT_SIMD_GAIN_BLOCK;
+}
+#endif
+#endif
+
 #if defined(_OPTIMIZED_MONO) || !defined(NATIVE_EAS_KERNEL) || defined(_16_BIT_SAMPLES)
 /*----------------------------------------------------------------------------
  * WT_VoiceGain
@@ -111,6 +318,18 @@ void WT_VoiceGain (S_WT_VOICE *pWTVoice, S_WT_INT_FRAME *pWTIntFrame)
     gainRight = pWTVoice->gainRight;
 #endif
 
+#if defined(WT_SIMD_SSE2) && (NUM_OUTPUT_CHANNELS == 2)
+    if (wtSimdEnabled &&
+        (pWTIntFrame->prevGain >= -32767) && (pWTIntFrame->prevGain <= 32767) &&
+        (pWTIntFrame->frame.gainTarget >= -32767) && (pWTIntFrame->frame.gainTarget <= 32767))
+    {
+        tmp0 = WT_VoiceGainSSE2(pWTVoice, pWTIntFrame, &gain, gainIncrement);
+        numSamples -= tmp0;
+        pInputBuffer += tmp0;
+        pMixBuffer += 2 * tmp0;
+    }
+#endif
+
     while (numSamples--) {
 
         /* incremental gain step to prevent zipper noise */
@@ -214,6 +433,36 @@ void WT_Interpolate (S_WT_VOICE *pWTVoice, S_WT_INT_FRAME *pWTIntFrame)
     samp2 = pSamples[1];
 #endif
 
+#if defined(WT_SIMD_SSE2)
+    /* blocks of samples without loop wrap */
+    if (wtSimdEnabled && (phaseInc >= 0))
+    {
+        while ((numSamples >= WT_SIMD_INTERPOLATE_BLOCK) &&
+               (phaseFrac >= 0) && (phaseFrac <= (EAS_I32) PHASE_FRAC_MASK))
+        {
+            acc0 = phaseFrac + WT_SIMD_INTERPOLATE_BLOCK * phaseInc;
+            /*lint -e{704} <avoid divide>*/
+            if (pSamples + (acc0 >> NUM_PHASE_FRAC_BITS) >= loopEnd)
+                break;
+            WT_InterpolateBlockSSE2(pOutputBuffer, pSamples, phaseFrac, phaseInc);
+            pOutputBuffer += WT_SIMD_INTERPOLATE_BLOCK;
+            numSamples -= WT_SIMD_INTERPOLATE_BLOCK;
+            /*lint -e{704} <avoid divide>*/
+            pSamples += acc0 >> NUM_PHASE_FRAC_BITS;
+            phaseFrac = (EAS_I32)((EAS_U32)acc0 & PHASE_FRAC_MASK);
+        }
+#if defined(_8_BIT_SAMPLES)
+        /*lint -e{701} <avoid multiply for performance>*/
+        samp1 = pSamples[0] << 8;
+        /*lint -e{701} <avoid multiply for performance>*/
+        samp2 = pSamples[1] << 8;
+#else
+        samp1 = pSamples[0];
+        samp2 = pSamples[1];
+#endif
+    }
+#endif
+
     while (numSamples--) {
 
         /* linear interpolation */
@@ -310,6 +559,32 @@ void WT_InterpolateNoLoop (S_WT_VOICE *pWTVoice, S_WT_INT_FRAME *pWTIntFrame)
     samp2 = pSamples[1];
 #endif
 
+#if defined(WT_SIMD_SSE2)
+    if (wtSimdEnabled && (phaseInc >= 0))
+    {
+        while ((numSamples >= WT_SIMD_INTERPOLATE_BLOCK) &&
+               (phaseFrac >= 0) && (phaseFrac <= (EAS_I32) PHASE_FRAC_MASK))
+        {
+            acc0 = phaseFrac + WT_SIMD_INTERPOLATE_BLOCK * phaseInc;
+            WT_InterpolateBlockSSE2(pOutputBuffer, pSamples, phaseFrac, phaseInc);
+            pOutputBuffer += WT_SIMD_INTERPOLATE_BLOCK;
+            numSamples -= WT_SIMD_INTERPOLATE_BLOCK;
+            /*lint -e{704} <avoid divide>*/
+            pSamples += acc0 >> NUM_PHASE_FRAC_BITS;
+            phaseFrac = (EAS_I32)((EAS_U32)acc0 & PHASE_FRAC_MASK);
+        }
+#if defined(_8_BIT_SAMPLES)
+        /*lint -e{701} <avoid multiply for performance>*/
+        samp1 = pSamples[0] << 8;
+        /*lint -e{701} <avoid multiply for performance>*/
+        samp2 = pSamples[1] << 8;
+#else
+        samp1 = pSamples[0];
+        samp2 = pSamples[1];
+#endif
+    }
+#endif
+
     while (numSamples--) {
 
 
@@ -162,6 +162,8 @@ typedef struct s_wt_voice_tag
 */
 EAS_BOOL WT_CheckSampleEnd (S_WT_VOICE *pWTVoice, S_WT_INT_FRAME *pWTIntFrame, EAS_BOOL update);
 void WT_ProcessVoice (S_WT_VOICE *pWTVoice, S_WT_INT_FRAME *pWTIntFrame);
+EAS_BOOL WT_EnableSIMD (EAS_BOOL enable);
+EAS_BOOL WT_SIMDEnabled (void);
 
 #ifdef EAS_SPLIT_WT_SYNTH
 void WTE_ConfigVoice (EAS_I32 voiceNum, S_WT_CONFIG *pWTConfig, EAS_FRAME_BUFFER_HANDLE pFrameBuffer);
@@ -0,0 +1,13 @@
+# Sonivox EAS build profile, shared by the library and the rendering code.
+# Override on the qmake command line: qmake EAS_OUTPUT_RATE=48000 EAS_MAX_VOICES=256
+isEmpty(EAS_OUTPUT_RATE): EAS_OUTPUT_RATE = 22050
+isEmpty(EAS_MAX_VOICES): EAS_MAX_VOICES = 64
+!contains(EAS_OUTPUT_RATE, 22050|44100|48000) {
+    error("EAS_OUTPUT_RATE must be 22050, 44100 or 48000")
+}
+lessThan(EAS_MAX_VOICES, 16)|greaterThan(EAS_MAX_VOICES, 256) {
+    error("EAS_MAX_VOICES must be between 16 and 256")
+}
+# output resampling rate: the engine still renders at 22050 Hz, and the
+# rendering code resamples its output to this rate
+DEFINES += EAS_OUTPUT_RATE=$$EAS_OUTPUT_RATE
@@ -11,6 +11,7 @@ QMAKE_CFLAGS_WARN_ON += -Wno-unused-parameter -Wno-unused-value -Wno-unused-vari
 
 TARGET = sonivox
 TEMPLATE = lib
+include (sonivox.pri)
 DESTDIR = ../../../../build/lib
 VERSION = 3.6.10
 CONFIG += staticlib \
@@ -27,12 +28,13 @@ DEFINES += \
 #	_XMF_PARSER \
 	NUM_OUTPUT_CHANNELS=2 \
         _SAMPLE_RATE_22050 \
-	MAX_SYNTH_VOICES=64 \
+	MAX_SYNTH_VOICES=$$EAS_MAX_VOICES \
 	_16_BIT_SAMPLES \
 	_FILTER_ENABLED \
         DLS_SYNTHESIZER \
 	_REVERB_ENABLED \
-	_CHORUS_ENABLED
+	_CHORUS_ENABLED \
+	_SIMD_KERNELS
 
 TARGET = sonivox
 INCLUDEPATH += host_src lib_src
@@ -0,0 +1,129 @@
+/*
+    Sonivox EAS Synthesizer for Qt applications
+    Copyright (C) 2016-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include "audioringbuffer.h"
+
+namespace drumstick {
+namespace rt {
+
+AudioRingBuffer::AudioRingBuffer(int frames, int channels) :
+    m_channels(1),
+    m_capacity(0),
+    m_readPosition(0),
+    m_writePosition(0)
+{
+    resize(frames, channels);
+}
+
+/*
+ * Not thread safe: neither the producer nor the consumer may be running.
+ */
+void
+AudioRingBuffer::resize(int frames, int channels)
+{
+    quint32 capacity = 0;
+    if (frames > 0) {
+        capacity = 1;
+        while (capacity < quint32(frames)) {
+            capacity <<= 1;
+        }
+    }
+    m_channels = qMax(1, channels);
+    m_capacity = capacity;
+    m_buffer.fill(0, int(capacity) * m_channels);
+    clear();
+}
+
+void
+AudioRingBuffer::clear()
+{
+    m_readPosition.store(0);
+    m_writePosition.store(0);
+}
+
+int
+AudioRingBuffer::capacity() const
+{
+    return int(m_capacity);
+}
+
+int
+AudioRingBuffer::channels() const
+{
+    return m_channels;
+}
+
+int
+AudioRingBuffer::readAvailable() const
+{
+    return int(m_writePosition.loadAcquire() - m_readPosition.loadAcquire());
+}
+
+int
+AudioRingBuffer::writeAvailable() const
+{
+    return int(m_capacity) - readAvailable();
+}
+
+/*
+ * Producer side: copies up to frames frames, and returns the number of
+ * frames stored, which is less than requested when the ring is full.
+ */
+int
+AudioRingBuffer::write(const qint16 *data, int frames)
+{
+    const quint32 writePosition = m_writePosition.load();
+    const quint32 used = writePosition - m_readPosition.loadAcquire();
+    const quint32 count = qMin(quint32(qMax(frames, 0)), m_capacity - used);
+    if (count == 0) {
+        return 0;
+    }
+    const quint32 offset = writePosition & (m_capacity - 1);
+    const quint32 first = qMin(count, m_capacity - offset);
+    qint16 *buffer = m_buffer.data();
+    std::memcpy(buffer + offset * m_channels, data, sizeof(qint16) * first * m_channels);
+    std::memcpy(buffer, data + first * m_channels, sizeof(qint16) * (count - first) * m_channels);
+    m_writePosition.storeRelease(writePosition + count);
+    return int(count);
+}
+
+/*
+ * Consumer side: copies up to frames frames, and returns the number of
+ * frames read, which is less than requested when the ring runs dry.
+ */
+int
+AudioRingBuffer::read(qint16 *data, int frames)
+{
+    const quint32 readPosition = m_readPosition.load();
+    const quint32 available = m_writePosition.loadAcquire() - readPosition;
+    const quint32 count = qMin(quint32(qMax(frames, 0)), available);
+    if (count == 0) {
+        return 0;
+    }
+    const quint32 offset = readPosition & (m_capacity - 1);
+    const quint32 first = qMin(count, m_capacity - offset);
+    const qint16 *buffer = m_buffer.constData();
+    std::memcpy(data, buffer + offset * m_channels, sizeof(qint16) * first * m_channels);
+    std::memcpy(data + first * m_channels, buffer, sizeof(qint16) * (count - first) * m_channels);
+    m_readPosition.storeRelease(readPosition + count);
+    return int(count);
+}
+
+} // namespace rt
+} // namespace drumstick
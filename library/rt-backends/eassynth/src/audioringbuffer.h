@@ -0,0 +1,57 @@
+/*
+    Sonivox EAS Synthesizer for Qt applications
+    Copyright (C) 2016-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIORINGBUFFER_H_
+#define AUDIORINGBUFFER_H_
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+#include <QVector>
+
+namespace drumstick { namespace rt {
+
+/*
+ * Lock-free ring of interleaved 16 bit audio frames, for one producer
+ * thread and one consumer thread. The capacity is rounded up to a power
+ * of two, and the read and write positions are free running counters,
+ * so a full ring and an empty ring can be told apart.
+ */
+class AudioRingBuffer
+{
+public:
+    explicit AudioRingBuffer(int frames = 0, int channels = 2);
+    void resize(int frames, int channels);
+    void clear();
+    int capacity() const;
+    int channels() const;
+    int readAvailable() const;
+    int writeAvailable() const;
+    int write(const qint16 *data, int frames);
+    int read(qint16 *data, int frames);
+
+private:
+    QVector<qint16> m_buffer;
+    int m_channels;
+    quint32 m_capacity;
+    QAtomicInteger<quint32> m_readPosition;
+    QAtomicInteger<quint32> m_writePosition;
+};
+
+}}
+
+#endif /*AUDIORINGBUFFER_H_*/
@@ -0,0 +1,308 @@
+/*
+    Sonivox EAS Synthesizer for Qt applications
+    Copyright (C) 2016-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+#include <drumstick/qsmf.h>
+#include "offlinerenderer.h"
+
+namespace drumstick {
+namespace rt {
+
+OfflineRenderer::OfflineRenderer(QObject *parent) : QObject(parent),
+    m_sorted(true),
+    m_channelMask(0xffff),
+    m_tailTime(2000)
+{ }
+
+OfflineRenderer::~OfflineRenderer()
+{ }
+
+void
+OfflineRenderer::initialize(QSettings *settings)
+{
+    m_synth.initialize(settings);
+}
+
+SynthRenderer *
+OfflineRenderer::synth()
+{
+    return &m_synth;
+}
+
+int
+OfflineRenderer::sampleRate() const
+{
+    return m_synth.sampleRate();
+}
+
+int
+OfflineRenderer::channels() const
+{
+    return m_synth.channels();
+}
+
+void
+OfflineRenderer::clear()
+{
+    m_messages.clear();
+    m_sorted = true;
+    m_errorString.clear();
+}
+
+/*
+ * Only the messages of the channels in the mask (bit 0 is channel 0) are
+ * added afterwards, so a channel group of a file can be rendered alone.
+ */
+void
+OfflineRenderer::setChannelMask(quint16 mask)
+{
+    m_channelMask = mask;
+}
+
+quint16
+OfflineRenderer::channelMask() const
+{
+    return m_channelMask;
+}
+
+/*
+ * Message timestamps are frame numbers relative to the start of the
+ * rendering, and may be added in any order.
+ */
+void
+OfflineRenderer::addMessage(qint64 frame, int m0, int m1, int m2)
+{
+    if ((m_channelMask & (1 << (m0 & 0x0f))) == 0) {
+        return;
+    }
+    OfflineMessage msg;
+    msg.frame = qMax<qint64>(frame, 0);
+    switch (m0 & MIDI_STATUS_MASK) {
+    case MIDI_STATUS_PROGRAMCHANGE:
+    case MIDI_STATUS_CHANNELPRESSURE:
+        msg.length = 2;
+        break;
+    default:
+        msg.length = 3;
+    }
+    msg.data[0] = static_cast<quint8>(m0);
+    msg.data[1] = static_cast<quint8>(m1);
+    msg.data[2] = static_cast<quint8>(m2);
+    if (!m_messages.isEmpty() && m_messages.last().frame > msg.frame) {
+        m_sorted = false;
+    }
+    m_messages.append(msg);
+}
+
+/*
+ * Appends the channel messages of a Standard MIDI File. QSmf reports the
+ * real time of each event following the tempo map, in 1/1600 seconds.
+ * System exclusive messages are ignored.
+ */
+bool
+OfflineRenderer::loadSMF(const QString &fileName)
+{
+    File::QSmf smf;
+    const int rate = m_synth.sampleRate();
+    auto frame = [&smf, rate]() {
+        return qint64(smf.getRealTime()) * rate / 1600;
+    };
+    m_errorString.clear();
+    if (!QFileInfo::exists(fileName)) {
+        m_errorString = QStringLiteral("File not found: %1").arg(fileName);
+        return false;
+    }
+    connect(&smf, &File::QSmf::signalSMFError, this, [this](const QString &errorStr) {
+        m_errorString = errorStr;
+    });
+    connect(&smf, &File::QSmf::signalSMFNoteOn, this, [this, frame](int chan, int pitch, int vol) {
+        addMessage(frame(), MIDI_STATUS_NOTEON | chan, pitch, vol);
+    });
+    connect(&smf, &File::QSmf::signalSMFNoteOff, this, [this, frame](int chan, int pitch, int vol) {
+        addMessage(frame(), MIDI_STATUS_NOTEOFF | chan, pitch, vol);
+    });
+    connect(&smf, &File::QSmf::signalSMFKeyPress, this, [this, frame](int chan, int pitch, int press) {
+        addMessage(frame(), MIDI_STATUS_KEYPRESURE | chan, pitch, press);
+    });
+    connect(&smf, &File::QSmf::signalSMFCtlChange, this, [this, frame](int chan, int ctl, int value) {
+        addMessage(frame(), MIDI_STATUS_CONTROLCHANGE | chan, ctl, value);
+    });
+    connect(&smf, &File::QSmf::signalSMFPitchBend, this, [this, frame](int chan, int value) {
+        int v = value + 8192;
+        addMessage(frame(), MIDI_STATUS_PITCHBEND | chan, MIDI_LSB(v), MIDI_MSB(v));
+    });
+    connect(&smf, &File::QSmf::signalSMFProgram, this, [this, frame](int chan, int patch) {
+        addMessage(frame(), MIDI_STATUS_PROGRAMCHANGE | chan, patch);
+    });
+    connect(&smf, &File::QSmf::signalSMFChanPress, this, [this, frame](int chan, int press) {
+        addMessage(frame(), MIDI_STATUS_CHANNELPRESSURE | chan, press);
+    });
+    smf.readFromFile(fileName);
+    return m_errorString.isEmpty();
+}
+
+int
+OfflineRenderer::messageCount() const
+{
+    return m_messages.count();
+}
+
+void
+OfflineRenderer::setTailTime(int milliseconds)
+{
+    m_tailTime = qMax(milliseconds, 0);
+}
+
+int
+OfflineRenderer::tailTime() const
+{
+    return m_tailTime;
+}
+
+void
+OfflineRenderer::sortMessages()
+{
+    if (!m_sorted) {
+        std::stable_sort(m_messages.begin(), m_messages.end(),
+            [](const OfflineMessage &a, const OfflineMessage &b) {
+                return a.frame < b.frame;
+            });
+        m_sorted = true;
+    }
+}
+
+/* frames to be rendered: up to the last message, plus the tail time */
+qint64
+OfflineRenderer::length()
+{
+    sortMessages();
+    qint64 last = m_messages.isEmpty() ? 0 : m_messages.last().frame;
+    return last + qint64(m_tailTime) * m_synth.sampleRate() / 1000;
+}
+
+/*
+ * The messages are fed to the synth queue one block ahead, so the queue
+ * never holds more than a block worth of messages, and each one is applied
+ * at the synth update boundary nearest to its frame. Returns the number
+ * of frames rendered, or -1 if the synth is not available.
+ */
+qint64
+OfflineRenderer::render(Callback callback)
+{
+    const int blockSize = m_synth.bufferSize();
+    const qint64 start = m_synth.renderedFrames();
+    const qint64 end = start + length();
+    QVector<EAS_PCM> buffer(blockSize * m_synth.channels());
+    int next = 0;
+    while (m_synth.renderedFrames() < end) {
+        qint64 limit = m_synth.renderedFrames() + blockSize;
+        int queued = 0;
+        while (next < m_messages.count() && queued < SynthRenderer::MESSAGE_QUEUE_SIZE / 2) {
+            const OfflineMessage &msg = m_messages.at(next);
+            if (start + msg.frame >= limit) {
+                break;
+            }
+            m_synth.sendMessageAt(start + msg.frame, msg.length, msg.data[0], msg.data[1], msg.data[2]);
+            ++next;
+            ++queued;
+        }
+        int numGen = m_synth.renderBlock(buffer.data());
+        if (numGen <= 0) {
+            m_errorString = QStringLiteral("EAS synthesizer not available");
+            return -1;
+        }
+        if (callback) {
+            callback(buffer.constData(), numGen);
+        }
+    }
+    return m_synth.renderedFrames() - start;
+}
+
+/*
+ * Writes a RIFF WAVE file when the file name ends with ".wav", or raw
+ * little endian PCM samples otherwise.
+ */
+bool
+OfflineRenderer::renderToFile(const QString &fileName)
+{
+    const int WAV_HEADER_SIZE = 44;
+    const int channels = m_synth.channels();
+    const int frameBytes = channels * int(sizeof(EAS_PCM));
+    const bool wave = fileName.endsWith(QLatin1String(".wav"), Qt::CaseInsensitive);
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+    if (wave) {
+        file.write(QByteArray(WAV_HEADER_SIZE, '\0'));
+    }
+    QVector<EAS_PCM> samples(m_synth.bufferSize() * channels);
+    bool ok = true;
+    qint64 frames = render([&](const EAS_PCM *pcm, int count) {
+        const char *data = reinterpret_cast<const char *>(pcm);
+        if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) {
+            for (int i = 0; i < count * channels; ++i) {
+                samples[i] = qToLittleEndian<EAS_PCM>(pcm[i]);
+            }
+            data = reinterpret_cast<const char *>(samples.constData());
+        }
+        if (ok && file.write(data, count * frameBytes) != count * frameBytes) {
+            m_errorString = file.errorString();
+            ok = false;
+        }
+    });
+    if (frames < 0 || !ok) {
+        file.close();
+        return false;
+    }
+    if (wave) {
+        uchar header[WAV_HEADER_SIZE];
+        const quint32 dataBytes = quint32(frames * frameBytes);
+        const quint32 rate = quint32(m_synth.sampleRate());
+        memcpy(header, "RIFF", 4);
+        qToLittleEndian<quint32>(dataBytes + WAV_HEADER_SIZE - 8, header + 4);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        qToLittleEndian<quint32>(16, header + 16);
+        qToLittleEndian<quint16>(1, header + 20); /* PCM */
+        qToLittleEndian<quint16>(quint16(channels), header + 22);
+        qToLittleEndian<quint32>(rate, header + 24);
+        qToLittleEndian<quint32>(rate * frameBytes, header + 28);
+        qToLittleEndian<quint16>(quint16(frameBytes), header + 32);
+        qToLittleEndian<quint16>(16, header + 34);
+        memcpy(header + 36, "data", 4);
+        qToLittleEndian<quint32>(dataBytes, header + 40);
+        file.seek(0);
+        file.write(reinterpret_cast<const char *>(header), WAV_HEADER_SIZE);
+    }
+    file.close();
+    return true;
+}
+
+QString
+OfflineRenderer::errorString() const
+{
+    return m_errorString;
+}
+
+} // namespace rt
+} // namespace drumstick
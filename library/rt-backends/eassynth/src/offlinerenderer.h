@@ -0,0 +1,83 @@
+/*
+    Sonivox EAS Synthesizer for Qt applications
+    Copyright (C) 2016-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OFFLINERENDERER_H_
+#define OFFLINERENDERER_H_
+
+#include <functional>
+#include <QObject>
+#include <QSettings>
+#include <QString>
+#include <QVector>
+#include "synthrenderer.h"
+
+namespace drumstick { namespace rt {
+
+    /*
+     * Renders a sequence of MIDI messages with the EAS synthesizer as fast
+     * as the CPU allows, without a sound server. The rendered PCM samples
+     * (interleaved, 16 bits, native endianness) are handed to a callback or
+     * written to a WAV or raw PCM file.
+     */
+    class OfflineRenderer : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        typedef std::function<void(const EAS_PCM *samples, int frames)> Callback;
+
+        explicit OfflineRenderer(QObject *parent = nullptr);
+        virtual ~OfflineRenderer();
+
+        void initialize(QSettings* settings);
+        SynthRenderer *synth();
+        int sampleRate() const;
+        int channels() const;
+
+        void clear();
+        void setChannelMask(quint16 mask);
+        quint16 channelMask() const;
+        void addMessage(qint64 frame, int m0, int m1 = 0, int m2 = 0);
+        bool loadSMF(const QString &fileName);
+        int messageCount() const;
+        void setTailTime(int milliseconds);
+        int tailTime() const;
+        qint64 length();
+
+        qint64 render(Callback callback);
+        bool renderToFile(const QString &fileName);
+        QString errorString() const;
+
+    private:
+        struct OfflineMessage {
+            qint64 frame;
+            quint8 length;
+            quint8 data[3];
+        };
+        void sortMessages();
+
+        SynthRenderer m_synth;
+        QVector<OfflineMessage> m_messages;
+        bool m_sorted;
+        quint16 m_channelMask;
+        int m_tailTime;
+        QString m_errorString;
+    };
+
+}}
+#endif /*OFFLINERENDERER_H_*/
@@ -0,0 +1,185 @@
+/*
+    Sonivox EAS Synthesizer for Qt applications
+    Copyright (C) 2016-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <eas_chorus.h>
+#include <eas_reverb.h>
+#include "renderpool.h"
+
+namespace drumstick {
+namespace rt {
+
+class RenderPool::RenderTask : public QRunnable
+{
+public:
+    RenderTask(RenderPool *pool, const RenderJob &job) : m_pool(pool), m_job(job) { }
+    void run() override { m_pool->renderJob(m_job); }
+
+private:
+    RenderPool *m_pool;
+    RenderJob m_job;
+};
+
+RenderPool::RenderPool(QObject *parent) : QObject(parent),
+    m_maxThreads(QThread::idealThreadCount()),
+    m_tailTime(2000),
+    m_reverbType(EAS_PARAM_REVERB_HALL),
+    m_reverbAmount(25800),
+    m_chorusType(-1),
+    m_chorusAmount(0),
+    m_renderedFrames(0)
+{ }
+
+RenderPool::~RenderPool()
+{ }
+
+void
+RenderPool::setMaxThreads(int threads)
+{
+    m_maxThreads = qMax(threads, 1);
+}
+
+int
+RenderPool::maxThreads() const
+{
+    return m_maxThreads;
+}
+
+void
+RenderPool::setTailTime(int milliseconds)
+{
+    m_tailTime = milliseconds;
+}
+
+void
+RenderPool::setReverb(int type, int amount)
+{
+    m_reverbType = type;
+    m_reverbAmount = amount;
+}
+
+void
+RenderPool::setChorus(int type, int amount)
+{
+    m_chorusType = type;
+    m_chorusAmount = amount;
+}
+
+/*
+ * The setup function adds the messages to be rendered, and returns false
+ * if the job should be abandoned. An empty output file name discards the
+ * rendered samples.
+ */
+void
+RenderPool::addJob(const QString &outputFile, Setup setup)
+{
+    m_jobs.append(RenderJob{outputFile, setup});
+}
+
+void
+RenderPool::addFile(const QString &midiFile, const QString &outputFile, quint16 channelMask)
+{
+    addJob(outputFile, [midiFile, channelMask](OfflineRenderer &renderer) {
+        renderer.setChannelMask(channelMask);
+        return renderer.loadSMF(midiFile);
+    });
+}
+
+int
+RenderPool::jobCount() const
+{
+    return m_jobs.count();
+}
+
+void
+RenderPool::clear()
+{
+    m_jobs.clear();
+}
+
+/*
+ * Renders all the jobs, and blocks until they are finished.
+ * Returns false if any of them failed.
+ */
+bool
+RenderPool::run()
+{
+    QThreadPool threads;
+    threads.setMaxThreadCount(m_maxThreads);
+    m_renderedFrames.store(0);
+    m_errors.clear();
+    for (const RenderJob &job : qAsConst(m_jobs)) {
+        threads.start(new RenderTask(this, job));
+    }
+    threads.waitForDone();
+    return errors().isEmpty();
+}
+
+void
+RenderPool::renderJob(const RenderJob &job)
+{
+    OfflineRenderer renderer;
+    renderer.synth()->initReverb(m_reverbType);
+    renderer.synth()->setReverbWet(m_reverbAmount);
+    renderer.synth()->initChorus(m_chorusType);
+    renderer.synth()->setChorusLevel(m_chorusAmount);
+    renderer.setTailTime(m_tailTime);
+    bool ok = !job.setup || job.setup(renderer);
+    if (ok) {
+        qint64 frames = 0;
+        if (job.outputFile.isEmpty()) {
+            frames = renderer.render(nullptr);
+            ok = frames >= 0;
+        } else {
+            ok = renderer.renderToFile(job.outputFile);
+            frames = renderer.synth()->renderedFrames();
+        }
+        if (ok) {
+            m_renderedFrames.fetchAndAddOrdered(frames);
+        }
+    }
+    if (!ok) {
+        QMutexLocker locker(&m_errorsMutex);
+        m_errors << QStringLiteral("%1: %2").arg(job.outputFile, renderer.errorString());
+    }
+}
+
+int
+RenderPool::sampleRate() const
+{
+    return SynthRenderer::outputRate();
+}
+
+qint64
+RenderPool::renderedFrames() const
+{
+    return m_renderedFrames.load();
+}
+
+QStringList
+RenderPool::errors() const
+{
+    QMutexLocker locker(&m_errorsMutex);
+    return m_errors;
+}
+
+} // namespace rt
+} // namespace drumstick
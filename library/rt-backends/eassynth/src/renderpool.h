@@ -0,0 +1,85 @@
+/*
+    Sonivox EAS Synthesizer for Qt applications
+    Copyright (C) 2016-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RENDERPOOL_H_
+#define RENDERPOOL_H_
+
+#include <functional>
+#include <QAtomicInteger>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include "offlinerenderer.h"
+
+namespace drumstick { namespace rt {
+
+    /*
+     * Runs offline rendering jobs on a pool of threads. Every job renders
+     * with its own, freshly initialized EAS instance (EAS_DATA_HANDLE), so
+     * the output of a job does not depend on the number of threads or on
+     * the order of execution. The built-in wavetable sound library is
+     * constant data, shared by all the instances.
+     */
+    class RenderPool : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        typedef std::function<bool(OfflineRenderer &renderer)> Setup;
+
+        explicit RenderPool(QObject *parent = nullptr);
+        virtual ~RenderPool();
+
+        void setMaxThreads(int threads);
+        int maxThreads() const;
+        void setTailTime(int milliseconds);
+        void setReverb(int type, int amount);
+        void setChorus(int type, int amount);
+
+        void addJob(const QString &outputFile, Setup setup);
+        void addFile(const QString &midiFile, const QString &outputFile, quint16 channelMask = 0xffff);
+        int jobCount() const;
+        void clear();
+
+        bool run();
+        int sampleRate() const;
+        qint64 renderedFrames() const;
+        QStringList errors() const;
+
+    private:
+        struct RenderJob {
+            QString outputFile;
+            Setup setup;
+        };
+        class RenderTask;
+        void renderJob(const RenderJob &job);
+
+        QList<RenderJob> m_jobs;
+        int m_maxThreads;
+        int m_tailTime;
+        int m_reverbType, m_reverbAmount;
+        int m_chorusType, m_chorusAmount;
+        QAtomicInteger<qint64> m_renderedFrames;
+        mutable QMutex m_errorsMutex;
+        QStringList m_errors;
+    };
+
+}}
+#endif /*RENDERPOOL_H_*/
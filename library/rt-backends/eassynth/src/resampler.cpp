@@ -0,0 +1,184 @@
+/*
+    Sonivox EAS Synthesizer for Qt applications
+    Copyright (C) 2016-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <QtMath>
+#include "resampler.h"
+
+namespace drumstick {
+namespace rt {
+
+/* pass band edge, relative to the lower Nyquist frequency */
+static const double RESAMPLER_CUTOFF = 0.9;
+
+static int gcd(int a, int b)
+{
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+Resampler::Resampler() :
+    m_inputRate(0),
+    m_outputRate(0),
+    m_channels(1),
+    m_up(1),
+    m_down(1),
+    m_phase(0),
+    m_position(0)
+{ }
+
+/*
+ * Designs the prototype low pass filter at the upsampled rate L * inputRate,
+ * with a Blackman window, and splits it into L phases of TAPS coefficients.
+ * Each phase is normalized to unity gain at DC.
+ */
+void
+Resampler::setRates(int inputRate, int outputRate, int channels)
+{
+    m_inputRate = inputRate;
+    m_outputRate = outputRate;
+    m_channels = qMax(1, channels);
+    int div = gcd(inputRate, outputRate);
+    m_up = outputRate / div;
+    m_down = inputRate / div;
+    m_filter.clear();
+    if (!isIdentity()) {
+        const int length = m_up * TAPS;
+        const double center = (length - 1) / 2.0;
+        const double fc = RESAMPLER_CUTOFF * 0.5 / qMax(m_up, m_down);
+        QVector<double> proto(length);
+        for (int k = 0; k < length; ++k) {
+            double x = k - center;
+            double sinc = (x == 0.0) ? 1.0 : std::sin(2.0 * M_PI * fc * x) / (2.0 * M_PI * fc * x);
+            double w = 0.42 - 0.5 * std::cos(2.0 * M_PI * k / (length - 1))
+                            + 0.08 * std::cos(4.0 * M_PI * k / (length - 1));
+            proto[k] = sinc * w;
+        }
+        m_filter.resize(length);
+        for (int p = 0; p < m_up; ++p) {
+            double sum = 0.0;
+            for (int i = 0; i < TAPS; ++i) {
+                sum += proto[p + i * m_up];
+            }
+            for (int i = 0; i < TAPS; ++i) {
+                m_filter[p * TAPS + i] = float(proto[p + i * m_up] / sum);
+            }
+        }
+    }
+    reset();
+}
+
+void
+Resampler::reset()
+{
+    m_phase = 0;
+    m_position = 0;
+    m_history.fill(0.0f);
+}
+
+bool
+Resampler::isIdentity() const
+{
+    return m_up == m_down;
+}
+
+int
+Resampler::inputRate() const
+{
+    return m_inputRate;
+}
+
+int
+Resampler::outputRate() const
+{
+    return m_outputRate;
+}
+
+int
+Resampler::maxOutputFrames(int inputFrames) const
+{
+    return (inputFrames * m_up + m_down - 1) / m_down;
+}
+
+/*
+ * The delay of the linear phase filter, in output frames.
+ */
+int
+Resampler::latency() const
+{
+    if (isIdentity()) {
+        return 0;
+    }
+    return qRound((m_up * TAPS - 1) / 2.0 / m_down);
+}
+
+/*
+ * Converts inputFrames frames, and returns the number of frames written
+ * to output, at most maxOutputFrames(inputFrames). The last TAPS - 1 input
+ * frames are kept in front of the next block, so the history buffer only
+ * grows on the first call or when the block size increases.
+ */
+int
+Resampler::process(const qint16 *input, int inputFrames, qint16 *output)
+{
+    if (isIdentity()) {
+        std::memcpy(output, input, sizeof(qint16) * inputFrames * m_channels);
+        return inputFrames;
+    }
+    const int keep = (TAPS - 1) * m_channels;
+    const int needed = keep + inputFrames * m_channels;
+    if (m_history.size() < needed) {
+        m_history.resize(needed);
+    }
+    float *buffer = m_history.data();
+    for (int i = 0; i < inputFrames * m_channels; ++i) {
+        buffer[keep + i] = input[i];
+    }
+    int frames = 0;
+    int position = m_position;
+    int phase = m_phase;
+    while (position < inputFrames) {
+        const float *h = m_filter.constData() + phase * TAPS;
+        const float *x = buffer + (position + TAPS - 1) * m_channels;
+        for (int c = 0; c < m_channels; ++c) {
+            float acc = 0.0f;
+            for (int i = 0; i < TAPS; ++i) {
+                acc += h[i] * x[c - i * m_channels];
+            }
+            output[frames * m_channels + c] = qint16(qBound(-32768, qRound(acc), 32767));
+        }
+        ++frames;
+        phase += m_down;
+        while (phase >= m_up) {
+            phase -= m_up;
+            ++position;
+        }
+    }
+    m_position = position - inputFrames;
+    m_phase = phase;
+    std::memmove(buffer, buffer + inputFrames * m_channels, sizeof(float) * keep);
+    return frames;
+}
+
+} // namespace rt
+} // namespace drumstick
@@ -0,0 +1,64 @@
+/*
+    Sonivox EAS Synthesizer for Qt applications
+    Copyright (C) 2016-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+#include <QtGlobal>
+#include <QVector>
+
+namespace drumstick { namespace rt {
+
+/*
+ * Streaming sample rate converter for interleaved 16 bit frames.
+ *
+ * The rates are reduced to a rational ratio L/M (2/1 from 22050 to 44100 Hz,
+ * 320/147 from 22050 to 48000 Hz) and converted by a polyphase windowed sinc
+ * FIR filter of TAPS coefficients per phase. The filter state is kept between
+ * calls, so a stream can be converted one block at a time.
+ */
+class Resampler
+{
+public:
+    static const int TAPS = 32;
+
+    Resampler();
+    void setRates(int inputRate, int outputRate, int channels);
+    void reset();
+    bool isIdentity() const;
+    int inputRate() const;
+    int outputRate() const;
+    int maxOutputFrames(int inputFrames) const;
+    int latency() const;
+    int process(const qint16 *input, int inputFrames, qint16 *output);
+
+private:
+    int m_inputRate;
+    int m_outputRate;
+    int m_channels;
+    int m_up;
+    int m_down;
+    int m_phase;
+    int m_position;
+    QVector<float> m_filter;
+    QVector<float> m_history;
+};
+
+}}
+
+#endif /*RESAMPLER_H_*/
@@ -2,6 +2,7 @@ TEMPLATE = lib
 TARGET = drumstick-rt-eassynth
 DESTDIR = ../../../../build/lib/drumstick2
 include (../../../../global.pri)
+include (../sonivox/sonivox.pri)
 CONFIG += c++11 plugin link_prl
 static {
     CONFIG += staticlib create_prl
@@ -15,12 +16,14 @@ LIBS += -L../../../../build/lib \
         -ldrumstick-rt \
         -lsonivox
 
-HEADERS += synthcontroller.h \
+HEADERS += audioringbuffer.h \
+           resampler.h \
+           synthcontroller.h \
            synthrenderer.h
 
-SOURCES += synthcontroller.cpp synthrenderer.cpp
+SOURCES += audioringbuffer.cpp resampler.cpp synthcontroller.cpp synthrenderer.cpp
 
 CONFIG += link_pkgconfig
 packagesExist(libpulse-simple) {
-    PKGCONFIG += libpulse-simple
+    PKGCONFIG += libpulse-simple libpulse
 }
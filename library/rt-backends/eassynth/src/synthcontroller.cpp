@@ -56,6 +56,22 @@ SynthController::stop()
     m_renderingThread.wait();
 }
 
+/*
+ * Engine and output counters sampled from the rendering thread: voices,
+ * render time per block, PulseAudio underruns and MIDI queue activity.
+ */
+QVariantMap
+SynthController::statistics() const
+{
+    return m_renderer->statistics();
+}
+
+void
+SynthController::resetStatistics()
+{
+    m_renderer->resetStatistics();
+}
+
 void
 SynthController::initialize(QSettings* settings)
 {
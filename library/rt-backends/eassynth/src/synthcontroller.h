@@ -21,6 +21,7 @@
 
 #include <QObject>
 #include <QThread>
+#include <QVariantMap>
 #include <drumstick/rtmidioutput.h>
 #include "synthrenderer.h"
 
@@ -32,12 +33,15 @@ namespace rt {
         Q_OBJECT
         Q_PLUGIN_METADATA(IID "net.sourceforge.drumstick.rt.MIDIOutput/2.0")
         Q_INTERFACES(drumstick::rt::MIDIOutput)
+        Q_PROPERTY(QVariantMap statistics READ statistics)
     public:
         explicit SynthController(QObject *parent = nullptr);
         virtual ~SynthController();
 
         void start();
         void stop();
+        QVariantMap statistics() const;
+        Q_INVOKABLE void resetStatistics();
 
         // MIDIOutput interface
     public:
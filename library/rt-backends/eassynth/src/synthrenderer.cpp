@@ -17,8 +17,10 @@
 */
 
 #include "synthrenderer.h"
-#include <QCoreApplication>
+#include <cstring>
+#include <limits>
 #include <QObject>
+#include <QMutexLocker>
 #include <QReadLocker>
 #include <QString>
 #include <QTextStream>
@@ -33,6 +35,7 @@ namespace rt {
 
 const QString SynthRenderer::QSTR_PREFERENCES = QStringLiteral("SonivoxEAS");
 const QString SynthRenderer::QSTR_BUFFERTIME = QStringLiteral("BufferTime");
+const QString SynthRenderer::QSTR_LOWLATENCY = QStringLiteral("LowLatency");
 const QString SynthRenderer::QSTR_REVERBTYPE = QStringLiteral("ReverbType");
 const QString SynthRenderer::QSTR_REVERBAMT = QStringLiteral("ReverbAmt");
 const QString SynthRenderer::QSTR_CHORUSTYPE = QStringLiteral("ChorusType");
@@ -41,8 +44,34 @@ const QString SynthRenderer::QSTR_SONIVOXEAS = QStringLiteral("SonivoxEAS");
 
 SynthRenderer::SynthRenderer(QObject *parent) : QObject(parent),
     m_Stopped(true),
-    m_bufferTime(60)
+    m_bufferTime(60),
+    m_lowLatency(false),
+    m_mainLoop(nullptr),
+    m_context(nullptr),
+    m_stream(nullptr),
+    m_streamPrimed(false),
+    m_ringTarget(0),
+    m_renderedFrames(0),
+    m_queueDropped(0),
+    m_activeVoices(0),
+    m_maxActiveVoices(0),
+    m_stolenVoices(0),
+    m_renderTime(0),
+    m_maxRenderTime(0),
+    m_renderBlocks(0),
+    m_underruns(0),
+    m_writeErrors(0),
+    m_queuedMessages(0),
+    m_ringUnderruns(0),
+    m_outputLatency(0),
+    m_latencyTotal(0),
+    m_maxLatency(0),
+    m_latencyCount(0),
+    m_lastStolenVoices(0),
+    m_blockTime(0),
+    m_queuedUntil(0)
 {
+    m_clock.start();
     initEAS();
 }
 
@@ -76,9 +105,13 @@ SynthRenderer::initEAS()
     m_easData = dataHandle;
     m_streamHandle = handle;
     Q_ASSERT(m_streamHandle != nullptr);
-    m_sampleRate = easConfig->sampleRate;
-    m_bufferSize = easConfig->mixBufferSize;
+    m_synthBufferSize = easConfig->mixBufferSize;
     m_channels = easConfig->numChannels;
+    m_sampleRate = outputRate();
+    m_resampler.setRates(easConfig->sampleRate, m_sampleRate, m_channels);
+    m_bufferSize = m_resampler.maxOutputFrames(m_synthBufferSize);
+    m_synthBuffer.resize(m_synthBufferSize * m_channels);
+    m_blockTime = qint64(m_synthBufferSize) * 1000000000 / easConfig->sampleRate;
     //qDebug() << Q_FUNC_INFO << "EAS bufferSize=" << m_bufferSize << " sampleRate=" << m_sampleRate << " channels=" << m_channels;
 }
 
@@ -156,6 +189,7 @@ SynthRenderer::initialize(QSettings *settings)
 {
     settings->beginGroup(QSTR_PREFERENCES);
     m_bufferTime = settings->value(QSTR_BUFFERTIME, 60).toInt();
+    m_lowLatency = settings->value(QSTR_LOWLATENCY, false).toBool();
     int reverbType = settings->value(QSTR_REVERBTYPE, EAS_PARAM_REVERB_HALL).toInt();
     int reverbAmt = settings->value(QSTR_REVERBAMT, 25800).toInt();
     int chorusType = settings->value(QSTR_CHORUSTYPE, -1).toInt();
@@ -185,33 +219,13 @@ SynthRenderer::stop()
 void
 SynthRenderer::run()
 {
-    int pa_err;
-    unsigned char data[1024];
     //qDebug() << Q_FUNC_INFO << "started";
     try {
-        initPulse();
-        m_Stopped = false;
-        while (!stopped()) {
-            EAS_RESULT eas_res;
-            EAS_I32 numGen = 0;
-            size_t bytes = 0;
-            QCoreApplication::sendPostedEvents();
-            if (m_easData != nullptr)
-            {
-                EAS_PCM *buffer = (EAS_PCM *) data;
-                eas_res = EAS_Render(m_easData, buffer, m_bufferSize, &numGen);
-                if (eas_res != EAS_SUCCESS) {
-                    qWarning() << "EAS_Render error:" << eas_res;
-                }
-                bytes += (size_t) numGen * sizeof(EAS_PCM) * m_channels;
-                // hand over to pulseaudio the rendered buffer
-                if (pa_simple_write (m_pulseHandle, data, bytes, &pa_err) < 0)
-                {
-                    qWarning() << "Error writing to PulseAudio connection:" << pa_err;
-                }
-            }
+        if (m_lowLatency) {
+            runStream();
+        } else {
+            runSimple();
         }
-        uninitPulse();
     } catch (...) {
         qWarning() << "Exception in rendering loop - exiting";
     }
@@ -220,104 +234,588 @@ SynthRenderer::run()
 }
 
 void
-SynthRenderer::writeMIDIData(const QByteArray& message)
+SynthRenderer::runSimple()
 {
-    EAS_RESULT eas_res = EAS_ERROR_ALREADY_STOPPED;
-    if (m_easData != nullptr && m_streamHandle != nullptr)
-    {
-        //count = m_codec->decode((unsigned char *)&buffer, sizeof(buffer), ev->getHandle());
-        if (message.length() > 0) {
-            //qDebug() << Q_FUNC_INFO << message.toHex();
-            eas_res = EAS_WriteMIDIStream(m_easData, m_streamHandle, (EAS_U8 *)message.data(), message.length());
+    const int LATENCY_PERIOD = 64;
+    int pa_err;
+    int blocks = 0;
+    QVector<EAS_PCM> data(m_bufferSize * m_channels);
+    initPulse();
+    m_Stopped = false;
+    m_playbackClock.start();
+    m_queuedUntil = 0;
+    while (!stopped()) {
+        int numGen = renderBlock(data.data());
+        size_t bytes = (size_t) numGen * sizeof(EAS_PCM) * m_channels;
+        if (bytes > 0) {
+            // hand over to pulseaudio the rendered buffer
+            qint64 start = m_playbackClock.nsecsElapsed();
+            if (pa_simple_write (m_pulseHandle, data.constData(), bytes, &pa_err) < 0)
+            {
+                m_writeErrors.ref();
+                qWarning() << "Error writing to PulseAudio connection:" << pa_err;
+            } else {
+                checkUnderrun(start, m_playbackClock.nsecsElapsed(), numGen);
+            }
+        }
+        // the latency query is a server round trip, so it is sampled sparsely
+        if (m_pulseHandle != nullptr && ++blocks % LATENCY_PERIOD == 0) {
+            pa_usec_t latency = pa_simple_get_latency(m_pulseHandle, &pa_err);
+            if (latency != (pa_usec_t) -1) {
+                m_outputLatency.store(int(latency));
+            }
+        }
+    }
+    uninitPulse();
+}
+
+/*
+ * Low latency output: the write callback of a PulseAudio asynchronous
+ * stream pulls the audio from m_ring on the PulseAudio thread, and this
+ * thread keeps the ring filled with synth blocks up to m_ringTarget frames,
+ * waking up whenever the callback has consumed some audio. The server
+ * buffer is sized by m_bufferTime, so the output latency is m_bufferTime
+ * plus one or two synth blocks; the fixed EAS block (128 frames at
+ * 22050 Hz) is the lower bound.
+ */
+void
+SynthRenderer::runStream()
+{
+    QVector<EAS_PCM> data(m_bufferSize * m_channels);
+    m_ringTarget = 2 * m_bufferSize;
+    m_ring.resize(m_ringTarget, m_channels);
+    m_Stopped = false;
+    while (!stopped()) {
+        while (m_ring.readAvailable() + m_bufferSize <= m_ringTarget) {
+            int numGen = renderBlock(data.data());
+            if (numGen <= 0) {
+                break;
+            }
+            m_ring.write(data.constData(), numGen);
+        }
+        if (m_stream == nullptr && !initStream()) {
+            break;
+        }
+        m_ringSpace.tryAcquire(1, 20);
+    }
+    uninitStream();
+}
+
+static void
+contextStateCallback(pa_context *context, void *userdata)
+{
+    Q_UNUSED(context)
+    pa_threaded_mainloop_signal(static_cast<pa_threaded_mainloop *>(userdata), 0);
+}
+
+static void
+streamStateCallback(pa_stream *stream, void *userdata)
+{
+    Q_UNUSED(stream)
+    pa_threaded_mainloop_signal(static_cast<pa_threaded_mainloop *>(userdata), 0);
+}
+
+bool
+SynthRenderer::initStream()
+{
+    pa_sample_spec samplespec;
+    pa_buffer_attr bufattr;
+    samplespec.format = PA_SAMPLE_S16LE;
+    samplespec.channels = m_channels;
+    samplespec.rate = m_sampleRate;
+    bufattr.maxlength = (uint32_t) -1;
+    bufattr.tlength = pa_usec_to_bytes(m_bufferTime * 1000, &samplespec);
+    bufattr.minreq = m_bufferSize * sizeof(EAS_PCM) * m_channels;
+    bufattr.prebuf = (uint32_t) -1;
+    bufattr.fragsize = (uint32_t) -1;
+
+    m_streamPrimed = false;
+    m_mainLoop = pa_threaded_mainloop_new();
+    if (m_mainLoop == nullptr) {
+        qCritical() << "Failed to create PulseAudio main loop";
+        return false;
+    }
+    m_context = pa_context_new(pa_threaded_mainloop_get_api(m_mainLoop), "SonivoxEAS");
+    if (m_context == nullptr) {
+        qCritical() << "Failed to create PulseAudio context";
+        return false;
+    }
+    pa_context_set_state_callback(m_context, contextStateCallback, m_mainLoop);
+    pa_threaded_mainloop_lock(m_mainLoop);
+    bool ok = pa_threaded_mainloop_start(m_mainLoop) >= 0 &&
+              pa_context_connect(m_context, nullptr, PA_CONTEXT_NOFLAGS, nullptr) >= 0;
+    while (ok) {
+        pa_context_state_t state = pa_context_get_state(m_context);
+        if (state == PA_CONTEXT_READY) {
+            break;
+        }
+        ok = PA_CONTEXT_IS_GOOD(state);
+        if (ok) {
+            pa_threaded_mainloop_wait(m_mainLoop);
+        }
+    }
+    if (ok) {
+        m_stream = pa_stream_new(m_context, "Synthesizer output", &samplespec, nullptr);
+        ok = m_stream != nullptr;
+    }
+    if (ok) {
+        pa_stream_flags_t flags = pa_stream_flags_t(PA_STREAM_ADJUST_LATENCY |
+                                                    PA_STREAM_INTERPOLATE_TIMING |
+                                                    PA_STREAM_AUTO_TIMING_UPDATE);
+        pa_stream_set_state_callback(m_stream, streamStateCallback, m_mainLoop);
+        pa_stream_set_write_callback(m_stream, streamWriteCallback, this);
+        pa_stream_set_underflow_callback(m_stream, streamUnderflowCallback, this);
+        ok = pa_stream_connect_playback(m_stream, nullptr, &bufattr, flags, nullptr, nullptr) >= 0;
+    }
+    while (ok) {
+        pa_stream_state_t state = pa_stream_get_state(m_stream);
+        if (state == PA_STREAM_READY) {
+            break;
+        }
+        ok = PA_STREAM_IS_GOOD(state);
+        if (ok) {
+            pa_threaded_mainloop_wait(m_mainLoop);
+        }
+    }
+    pa_threaded_mainloop_unlock(m_mainLoop);
+    if (!ok) {
+        qCritical() << "Failed to create PulseAudio stream:" << pa_strerror(pa_context_errno(m_context));
+    }
+    return ok;
+}
+
+void
+SynthRenderer::uninitStream()
+{
+    if (m_mainLoop == nullptr) {
+        return;
+    }
+    pa_threaded_mainloop_lock(m_mainLoop);
+    if (m_stream != nullptr) {
+        pa_stream_set_write_callback(m_stream, nullptr, nullptr);
+        pa_stream_set_underflow_callback(m_stream, nullptr, nullptr);
+        pa_stream_disconnect(m_stream);
+        pa_stream_unref(m_stream);
+        m_stream = nullptr;
+    }
+    if (m_context != nullptr) {
+        pa_context_disconnect(m_context);
+        pa_context_unref(m_context);
+        m_context = nullptr;
+    }
+    pa_threaded_mainloop_unlock(m_mainLoop);
+    pa_threaded_mainloop_stop(m_mainLoop);
+    pa_threaded_mainloop_free(m_mainLoop);
+    m_mainLoop = nullptr;
+}
+
+void
+SynthRenderer::streamWriteCallback(pa_stream *stream, size_t nbytes, void *userdata)
+{
+    static_cast<SynthRenderer *>(userdata)->writeStream(stream, nbytes);
+}
+
+void
+SynthRenderer::streamUnderflowCallback(pa_stream *stream, void *userdata)
+{
+    Q_UNUSED(stream)
+    static_cast<SynthRenderer *>(userdata)->m_underruns.ref();
+}
+
+/*
+ * Runs on the PulseAudio thread. The request is served from the ring,
+ * padded with silence if the rendering thread fell behind; the first
+ * request fills the whole server buffer, so it is not counted as an
+ * underrun. Nothing here blocks or allocates memory.
+ */
+void
+SynthRenderer::writeStream(pa_stream *stream, size_t nbytes)
+{
+    const size_t frameBytes = sizeof(EAS_PCM) * m_channels;
+    while (nbytes >= frameBytes) {
+        void *data = nullptr;
+        size_t bytes = nbytes;
+        if (pa_stream_begin_write(stream, &data, &bytes) < 0 || data == nullptr) {
+            break;
+        }
+        int frames = int(qMin(bytes, nbytes) / frameBytes);
+        if (frames == 0) {
+            pa_stream_cancel_write(stream);
+            break;
+        }
+        EAS_PCM *samples = static_cast<EAS_PCM *>(data);
+        int count = m_ring.read(samples, frames);
+        if (count < frames) {
+            std::memset(samples + count * m_channels, 0, (frames - count) * frameBytes);
+            if (m_streamPrimed) {
+                m_ringUnderruns.ref();
+            }
+        }
+        pa_stream_write(stream, data, frames * frameBytes, nullptr, 0, PA_SEEK_RELATIVE);
+        nbytes -= frames * frameBytes;
+    }
+    m_streamPrimed = true;
+    pa_usec_t latency = 0;
+    int negative = 0;
+    if (pa_stream_get_latency(stream, &latency, &negative) == 0) {
+        m_outputLatency.store(negative ? 0 : int(latency));
+    }
+    m_ringSpace.release();
+}
+
+/*
+ * Renders one EAS synth update period (128 frames at 22050 Hz), which is
+ * converted to the output rate when it differs from the synth rate, so the
+ * block has at most m_bufferSize frames. EAS_Render() can not render shorter
+ * blocks, so a timestamped message is applied at the block boundary nearest
+ * to its frame, and the onset error is at most half a block. The message
+ * frames count output frames, and the resampler delay is compensated.
+ * Messages without timestamp are applied at the start of the next block.
+ */
+int
+SynthRenderer::renderBlock(EAS_PCM *buffer)
+{
+    EAS_I32 numGen = 0;
+    if (m_easData == nullptr) {
+        return 0;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    processQueuedMessages(m_renderedFrames.load() + m_bufferSize / 2 + m_resampler.latency());
+    EAS_PCM *synthBuffer = m_resampler.isIdentity() ? buffer : m_synthBuffer.data();
+    EAS_RESULT eas_res = EAS_Render(m_easData, synthBuffer, m_synthBufferSize, &numGen);
+    if (eas_res != EAS_SUCCESS) {
+        qWarning() << "EAS_Render error:" << eas_res;
+    }
+    if (!m_resampler.isIdentity()) {
+        numGen = m_resampler.process(synthBuffer, numGen, buffer);
+    }
+    m_renderedFrames.fetchAndAddOrdered(numGen);
+    updateStatistics(timer.nsecsElapsed());
+    return numGen;
+}
+
+/*
+ * The counters are atomic integers written only by the rendering thread,
+ * so statistics() may sample them from any thread without locking.
+ */
+void
+SynthRenderer::updateStatistics(qint64 renderTime)
+{
+    EAS_I32 active = 0;
+    EAS_U32 stolen = 0;
+    if (EAS_GetActiveVoices(m_easData, &active) == EAS_SUCCESS) {
+        m_activeVoices.store(active);
+        if (active > m_maxActiveVoices.load()) {
+            m_maxActiveVoices.store(active);
+        }
+    }
+    if (EAS_GetStolenVoices(m_easData, &stolen) == EAS_SUCCESS) {
+        m_stolenVoices.fetchAndAddRelaxed(stolen - m_lastStolenVoices);
+        m_lastStolenVoices = stolen;
+    }
+    m_renderTime.fetchAndAddRelaxed(renderTime);
+    m_renderBlocks.fetchAndAddRelaxed(1);
+    if (renderTime > m_maxRenderTime.load()) {
+        m_maxRenderTime.store(renderTime);
+    }
+}
+
+/*
+ * pa_simple has no underrun notification, so the playback position is
+ * estimated with a monotonic clock: m_queuedUntil is the clock time when
+ * the audio written so far will have been played. Starting a write after
+ * that time (with one block of tolerance) means the server ran dry. A write
+ * that blocks means the server buffer is full, so the estimate is anchored
+ * again to the buffer time; this also absorbs the drift between the system
+ * and sound card clocks.
+ */
+void
+SynthRenderer::checkUnderrun(qint64 start, qint64 end, int frames)
+{
+    const qint64 duration = qint64(frames) * 1000000000 / m_sampleRate;
+    if (m_queuedUntil > 0 && start > m_queuedUntil + duration) {
+        m_underruns.ref();
+    }
+    m_queuedUntil = qMax(m_queuedUntil, start) + duration;
+    if (end - start > duration / 2) {
+        m_queuedUntil = end + qint64(m_bufferTime) * 1000000;
+    }
+}
+
+/*
+ * The latency from the submission of a note on message until its sound is
+ * played: the time waiting in the message queue, plus the audio already
+ * queued ahead of the block that starts the note, in the ring and in the
+ * PulseAudio buffers.
+ */
+void
+SynthRenderer::updateLatency(qint64 latency)
+{
+    latency += qint64(m_outputLatency.load()) * 1000;
+    latency += qint64(m_ring.readAvailable()) * 1000000000 / m_sampleRate;
+    m_latencyTotal.fetchAndAddRelaxed(latency);
+    m_latencyCount.fetchAndAddRelaxed(1);
+    if (latency > m_maxLatency.load()) {
+        m_maxLatency.store(latency);
+    }
+}
+
+QVariantMap
+SynthRenderer::statistics() const
+{
+    QVariantMap stats;
+    qint64 blocks = m_renderBlocks.load();
+    qint64 renderTime = blocks > 0 ? m_renderTime.load() / blocks : 0;
+    qint64 latencyCount = m_latencyCount.load();
+    int depth = (m_immediate.tail.load() - m_immediate.head.load() + MESSAGE_QUEUE_SIZE) % MESSAGE_QUEUE_SIZE
+              + (m_timed.tail.load() - m_timed.head.load() + MESSAGE_QUEUE_SIZE) % MESSAGE_QUEUE_SIZE;
+    stats["active_voices"] = m_activeVoices.load();
+    stats["max_active_voices"] = m_maxActiveVoices.load();
+    stats["stolen_voices"] = m_stolenVoices.load();
+    stats["render_time_us"] = renderTime / 1000;
+    stats["render_time_max_us"] = m_maxRenderTime.load() / 1000;
+    stats["render_load_percent"] = m_blockTime > 0 ? qRound(1000.0 * renderTime / m_blockTime) / 10.0 : 0.0;
+    stats["underruns"] = m_underruns.load();
+    stats["ring_underruns"] = m_ringUnderruns.load();
+    stats["write_errors"] = m_writeErrors.load();
+    stats["buffer_time_ms"] = m_bufferTime;
+    stats["low_latency"] = m_lowLatency;
+    stats["output_latency_us"] = m_outputLatency.load();
+    stats["latency_us"] = latencyCount > 0 ? m_latencyTotal.load() / latencyCount / 1000 : 0;
+    stats["latency_max_us"] = m_maxLatency.load() / 1000;
+    stats["messages_queued"] = m_queuedMessages.load();
+    stats["messages_dropped"] = m_queueDropped.load();
+    stats["queue_depth"] = depth;
+    return stats;
+}
+
+void
+SynthRenderer::resetStatistics()
+{
+    m_maxActiveVoices.store(m_activeVoices.load());
+    m_stolenVoices.store(0);
+    m_renderTime.store(0);
+    m_maxRenderTime.store(0);
+    m_renderBlocks.store(0);
+    m_underruns.store(0);
+    m_ringUnderruns.store(0);
+    m_writeErrors.store(0);
+    m_latencyTotal.store(0);
+    m_maxLatency.store(0);
+    m_latencyCount.store(0);
+    m_queuedMessages.store(0);
+    m_queueDropped.store(0);
+}
+
+/*
+ * The MIDI messages are stored in fixed size ring buffers, and written to
+ * the EAS stream by the rendering thread before each EAS_Render() call.
+ * The effect parameter changes go through the same rings, so EAS is only
+ * used from the rendering thread once it runs.
+ * The rings have a single consumer (the rendering thread) and need no locks
+ * on that side; the mutex only serializes several producer threads among
+ * themselves, so rendering is never blocked by MIDI writers. Messages are
+ * dropped when a ring is full.
+ *
+ * Messages without timestamp (a negative frame) and parameter changes go to
+ * m_immediate, which is drained completely before each block. Timestamped
+ * messages go to m_timed, a FIFO in time: a message is not processed until
+ * its frame is due, and holds back the timestamped messages queued after
+ * it, so their timestamps must not decrease. Live input is never delayed
+ * by the messages scheduled ahead.
+ */
+SynthRenderer::QueuedMessage *
+SynthRenderer::claimMessage(MessageRing &ring)
+{
+    int tail = ring.tail.load();
+    if ((tail + 1) % MESSAGE_QUEUE_SIZE == ring.head.loadAcquire()) {
+        m_queueDropped.ref();
+        return nullptr;
+    }
+    return &ring.messages[tail];
+}
+
+void
+SynthRenderer::publishMessage(MessageRing &ring)
+{
+    ring.tail.storeRelease((ring.tail.load() + 1) % MESSAGE_QUEUE_SIZE);
+}
+
+void
+SynthRenderer::enqueueMessage(qint64 frame, int length, int m0, int m1, int m2)
+{
+    QMutexLocker locker(&m_queueMutex);
+    MessageRing &ring = frame < 0 ? m_immediate : m_timed;
+    QueuedMessage *msg = claimMessage(ring);
+    if (msg == nullptr) {
+        return;
+    }
+    msg->frame = frame;
+    /* immediate note on messages are timestamped to measure the latency */
+    msg->time = (frame < 0 && (m0 & 0xf0) == MIDI_STATUS_NOTEON && m2 > 0) ? m_clock.nsecsElapsed() : -1;
+    msg->length = static_cast<EAS_U8>(length);
+    msg->data[0] = static_cast<EAS_U8>(m0);
+    msg->data[1] = static_cast<EAS_U8>(m1);
+    msg->data[2] = static_cast<EAS_U8>(m2);
+    publishMessage(ring);
+    m_queuedMessages.fetchAndAddRelaxed(1);
+}
+
+void
+SynthRenderer::enqueueParameter(EAS_I32 module, EAS_I32 param, EAS_I32 value)
+{
+    QMutexLocker locker(&m_queueMutex);
+    QueuedMessage *msg = claimMessage(m_immediate);
+    if (msg == nullptr) {
+        return;
+    }
+    msg->frame = -1;
+    msg->time = -1;
+    msg->length = 0;
+    msg->module = module;
+    msg->param = param;
+    msg->value = value;
+    publishMessage(m_immediate);
+}
+
+void
+SynthRenderer::processQueuedMessages(qint64 limit)
+{
+    if (m_streamHandle == nullptr) {
+        return;
+    }
+    drainQueue(m_immediate, std::numeric_limits<qint64>::max());
+    drainQueue(m_timed, limit);
+}
+
+void
+SynthRenderer::drainQueue(MessageRing &ring, qint64 limit)
+{
+    int head = ring.head.load();
+    int tail = ring.tail.loadAcquire();
+    if (head == tail) {
+        return;
+    }
+    while (head != tail) {
+        QueuedMessage &msg = ring.messages[head];
+        if (msg.frame >= limit) {
+            break;
+        }
+        if (msg.length == 0) {
+            EAS_RESULT eas_res = EAS_SetParameter(m_easData, msg.module, msg.param, msg.value);
+            if (eas_res != EAS_SUCCESS) {
+                qWarning() << "EAS_SetParameter error:" << eas_res;
+            }
+        } else {
+            EAS_RESULT eas_res = EAS_WriteMIDIStream(m_easData, m_streamHandle, msg.data, msg.length);
             if (eas_res != EAS_SUCCESS) {
                 qWarning() << "EAS_WriteMIDIStream error: " << eas_res;
             }
         }
+        if (msg.time >= 0) {
+            updateLatency(m_clock.nsecsElapsed() - msg.time);
+        }
+        head = (head + 1) % MESSAGE_QUEUE_SIZE;
     }
+    ring.head.storeRelease(head);
 }
 
 void
 SynthRenderer::initReverb(int reverb_type)
 {
-    EAS_RESULT eas_res;
     EAS_BOOL sw = EAS_TRUE;
     if ( reverb_type >= EAS_PARAM_REVERB_LARGE_HALL && reverb_type <= EAS_PARAM_REVERB_ROOM ) {
         sw = EAS_FALSE;
-        eas_res = EAS_SetParameter(m_easData, EAS_MODULE_REVERB, EAS_PARAM_REVERB_PRESET, (EAS_I32) reverb_type);
-        if (eas_res != EAS_SUCCESS) {
-            qWarning() << "EAS_SetParameter error:" << eas_res;
-        }
-    }
-    eas_res = EAS_SetParameter(m_easData, EAS_MODULE_REVERB, EAS_PARAM_REVERB_BYPASS, sw);
-    if (eas_res != EAS_SUCCESS) {
-        qWarning() << "EAS_SetParameter error: " << eas_res;
+        enqueueParameter(EAS_MODULE_REVERB, EAS_PARAM_REVERB_PRESET, (EAS_I32) reverb_type);
     }
+    enqueueParameter(EAS_MODULE_REVERB, EAS_PARAM_REVERB_BYPASS, sw);
 }
 
 void
 SynthRenderer::initChorus(int chorus_type)
 {
-    EAS_RESULT eas_res;
     EAS_BOOL sw = EAS_TRUE;
     if (chorus_type >= EAS_PARAM_CHORUS_PRESET1 && chorus_type <= EAS_PARAM_CHORUS_PRESET4 ) {
         sw = EAS_FALSE;
-        eas_res = EAS_SetParameter(m_easData, EAS_MODULE_CHORUS, EAS_PARAM_CHORUS_PRESET, (EAS_I32) chorus_type);
-        if (eas_res != EAS_SUCCESS) {
-            qWarning() << "EAS_SetParameter error:" << eas_res;
-        }
-    }
-    eas_res = EAS_SetParameter(m_easData, EAS_MODULE_CHORUS, EAS_PARAM_CHORUS_BYPASS, sw);
-    if (eas_res != EAS_SUCCESS) {
-        qWarning() << "EAS_SetParameter error:" << eas_res;
+        enqueueParameter(EAS_MODULE_CHORUS, EAS_PARAM_CHORUS_PRESET, (EAS_I32) chorus_type);
     }
+    enqueueParameter(EAS_MODULE_CHORUS, EAS_PARAM_CHORUS_BYPASS, sw);
 }
 
 void
 SynthRenderer::setReverbWet(int amount)
 {
-    EAS_RESULT eas_res = EAS_SetParameter(m_easData, EAS_MODULE_REVERB, EAS_PARAM_REVERB_WET, (EAS_I32) amount);
-    if (eas_res != EAS_SUCCESS) {
-        qWarning() << "EAS_SetParameter error:" << eas_res;
-    }
+    enqueueParameter(EAS_MODULE_REVERB, EAS_PARAM_REVERB_WET, (EAS_I32) amount);
 }
 
 void
 SynthRenderer::setChorusLevel(int amount)
 {
-    EAS_RESULT eas_res = EAS_SetParameter(m_easData, EAS_MODULE_CHORUS, EAS_PARAM_CHORUS_LEVEL, (EAS_I32) amount);
-    if (eas_res != EAS_SUCCESS) {
-        qWarning() << "EAS_SetParameter error:" << eas_res;
-    }
+    enqueueParameter(EAS_MODULE_CHORUS, EAS_PARAM_CHORUS_LEVEL, (EAS_I32) amount);
 }
 
 void
 SynthRenderer::sendMessage(int m0)
 {
-    QByteArray m;
-    m.resize(1);
-    m[0] = m0;
-    writeMIDIData(m);
+    enqueueMessage(-1, 1, m0, 0, 0);
 }
 
 void
 SynthRenderer::sendMessage(int m0, int m1)
 {
-    QByteArray m;
-    m.resize(2);
-    m[0] = m0;
-    m[1] = m1;
-    writeMIDIData(m);
+    enqueueMessage(-1, 2, m0, m1, 0);
 }
 
 void
 SynthRenderer::sendMessage(int m0, int m1, int m2)
 {
-    QByteArray m;
-    m.resize(3);
-    m[0] = m0;
-    m[1] = m1;
-    m[2] = m2;
-    writeMIDIData(m);
+    enqueueMessage(-1, 3, m0, m1, m2);
+}
+
+void
+SynthRenderer::sendMessageAt(qint64 frame, int length, int m0, int m1, int m2)
+{
+    enqueueMessage(frame, length, m0, m1, m2);
+}
+
+qint64
+SynthRenderer::renderedFrames() const
+{
+    return m_renderedFrames.load();
+}
+
+int
+SynthRenderer::sampleRate() const
+{
+    return m_sampleRate;
+}
+
+/*
+ * The EAS_OUTPUT_RATE build option selects the rate of the output audio,
+ * which is only resampled: the synth engine keeps running at the rate of
+ * its wavetable library, so the bandwidth is not extended.
+ */
+int
+SynthRenderer::outputRate()
+{
+#if defined(EAS_OUTPUT_RATE)
+    return EAS_OUTPUT_RATE;
+#else
+    return EAS_Config()->sampleRate;
+#endif
+}
+
+int
+SynthRenderer::bufferSize() const
+{
+    return m_bufferSize;
+}
+
+int
+SynthRenderer::channels() const
+{
+    return m_channels;
 }
 
 MIDIConnection
@@ -337,5 +835,21 @@ SynthRenderer::setBufferTime(int milliseconds)
     m_bufferTime = milliseconds;
 }
 
+/*
+ * Selects the callback driven output stream instead of the blocking
+ * pa_simple connection. Takes effect the next time the output is opened.
+ */
+void
+SynthRenderer::setLowLatency(bool enable)
+{
+    m_lowLatency = enable;
+}
+
+bool
+SynthRenderer::lowLatency() const
+{
+    return m_lowLatency;
+}
+
 } // namespace rt
 } // namespace drumstick
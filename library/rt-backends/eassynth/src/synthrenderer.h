@@ -20,11 +20,21 @@
 #define SYNTHRENDERER_H_
 
 #include <QObject>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QReadWriteLock>
+#include <QSemaphore>
 #include <QSettings>
+#include <QVariantMap>
+#include <QVector>
+#include <pulse/pulseaudio.h>
 #include <pulse/simple.h>
 #include <drumstick/rtmidioutput.h>
 #include "eas.h"
+#include "audioringbuffer.h"
+#include "resampler.h"
 
 namespace drumstick { namespace rt {
 
@@ -45,24 +55,54 @@ namespace drumstick { namespace rt {
         void sendMessage(int m0);
         void sendMessage(int m0, int m1);
         void sendMessage(int m0, int m1, int m2);
+        void sendMessageAt(qint64 frame, int length, int m0, int m1 = 0, int m2 = 0);
+        qint64 renderedFrames() const;
+        int renderBlock(EAS_PCM *buffer);
+        int sampleRate() const;
+        int bufferSize() const;
+        int channels() const;
+        static int outputRate();
+        QVariantMap statistics() const;
+        void resetStatistics();
         MIDIConnection connection();
         void setBufferTime(int milliseconds);
+        void setLowLatency(bool enable);
+        bool lowLatency() const;
         void initialize(QSettings* settings);
 
         static const QString QSTR_PREFERENCES;
         static const QString QSTR_BUFFERTIME;
+        static const QString QSTR_LOWLATENCY;
         static const QString QSTR_REVERBTYPE;
         static const QString QSTR_REVERBAMT;
         static const QString QSTR_CHORUSTYPE;
         static const QString QSTR_CHORUSAMT;
         static const QString QSTR_SONIVOXEAS;
+        static const int MESSAGE_QUEUE_SIZE = 1024;
 
     private:
         void initEAS();
         void initPulse();
+        bool initStream();
         void uninitEAS();
         void uninitPulse();
-        void writeMIDIData(const QByteArray& message);
+        void uninitStream();
+        void runSimple();
+        void runStream();
+        void writeStream(pa_stream *stream, size_t nbytes);
+        static void streamWriteCallback(pa_stream *stream, size_t nbytes, void *userdata);
+        static void streamUnderflowCallback(pa_stream *stream, void *userdata);
+        void enqueueMessage(qint64 frame, int length, int m0, int m1, int m2);
+        void enqueueParameter(EAS_I32 module, EAS_I32 param, EAS_I32 value);
+        struct MessageRing;
+        struct QueuedMessage;
+        QueuedMessage *claimMessage(MessageRing &ring);
+        void publishMessage(MessageRing &ring);
+        void drainQueue(MessageRing &ring, qint64 limit);
+        void processQueuedMessages(qint64 limit);
+        void updateStatistics(qint64 renderTime);
+        void updateLatency(qint64 latency);
+        void checkUnderrun(qint64 start, qint64 end, int frames);
 
     public slots:
         void run();
@@ -75,12 +115,66 @@ namespace drumstick { namespace rt {
         QReadWriteLock m_mutex;
         /* SONiVOX EAS */
         int m_sampleRate, m_bufferSize, m_channels;
+        int m_synthBufferSize;
+        QVector<EAS_PCM> m_synthBuffer;
+        Resampler m_resampler;
         EAS_DATA_HANDLE m_easData;
         EAS_HANDLE m_streamHandle;
         EAS_HANDLE m_fileHandle;
         /* pulseaudio */
         int m_bufferTime;
         pa_simple *m_pulseHandle;
+        /* pulseaudio asynchronous stream, in low latency mode */
+        bool m_lowLatency;
+        pa_threaded_mainloop *m_mainLoop;
+        pa_context *m_context;
+        pa_stream *m_stream;
+        bool m_streamPrimed;
+        AudioRingBuffer m_ring;
+        int m_ringTarget;
+        QSemaphore m_ringSpace;
+        QAtomicInteger<qint64> m_renderedFrames;
+        /* MIDI message and parameter queue, drained by the rendering thread */
+        struct QueuedMessage {
+            qint64 frame;
+            qint64 time;
+            EAS_U8 length;      /* zero for a parameter change */
+            EAS_U8 data[3];
+            EAS_I32 module;
+            EAS_I32 param;
+            EAS_I32 value;
+        };
+        /* immediate messages and parameters, and timestamped messages */
+        struct MessageRing {
+            QueuedMessage messages[MESSAGE_QUEUE_SIZE];
+            QAtomicInt head;
+            QAtomicInt tail;
+        };
+        MessageRing m_immediate;
+        MessageRing m_timed;
+        QAtomicInt m_queueDropped;
+        QMutex m_queueMutex;
+        /* statistics, updated by the rendering thread and read from any thread */
+        QAtomicInt m_activeVoices;
+        QAtomicInt m_maxActiveVoices;
+        QAtomicInteger<quint64> m_stolenVoices;
+        QAtomicInteger<qint64> m_renderTime;
+        QAtomicInteger<qint64> m_maxRenderTime;
+        QAtomicInteger<qint64> m_renderBlocks;
+        QAtomicInt m_underruns;
+        QAtomicInt m_writeErrors;
+        QAtomicInteger<quint64> m_queuedMessages;
+        QAtomicInt m_ringUnderruns;
+        QAtomicInt m_outputLatency;
+        QAtomicInteger<qint64> m_latencyTotal;
+        QAtomicInteger<qint64> m_maxLatency;
+        QAtomicInteger<qint64> m_latencyCount;
+        QElapsedTimer m_clock;
+        /* rendering thread only */
+        EAS_U32 m_lastStolenVoices;
+        qint64 m_blockTime;
+        QElapsedTimer m_playbackClock;
+        qint64 m_queuedUntil;
     };
 
 }}
@@ -0,0 +1,330 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2021 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+#include <drumstick/qsmf.h>
+#include "fluidrenderer.h"
+
+namespace drumstick { namespace rt {
+
+FluidRenderer::FluidRenderer(QObject *parent) : QObject(parent),
+    m_sorted(true),
+    m_blockSize(DEFAULT_BLOCKSIZE),
+    m_tailTime(2000)
+{
+    m_engine.setRealtime(false);
+}
+
+FluidRenderer::~FluidRenderer()
+{ }
+
+void FluidRenderer::initialize(QSettings *settings)
+{
+    if (settings != nullptr) {
+        m_engine.readSettings(settings);
+    }
+    m_engine.initialize(settings);
+    m_engine.waitForSoundFont();
+}
+
+SynthEngine *FluidRenderer::engine()
+{
+    return &m_engine;
+}
+
+int FluidRenderer::sampleRate() const
+{
+    return qRound(m_engine.sampleRate());
+}
+
+int FluidRenderer::channels() const
+{
+    return CHANNELS;
+}
+
+void FluidRenderer::clear()
+{
+    m_messages.clear();
+    m_sorted = true;
+    m_errorString.clear();
+}
+
+/*
+ * Message timestamps are frame numbers relative to the start of the
+ * rendering, and may be added in any order.
+ */
+void FluidRenderer::addMessage(qint64 frame, int m0, int m1, int m2)
+{
+    FluidMessage msg;
+    msg.frame = qMax<qint64>(frame, 0);
+    msg.data[0] = static_cast<quint8>(m0);
+    msg.data[1] = static_cast<quint8>(m1);
+    msg.data[2] = static_cast<quint8>(m2);
+    if (!m_messages.isEmpty() && m_messages.last().frame > msg.frame) {
+        m_sorted = false;
+    }
+    m_messages.append(msg);
+}
+
+/*
+ * Appends the channel messages of a Standard MIDI File. QSmf reports the
+ * real time of each event following the tempo map, in 1/1600 seconds.
+ * System exclusive messages are ignored.
+ */
+bool FluidRenderer::loadSMF(const QString &fileName)
+{
+    File::QSmf smf;
+    const int rate = sampleRate();
+    auto frame = [&smf, rate]() {
+        return qint64(smf.getRealTime()) * rate / 1600;
+    };
+    m_errorString.clear();
+    if (!QFileInfo::exists(fileName)) {
+        m_errorString = QStringLiteral("File not found: %1").arg(fileName);
+        return false;
+    }
+    connect(&smf, &File::QSmf::signalSMFError, this, [this](const QString &errorStr) {
+        m_errorString = errorStr;
+    });
+    connect(&smf, &File::QSmf::signalSMFNoteOn, this, [this, frame](int chan, int pitch, int vol) {
+        addMessage(frame(), MIDI_STATUS_NOTEON | chan, pitch, vol);
+    });
+    connect(&smf, &File::QSmf::signalSMFNoteOff, this, [this, frame](int chan, int pitch, int vol) {
+        addMessage(frame(), MIDI_STATUS_NOTEOFF | chan, pitch, vol);
+    });
+    connect(&smf, &File::QSmf::signalSMFKeyPress, this, [this, frame](int chan, int pitch, int press) {
+        addMessage(frame(), MIDI_STATUS_KEYPRESURE | chan, pitch, press);
+    });
+    connect(&smf, &File::QSmf::signalSMFCtlChange, this, [this, frame](int chan, int ctl, int value) {
+        addMessage(frame(), MIDI_STATUS_CONTROLCHANGE | chan, ctl, value);
+    });
+    connect(&smf, &File::QSmf::signalSMFPitchBend, this, [this, frame](int chan, int value) {
+        int v = value + 8192;
+        addMessage(frame(), MIDI_STATUS_PITCHBEND | chan, MIDI_LSB(v), MIDI_MSB(v));
+    });
+    connect(&smf, &File::QSmf::signalSMFProgram, this, [this, frame](int chan, int patch) {
+        addMessage(frame(), MIDI_STATUS_PROGRAMCHANGE | chan, patch);
+    });
+    connect(&smf, &File::QSmf::signalSMFChanPress, this, [this, frame](int chan, int press) {
+        addMessage(frame(), MIDI_STATUS_CHANNELPRESSURE | chan, press);
+    });
+    smf.readFromFile(fileName);
+    return m_errorString.isEmpty();
+}
+
+int FluidRenderer::messageCount() const
+{
+    return m_messages.count();
+}
+
+/* the largest number of frames written by a single fluid_synth_write_s16() call */
+void FluidRenderer::setBlockSize(int frames)
+{
+    m_blockSize = qBound(64, frames, 8192);
+}
+
+int FluidRenderer::blockSize() const
+{
+    return m_blockSize;
+}
+
+void FluidRenderer::setTailTime(int milliseconds)
+{
+    m_tailTime = qMax(milliseconds, 0);
+}
+
+int FluidRenderer::tailTime() const
+{
+    return m_tailTime;
+}
+
+void FluidRenderer::sortMessages()
+{
+    if (!m_sorted) {
+        std::stable_sort(m_messages.begin(), m_messages.end(),
+            [](const FluidMessage &a, const FluidMessage &b) {
+                return a.frame < b.frame;
+            });
+        m_sorted = true;
+    }
+}
+
+/* frames to be rendered: up to the last message, plus the tail time */
+qint64 FluidRenderer::length()
+{
+    sortMessages();
+    qint64 last = m_messages.isEmpty() ? 0 : m_messages.last().frame;
+    return last + qint64(m_tailTime) * sampleRate() / 1000;
+}
+
+void FluidRenderer::sendMessage(const FluidMessage &msg)
+{
+    fluid_synth_t *synth = m_engine.synth();
+    const int chan = msg.data[0] & MIDI_CHANNEL_MASK;
+    switch (msg.data[0] & MIDI_STATUS_MASK) {
+    case MIDI_STATUS_NOTEOFF:
+        ::fluid_synth_noteoff(synth, chan, msg.data[1]);
+        break;
+    case MIDI_STATUS_NOTEON:
+        ::fluid_synth_noteon(synth, chan, msg.data[1], msg.data[2]);
+        break;
+    case MIDI_STATUS_KEYPRESURE:
+#if FLUIDSYNTH_VERSION_MAJOR >= 2
+        ::fluid_synth_key_pressure(synth, chan, msg.data[1], msg.data[2]);
+#endif
+        break;
+    case MIDI_STATUS_CONTROLCHANGE:
+        ::fluid_synth_cc(synth, chan, msg.data[1], msg.data[2]);
+        break;
+    case MIDI_STATUS_PROGRAMCHANGE:
+        ::fluid_synth_program_change(synth, chan, msg.data[1]);
+        break;
+    case MIDI_STATUS_CHANNELPRESSURE:
+        ::fluid_synth_channel_pressure(synth, chan, msg.data[1]);
+        break;
+    case MIDI_STATUS_PITCHBEND:
+        ::fluid_synth_pitch_bend(synth, chan, msg.data[1] + (msg.data[2] << 7));
+        break;
+    }
+}
+
+/*
+ * The synth is reset, then rendered in blocks of up to blockSize() frames
+ * which are split at the frame of each message, so every message is
+ * applied at its own frame (FluidSynth rounds it to its internal 64 frame
+ * period). Returns the number of frames rendered, or -1 on error.
+ */
+qint64 FluidRenderer::render(Callback callback)
+{
+    fluid_synth_t *synth = m_engine.synth();
+    if (synth == nullptr) {
+        m_errorString = QStringLiteral("FluidSynth not initialized");
+        return -1;
+    }
+    const qint64 end = length();
+    QVector<qint16> buffer(m_blockSize * CHANNELS);
+    qint16 *data = buffer.data();
+    ::fluid_synth_system_reset(synth);
+    qint64 frame = 0;
+    int next = 0;
+    while (frame < end) {
+        while (next < m_messages.count() && m_messages.at(next).frame <= frame) {
+            sendMessage(m_messages.at(next));
+            ++next;
+        }
+        qint64 limit = qMin(end, frame + m_blockSize);
+        if (next < m_messages.count()) {
+            limit = qMin(limit, m_messages.at(next).frame);
+        }
+        const int frames = int(limit - frame);
+        if (::fluid_synth_write_s16(synth, frames, data, 0, CHANNELS, data, 1, CHANNELS) != FLUID_OK) {
+            m_errorString = QStringLiteral("FluidSynth rendering failed");
+            return -1;
+        }
+        if (callback) {
+            callback(data, frames);
+        }
+        frame = limit;
+    }
+    return frame;
+}
+
+/* Renders the whole sequence into memory, or returns an empty vector on error. */
+QVector<qint16> FluidRenderer::renderToBuffer()
+{
+    QVector<qint16> samples(int(length() * CHANNELS));
+    qint16 *out = samples.data();
+    qint64 frames = render([&out](const qint16 *pcm, int count) {
+        memcpy(out, pcm, sizeof(qint16) * count * CHANNELS);
+        out += count * CHANNELS;
+    });
+    if (frames < 0) {
+        samples.clear();
+    }
+    return samples;
+}
+
+/*
+ * Writes a RIFF WAVE file when the file name ends with ".wav", or raw
+ * little endian PCM samples otherwise.
+ */
+bool FluidRenderer::renderToFile(const QString &fileName)
+{
+    const int WAV_HEADER_SIZE = 44;
+    const int frameBytes = CHANNELS * int(sizeof(qint16));
+    const bool wave = fileName.endsWith(QLatin1String(".wav"), Qt::CaseInsensitive);
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+    if (wave) {
+        file.write(QByteArray(WAV_HEADER_SIZE, '\0'));
+    }
+    QVector<qint16> samples(m_blockSize * CHANNELS);
+    bool ok = true;
+    qint64 frames = render([&](const qint16 *pcm, int count) {
+        const char *data = reinterpret_cast<const char *>(pcm);
+        if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) {
+            for (int i = 0; i < count * CHANNELS; ++i) {
+                samples[i] = qToLittleEndian<qint16>(pcm[i]);
+            }
+            data = reinterpret_cast<const char *>(samples.constData());
+        }
+        if (ok && file.write(data, count * frameBytes) != count * frameBytes) {
+            m_errorString = file.errorString();
+            ok = false;
+        }
+    });
+    if (frames < 0 || !ok) {
+        file.close();
+        return false;
+    }
+    if (wave) {
+        uchar header[WAV_HEADER_SIZE];
+        const quint32 dataBytes = quint32(frames * frameBytes);
+        const quint32 rate = quint32(sampleRate());
+        memcpy(header, "RIFF", 4);
+        qToLittleEndian<quint32>(dataBytes + WAV_HEADER_SIZE - 8, header + 4);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        qToLittleEndian<quint32>(16, header + 16);
+        qToLittleEndian<quint16>(1, header + 20); /* PCM */
+        qToLittleEndian<quint16>(quint16(CHANNELS), header + 22);
+        qToLittleEndian<quint32>(rate, header + 24);
+        qToLittleEndian<quint32>(rate * frameBytes, header + 28);
+        qToLittleEndian<quint16>(quint16(frameBytes), header + 32);
+        qToLittleEndian<quint16>(16, header + 34);
+        memcpy(header + 36, "data", 4);
+        qToLittleEndian<quint32>(dataBytes, header + 40);
+        file.seek(0);
+        file.write(reinterpret_cast<const char *>(header), WAV_HEADER_SIZE);
+    }
+    file.close();
+    return true;
+}
+
+QString FluidRenderer::errorString() const
+{
+    return m_errorString;
+}
+
+}} // namespace drumstick::rt
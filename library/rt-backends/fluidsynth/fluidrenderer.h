@@ -0,0 +1,89 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2021 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FLUIDRENDERER_H
+#define FLUIDRENDERER_H
+
+#include <functional>
+#include <QObject>
+#include <QSettings>
+#include <QString>
+#include <QVector>
+#include "synthengine.h"
+
+namespace drumstick { namespace rt {
+
+/*
+ * Renders a sequence of MIDI messages with FluidSynth as fast as the CPU
+ * allows, calling fluid_synth_write_s16() instead of running an audio
+ * driver. The rendered samples (stereo, interleaved, 16 bits, native
+ * endianness) are handed to a callback, collected in memory, or written
+ * to a WAV or raw PCM file.
+ */
+class FluidRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void(const qint16 *samples, int frames)> Callback;
+
+    static const int CHANNELS = 2;
+    static const int DEFAULT_BLOCKSIZE = 1024;
+
+    explicit FluidRenderer(QObject *parent = nullptr);
+    virtual ~FluidRenderer();
+
+    void initialize(QSettings* settings);
+    SynthEngine *engine();
+    int sampleRate() const;
+    int channels() const;
+
+    void clear();
+    void addMessage(qint64 frame, int m0, int m1 = 0, int m2 = 0);
+    bool loadSMF(const QString &fileName);
+    int messageCount() const;
+    void setBlockSize(int frames);
+    int blockSize() const;
+    void setTailTime(int milliseconds);
+    int tailTime() const;
+    qint64 length();
+
+    qint64 render(Callback callback);
+    QVector<qint16> renderToBuffer();
+    bool renderToFile(const QString &fileName);
+    QString errorString() const;
+
+private:
+    struct FluidMessage {
+        qint64 frame;
+        quint8 data[3];
+    };
+    void sortMessages();
+    void sendMessage(const FluidMessage &msg);
+
+    SynthEngine m_engine;
+    QVector<FluidMessage> m_messages;
+    bool m_sorted;
+    int m_blockSize;
+    int m_tailTime;
+    QString m_errorString;
+};
+
+}} // namespace drumstick::rt
+
+#endif // FLUIDRENDERER_H
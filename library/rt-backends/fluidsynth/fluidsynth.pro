@@ -7,10 +7,12 @@ DEPENDPATH += ../../include
 INCLUDEPATH += ../../include
 QT -= gui
 
-HEADERS += synthengine.h \
+HEADERS += soundfontcache.h \
+           soundfontindex.h \
+           synthengine.h \
            synthoutput.h
 
-SOURCES += synthoutput.cpp synthengine.cpp
+SOURCES += soundfontcache.cpp soundfontindex.cpp synthoutput.cpp synthengine.cpp
 
 LIBS += -L$$OUT_PWD/../../../build/lib -ldrumstick-rt
 
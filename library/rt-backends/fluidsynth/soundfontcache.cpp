@@ -0,0 +1,302 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2021 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include "soundfontcache.h"
+
+namespace drumstick { namespace rt {
+
+#if FLUIDSYNTH_VERSION_MAJOR > 2 || (FLUIDSYNTH_VERSION_MAJOR == 2 && FLUIDSYNTH_VERSION_MINOR >= 2)
+#define FLUID_FILE_CALLBACKS 1
+
+/*
+ * File callbacks of the loader synth, reporting the position of the
+ * SoundFont reader to the Progress function of the load running in the
+ * calling thread. Samples loaded on demand later are read without it.
+ */
+namespace {
+
+thread_local const SoundFontCache::Progress *loadProgress = nullptr;
+
+struct ProgressFile {
+    QFile file;
+    int percent;
+    const SoundFontCache::Progress *progress;
+};
+
+void *progressOpen(const char *filename)
+{
+    ProgressFile *handle = new ProgressFile;
+    handle->file.setFileName(QFile::decodeName(filename));
+    if (!handle->file.open(QIODevice::ReadOnly)) {
+        delete handle;
+        return nullptr;
+    }
+    handle->percent = -1;
+    handle->progress = (loadProgress != nullptr && *loadProgress) ? loadProgress : nullptr;
+    return handle;
+}
+
+void reportProgress(ProgressFile *handle)
+{
+    if (handle->progress != nullptr) {
+        int percent = int(handle->file.pos() * 100 / qMax<qint64>(handle->file.size(), 1));
+        percent = qBound(0, percent, 99);
+        if (percent != handle->percent) {
+            handle->percent = percent;
+            (*handle->progress)(percent);
+        }
+    }
+}
+
+int progressRead(void *buf, fluid_long_long_t count, void *handle)
+{
+    ProgressFile *f = static_cast<ProgressFile *>(handle);
+    if (f->file.read(static_cast<char *>(buf), count) != count) {
+        return FLUID_FAILED;
+    }
+    reportProgress(f);
+    return FLUID_OK;
+}
+
+int progressSeek(void *handle, fluid_long_long_t offset, int origin)
+{
+    ProgressFile *f = static_cast<ProgressFile *>(handle);
+    qint64 position = offset;
+    if (origin == SEEK_CUR) {
+        position += f->file.pos();
+    } else if (origin == SEEK_END) {
+        position += f->file.size();
+    }
+    if (!f->file.seek(position)) {
+        return FLUID_FAILED;
+    }
+    reportProgress(f);
+    return FLUID_OK;
+}
+
+fluid_long_long_t progressTell(void *handle)
+{
+    return static_cast<ProgressFile *>(handle)->file.pos();
+}
+
+int progressClose(void *handle)
+{
+    delete static_cast<ProgressFile *>(handle);
+    return FLUID_OK;
+}
+
+} // anonymous namespace
+#endif
+
+SoundFontCache *SoundFontCache::instance()
+{
+    static SoundFontCache cache;
+    return &cache;
+}
+
+SoundFontCache::SoundFontCache() :
+    m_capacity(2),
+    m_useCounter(0),
+    m_loaderSettings(nullptr),
+    m_loaderSynth(nullptr)
+{ }
+
+SoundFontCache::~SoundFontCache()
+{
+    foreach(const Entry &entry, m_entries) {
+        ::delete_fluid_sfont(entry.sfont);
+    }
+    m_entries.clear();
+    if (m_loaderSynth != nullptr) {
+        ::delete_fluid_synth(m_loaderSynth);
+    }
+    if (m_loaderSettings != nullptr) {
+        ::delete_fluid_settings(m_loaderSettings);
+    }
+}
+
+int SoundFontCache::indexOf(const QString &fileName, const QDateTime &modified, const void *owner) const
+{
+    for (int i = 0; i < m_entries.count(); ++i) {
+        const Entry &entry = m_entries.at(i);
+        if (entry.owner == owner && entry.modified == modified && entry.fileName == fileName) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Returns the font if it is already loaded, without reading the file.
+ * The font must be given back with release() when no longer used.
+ */
+fluid_sfont_t *SoundFontCache::acquireCached(const QString &fileName, const void *owner)
+{
+    QFileInfo info(fileName);
+    if (!info.isFile()) {
+        return nullptr;
+    }
+    QMutexLocker locker(&m_mutex);
+    int i = indexOf(info.absoluteFilePath(), info.lastModified(), owner);
+    if (i < 0) {
+        return nullptr;
+    }
+    Entry &entry = m_entries[i];
+    entry.users++;
+    entry.lastUse = ++m_useCounter;
+    return entry.sfont;
+}
+
+/*
+ * Returns the font, loading it if needed. Loads are serialized, and may
+ * take seconds: this function should not be called from a GUI thread.
+ * Returns nullptr if the file is not a valid SoundFont.
+ */
+fluid_sfont_t *SoundFontCache::acquire(const QString &fileName, const void *owner, Progress progress)
+{
+    fluid_sfont_t *sfont = acquireCached(fileName, owner);
+    if (sfont != nullptr) {
+        if (progress) {
+            progress(100);
+        }
+        return sfont;
+    }
+    QMutexLocker loaderLocker(&m_loaderMutex);
+    /* another thread may have loaded it meanwhile */
+    sfont = acquireCached(fileName, owner);
+    if (sfont == nullptr) {
+        QFileInfo info(fileName);
+        sfont = load(info.absoluteFilePath(), progress);
+        if (sfont == nullptr) {
+            return nullptr;
+        }
+        QMutexLocker locker(&m_mutex);
+        m_entries.append(Entry{info.absoluteFilePath(), info.lastModified(), owner, sfont, 1, ++m_useCounter});
+        evict();
+    }
+    if (progress) {
+        progress(100);
+    }
+    return sfont;
+}
+
+/* called with m_loaderMutex locked */
+fluid_sfont_t *SoundFontCache::load(const QString &fileName, Progress progress)
+{
+    if (m_loaderSynth == nullptr) {
+        m_loaderSettings = ::new_fluid_settings();
+        m_loaderSynth = ::new_fluid_synth(m_loaderSettings);
+#if defined(FLUID_FILE_CALLBACKS)
+        fluid_sfloader_t *loader = ::new_fluid_defsfloader(m_loaderSettings);
+        ::fluid_sfloader_set_callbacks(loader, progressOpen, progressRead,
+                                       progressSeek, progressTell, progressClose);
+        ::fluid_synth_add_sfloader(m_loaderSynth, loader);
+#endif
+    }
+    if (progress) {
+        progress(0);
+    }
+#if defined(FLUID_FILE_CALLBACKS)
+    loadProgress = &progress;
+#endif
+    int sfid = ::fluid_synth_sfload(m_loaderSynth, QFile::encodeName(fileName).constData(), 0);
+#if defined(FLUID_FILE_CALLBACKS)
+    loadProgress = nullptr;
+#endif
+    if (sfid == FLUID_FAILED) {
+        return nullptr;
+    }
+    fluid_sfont_t *sfont = ::fluid_synth_get_sfont_by_id(m_loaderSynth, sfid);
+    /* from now on, the font belongs to the cache */
+    ::fluid_synth_remove_sfont(m_loaderSynth, sfont);
+    return sfont;
+}
+
+/*
+ * The font must have been removed from the synth stack before. It remains
+ * loaded until evicted by newer unused fonts.
+ */
+void SoundFontCache::release(fluid_sfont_t *sfont)
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < m_entries.count(); ++i) {
+        Entry &entry = m_entries[i];
+        if (entry.sfont == sfont) {
+            entry.users = qMax(0, entry.users - 1);
+            entry.lastUse = ++m_useCounter;
+            break;
+        }
+    }
+    evict();
+}
+
+/*
+ * Deletes the least recently used fonts without users beyond the capacity.
+ * FluidSynth refuses to delete a font with samples still referenced by
+ * sounding voices: those are retried on the next call.
+ */
+void SoundFontCache::evict()
+{
+    QList<int> unused;
+    for (int i = 0; i < m_entries.count(); ++i) {
+        if (m_entries.at(i).users == 0) {
+            unused << i;
+        }
+    }
+    std::sort(unused.begin(), unused.end(), [this](int a, int b) {
+        return m_entries.at(a).lastUse < m_entries.at(b).lastUse;
+    });
+    QList<int> deleted;
+    int excess = unused.count() - m_capacity;
+    for (int i = 0; i < unused.count() && excess > 0; ++i) {
+        if (::delete_fluid_sfont(m_entries.at(unused.at(i)).sfont) == 0) {
+            deleted << unused.at(i);
+            --excess;
+        }
+    }
+    std::sort(deleted.begin(), deleted.end(), std::greater<int>());
+    foreach(int i, deleted) {
+        m_entries.removeAt(i);
+    }
+}
+
+void SoundFontCache::setCapacity(int fonts)
+{
+    QMutexLocker locker(&m_mutex);
+    m_capacity = qMax(0, fonts);
+    evict();
+}
+
+int SoundFontCache::capacity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_capacity;
+}
+
+int SoundFontCache::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.count();
+}
+
+}} // namespace drumstick::rt
@@ -0,0 +1,83 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2021 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SOUNDFONTCACHE_H
+#define SOUNDFONTCACHE_H
+
+#include <functional>
+#include <QDateTime>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <fluidsynth.h>
+
+namespace drumstick { namespace rt {
+
+/*
+ * Process wide cache of loaded SoundFonts, keyed by file name, modification
+ * time and owner. The fonts are loaded by a private synth without audio
+ * output, so loading never holds the API lock of a playing synth, and are
+ * then detached from it: a font can be added to the stack of any synth, and
+ * stays in memory while its owner uses it. Every owner gets its own loaded
+ * font: FluidSynth rewrites the font id when adding it to a synth and counts
+ * the sample references without locking, so a fluid_sfont_t can not be used
+ * by two live synths. Up to capacity() fonts no longer used are kept loaded,
+ * so switching back to them does not read the file again.
+ */
+class SoundFontCache
+{
+public:
+    typedef std::function<void(int percent)> Progress;
+
+    static SoundFontCache *instance();
+    ~SoundFontCache();
+
+    fluid_sfont_t *acquire(const QString &fileName, const void *owner, Progress progress = nullptr);
+    fluid_sfont_t *acquireCached(const QString &fileName, const void *owner);
+    void release(fluid_sfont_t *sfont);
+    void setCapacity(int fonts);
+    int capacity() const;
+    int count() const;
+
+private:
+    struct Entry {
+        QString fileName;
+        QDateTime modified;
+        const void *owner;
+        fluid_sfont_t *sfont;
+        int users;
+        quint64 lastUse;
+    };
+
+    SoundFontCache();
+    fluid_sfont_t *load(const QString &fileName, Progress progress);
+    int indexOf(const QString &fileName, const QDateTime &modified, const void *owner) const;
+    void evict();
+
+    mutable QMutex m_mutex;
+    QMutex m_loaderMutex;
+    QList<Entry> m_entries;
+    int m_capacity;
+    quint64 m_useCounter;
+    fluid_settings_t *m_loaderSettings;
+    fluid_synth_t *m_loaderSynth;
+};
+
+}} // namespace drumstick::rt
+
+#endif // SOUNDFONTCACHE_H
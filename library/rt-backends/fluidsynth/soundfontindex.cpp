@@ -0,0 +1,187 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2021 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+#include "soundfontindex.h"
+
+namespace drumstick { namespace rt {
+
+SoundFontIndex::SoundFontIndex(const QString &fileName) :
+    m_fileName(fileName),
+    m_scanned(0)
+{ }
+
+QString SoundFontIndex::defaultFileName()
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation));
+    return dir.absoluteFilePath(QStringLiteral("drumstick/soundfonts.ini"));
+}
+
+QString SoundFontIndex::fileName() const
+{
+    return m_fileName;
+}
+
+/* replaces the index contents with the file contents; false if there is no index yet */
+bool SoundFontIndex::load()
+{
+    m_roots.clear();
+    m_directories.clear();
+    if (!QFileInfo::exists(m_fileName)) {
+        return false;
+    }
+    QSettings settings(m_fileName, QSettings::IniFormat);
+    m_roots = settings.value(QStringLiteral("roots")).toStringList();
+    int count = settings.beginReadArray(QStringLiteral("directories"));
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        Directory dir;
+        dir.modified = QDateTime::fromMSecsSinceEpoch(settings.value(QStringLiteral("modified")).toLongLong());
+        dir.files = settings.value(QStringLiteral("files")).toStringList();
+        dir.subdirs = settings.value(QStringLiteral("subdirs")).toStringList();
+        m_directories.insert(settings.value(QStringLiteral("path")).toString(), dir);
+    }
+    settings.endArray();
+    return settings.status() == QSettings::NoError;
+}
+
+bool SoundFontIndex::save() const
+{
+    QFileInfo info(m_fileName);
+    if (!info.dir().exists() && !QDir().mkpath(info.absolutePath())) {
+        return false;
+    }
+    QSettings settings(m_fileName, QSettings::IniFormat);
+    settings.clear();
+    settings.setValue(QStringLiteral("roots"), m_roots);
+    settings.beginWriteArray(QStringLiteral("directories"), m_directories.count());
+    int i = 0;
+    for (auto it = m_directories.constBegin(); it != m_directories.constEnd(); ++it, ++i) {
+        settings.setArrayIndex(i);
+        settings.setValue(QStringLiteral("path"), it.key());
+        settings.setValue(QStringLiteral("modified"), it.value().modified.toMSecsSinceEpoch());
+        settings.setValue(QStringLiteral("files"), it.value().files);
+        settings.setValue(QStringLiteral("subdirs"), it.value().subdirs);
+    }
+    settings.endArray();
+    settings.sync();
+    return settings.status() == QSettings::NoError;
+}
+
+/*
+ * Walks the trees below the roots, reusing the stored entries of the
+ * unchanged directories. Directories no longer reachable are dropped.
+ */
+void SoundFontIndex::refresh(const QStringList &roots)
+{
+    QHash<QString, Directory> previous;
+    previous.swap(m_directories);
+    m_canonicalPaths.clear();
+    m_scanned = 0;
+    m_roots.clear();
+    foreach(const QString &root, roots) {
+        QString path = QDir(root).absolutePath();
+        m_roots << path;
+        refreshDirectory(path, previous);
+    }
+}
+
+void SoundFontIndex::refreshDirectory(const QString &path, const QHash<QString, Directory> &previous)
+{
+    QFileInfo info(path);
+    if (!info.isDir()) {
+        return;
+    }
+    /* each directory once, even when reached by symbolic links */
+    const QString canonicalPath = info.canonicalFilePath();
+    if (m_canonicalPaths.contains(canonicalPath)) {
+        return;
+    }
+    m_canonicalPaths.insert(canonicalPath);
+    Directory dir;
+    auto it = previous.constFind(path);
+    if (it != previous.constEnd() && it.value().modified == info.lastModified()) {
+        dir = it.value();
+    } else {
+        ++m_scanned;
+        dir.modified = info.lastModified();
+        QDir d(path);
+        d.setFilter(QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot);
+        d.setSorting(QDir::Name);
+        QStringList filters;
+        filters << "*.sf2" << "*.SF2";
+        foreach(const QFileInfo &entry, d.entryInfoList(filters)) {
+            if (entry.isDir()) {
+                dir.subdirs << entry.fileName();
+            } else if (entry.isFile()) {
+                dir.files << entry.fileName();
+            }
+        }
+    }
+    m_directories.insert(path, dir);
+    foreach(const QString &subdir, dir.subdirs) {
+        refreshDirectory(path + QLatin1Char('/') + subdir, previous);
+    }
+}
+
+QStringList SoundFontIndex::roots() const
+{
+    return m_roots;
+}
+
+/* the indexed files, in walk order, without touching the file system */
+QStringList SoundFontIndex::files() const
+{
+    QStringList files;
+    QSet<QString> visited;
+    foreach(const QString &root, m_roots) {
+        collectFiles(root, files, visited);
+    }
+    return files;
+}
+
+void SoundFontIndex::collectFiles(const QString &path, QStringList &files, QSet<QString> &visited) const
+{
+    auto it = m_directories.constFind(path);
+    if (it == m_directories.constEnd() || visited.contains(path)) {
+        return;
+    }
+    visited.insert(path);
+    foreach(const QString &file, it.value().files) {
+        files << path + QLatin1Char('/') + file;
+    }
+    foreach(const QString &subdir, it.value().subdirs) {
+        collectFiles(path + QLatin1Char('/') + subdir, files, visited);
+    }
+}
+
+int SoundFontIndex::directoryCount() const
+{
+    return m_directories.count();
+}
+
+/* directories listed by the last refresh */
+int SoundFontIndex::scannedDirectories() const
+{
+    return m_scanned;
+}
+
+}} // namespace drumstick::rt
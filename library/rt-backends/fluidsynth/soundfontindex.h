@@ -0,0 +1,73 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2021 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SOUNDFONTINDEX_H
+#define SOUNDFONTINDEX_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+namespace drumstick { namespace rt {
+
+/*
+ * Persistent index of the SoundFont files found below a list of root
+ * directories. Each directory is stored with its modification time, its
+ * SoundFont files and its subdirectories. A refresh only lists again the
+ * directories whose modification time has changed: adding, removing or
+ * renaming an entry changes the time of the directory containing it, so
+ * an unchanged tree costs one stat() per directory.
+ */
+class SoundFontIndex
+{
+public:
+    explicit SoundFontIndex(const QString &fileName = defaultFileName());
+
+    static QString defaultFileName();
+    QString fileName() const;
+
+    bool load();
+    bool save() const;
+    void refresh(const QStringList &roots);
+    QStringList roots() const;
+    QStringList files() const;
+    int directoryCount() const;
+    int scannedDirectories() const;
+
+private:
+    struct Directory {
+        QDateTime modified;
+        QStringList files;
+        QStringList subdirs;
+    };
+
+    void refreshDirectory(const QString &path, const QHash<QString, Directory> &previous);
+    void collectFiles(const QString &path, QStringList &files, QSet<QString> &visited) const;
+
+    QString m_fileName;
+    QStringList m_roots;
+    QHash<QString, Directory> m_directories;
+    QSet<QString> m_canonicalPaths;
+    int m_scanned;
+};
+
+}} // namespace drumstick::rt
+
+#endif // SOUNDFONTINDEX_H
@@ -20,9 +20,13 @@
 #include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
 #include <QSettings>
 #include <QStandardPaths>
 #include <drumstick/rtmidioutput.h>
+#include "soundfontcache.h"
+#include "soundfontindex.h"
 
 namespace drumstick { namespace rt {
 
@@ -41,6 +45,9 @@ const QString SynthEngine::QSTR_CHORUS = QStringLiteral("Chorus");
 const QString SynthEngine::QSTR_REVERB = QStringLiteral("Reverb");
 const QString SynthEngine::QSTR_GAIN = QStringLiteral("Gain");
 const QString SynthEngine::QSTR_POLYPHONY = QStringLiteral("Polyphony");
+const QString SynthEngine::QSTR_CPUCORES = QStringLiteral("CPUCores");
+const QString SynthEngine::QSTR_SOUNDFONTCACHE = QStringLiteral("SoundFontCache");
+const QString SynthEngine::QSTR_BACKGROUNDSCAN = QStringLiteral("BackgroundScan");
 
 const QString SynthEngine::QSTR_DEFAULT_AUDIODRIVER =
 #if defined(Q_OS_LINUX)
@@ -59,14 +66,65 @@ const int SynthEngine::DEFAULT_CHORUS = 0;
 const int SynthEngine::DEFAULT_REVERB = 0;
 const double SynthEngine::DEFAULT_GAIN = .4;
 const int SynthEngine::DEFAULT_POLYPHONY = 32;
+const int SynthEngine::DEFAULT_CPUCORES = 1;
+const int SynthEngine::DEFAULT_SOUNDFONTCACHE = 2;
+const bool SynthEngine::DEFAULT_BACKGROUNDSCAN = true;
+
+class SynthEngine::LoadTask : public QRunnable
+{
+public:
+    LoadTask(SynthEngine *engine, const QString &fileName, bool fallback, int serial) :
+        m_engine(engine),
+        m_fileName(fileName),
+        m_fallback(fallback),
+        m_serial(serial)
+    { }
+
+    void run() override
+    {
+        m_engine->loadSoundFont(m_fileName, m_fallback, m_serial);
+    }
+
+private:
+    SynthEngine *m_engine;
+    QString m_fileName;
+    bool m_fallback;
+    int m_serial;
+};
+
+class SynthEngine::ScanTask : public QRunnable
+{
+public:
+    explicit ScanTask(SynthEngine *engine) : m_engine(engine) { }
+
+    void run() override
+    {
+        m_engine->refreshSoundFonts();
+        // a load queued before the scan could not fall back to the default
+        // font, which was not known yet: let it finish before checking
+        m_engine->m_loader.waitForDone();
+        m_engine->requestDefaultSoundFont();
+    }
+
+private:
+    SynthEngine *m_engine;
+};
 
 SynthEngine::SynthEngine(QObject *parent)
     : QObject(parent),
-      m_sfid(0),
+      m_sfont(nullptr),
+      m_realtime(true),
+      m_backgroundScan(DEFAULT_BACKGROUNDSCAN),
+      m_serial(0),
+      m_pending(0),
       m_settings(nullptr),
       m_synth(nullptr),
       m_driver(nullptr)
-{ }
+{
+    // one loader thread: the requests are served in order
+    m_loader.setMaxThreadCount(1);
+    m_scanner.setMaxThreadCount(1);
+}
 
 SynthEngine::~SynthEngine()
 {
@@ -75,10 +133,19 @@ SynthEngine::~SynthEngine()
 
 void SynthEngine::uninitialize()
 {
+    // a running scan may still request the default SoundFont
+    m_scanner.waitForDone();
+    // the queued loads are superseded, and skipped
+    m_serial.fetchAndAddOrdered(1);
+    m_loader.waitForDone();
     if (m_driver != nullptr) {
         ::delete_fluid_audio_driver(m_driver);
         m_driver = nullptr;
     }
+    {
+        QMutexLocker locker(&m_mutex);
+        detachSoundFont();
+    }
     if (m_synth != nullptr) {
         ::delete_fluid_synth(m_synth);
         m_synth = nullptr;
@@ -99,6 +166,9 @@ void SynthEngine::initializeSynth(QSettings* settings)
     int fs_reverb = DEFAULT_REVERB;
     double fs_gain = DEFAULT_GAIN;
     int fs_polyphony = DEFAULT_POLYPHONY;
+    int fs_cpuCores = DEFAULT_CPUCORES;
+    int fs_soundFontCache = DEFAULT_SOUNDFONTCACHE;
+    bool fs_backgroundScan = DEFAULT_BACKGROUNDSCAN;
     if (settings != nullptr) {
         settings->beginGroup(QSTR_PREFERENCES);
         fs_audiodriver = settings->value(QSTR_AUDIODRIVER, QSTR_DEFAULT_AUDIODRIVER).toString();
@@ -109,9 +179,14 @@ void SynthEngine::initializeSynth(QSettings* settings)
         fs_reverb = settings->value(QSTR_REVERB, DEFAULT_REVERB).toInt();
         fs_gain = settings->value(QSTR_GAIN, DEFAULT_GAIN).toDouble();
         fs_polyphony = settings->value(QSTR_POLYPHONY, DEFAULT_POLYPHONY).toInt();
+        fs_cpuCores = settings->value(QSTR_CPUCORES, DEFAULT_CPUCORES).toInt();
+        fs_soundFontCache = settings->value(QSTR_SOUNDFONTCACHE, DEFAULT_SOUNDFONTCACHE).toInt();
+        fs_backgroundScan = settings->value(QSTR_BACKGROUNDSCAN, DEFAULT_BACKGROUNDSCAN).toBool();
         settings->endGroup();
     }
     uninitialize();
+    m_backgroundScan = fs_backgroundScan;
+    SoundFontCache::instance()->setCapacity(fs_soundFontCache);
     m_settings = ::new_fluid_settings();
     ::fluid_settings_setstr(m_settings, "audio.driver", qPrintable(fs_audiodriver));
     ::fluid_settings_setint(m_settings, "audio.period-size", fs_periodSize);
@@ -121,8 +196,31 @@ void SynthEngine::initializeSynth(QSettings* settings)
     ::fluid_settings_setint(m_settings, "synth.reverb.active", fs_reverb);
     ::fluid_settings_setnum(m_settings, "synth.gain", fs_gain);
     ::fluid_settings_setint(m_settings, "synth.polyphony", fs_polyphony);
+    // voices are rendered by fs_cpuCores - 1 extra threads besides the caller
+    ::fluid_settings_setint(m_settings, "synth.cpu-cores", qMax(1, fs_cpuCores));
     m_synth = ::new_fluid_synth(m_settings);
-    m_driver = ::new_fluid_audio_driver(m_settings, m_synth);
+    // offline engines are rendered by the caller with fluid_synth_write_*()
+    if (m_realtime) {
+        m_driver = ::new_fluid_audio_driver(m_settings, m_synth);
+    }
+}
+
+double SynthEngine::sampleRate() const
+{
+    double rate = DEFAULT_SAMPLERATE;
+    if (m_settings != nullptr) {
+        ::fluid_settings_getnum(m_settings, "synth.sample-rate", &rate);
+    }
+    return rate;
+}
+
+int SynthEngine::cpuCores() const
+{
+    int cores = DEFAULT_CPUCORES;
+    if (m_settings != nullptr) {
+        ::fluid_settings_getint(m_settings, "synth.cpu-cores", &cores);
+    }
+    return cores;
 }
 
 void SynthEngine::setInstrument(int channel, int pgm)
@@ -140,22 +238,127 @@ void SynthEngine::noteOff(int channel, int midiNote, int /*velocity*/)
     ::fluid_synth_noteoff(m_synth, channel, midiNote);
 }
 
-void SynthEngine::loadSoundFont()
+/*
+ * SoundFonts are loaded by the SoundFontCache on the loader thread, while
+ * the synth keeps playing with the previous font. A font found in the cache
+ * is switched to at once, on the calling thread. Each request supersedes
+ * the previous ones, which are skipped if they have not started yet, or
+ * left in the cache if they finish later.
+ */
+void SynthEngine::requestSoundFont(const QString &fileName, bool fallback)
+{
+    const int serial = m_serial.fetchAndAddOrdered(1) + 1;
+    m_pending.ref();
+    fluid_sfont_t *sfont = SoundFontCache::instance()->acquireCached(fileName, this);
+    if (sfont != nullptr) {
+        if (attachSoundFont(sfont, serial)) {
+            emit soundFontLoaded(fileName, true);
+        } else {
+            SoundFontCache::instance()->release(sfont);
+        }
+        m_pending.deref();
+        return;
+    }
+    m_loader.start(new LoadTask(this, fileName, fallback, serial));
+}
+
+/* runs on the loader thread */
+void SynthEngine::loadSoundFont(const QString &fileName, bool fallback, int serial)
+{
+    if (serial == m_serial.load()) {
+        SoundFontCache *cache = SoundFontCache::instance();
+        QString loaded = fileName;
+        QString defSoundFont;
+        {
+            QMutexLocker locker(&m_mutex);
+            defSoundFont = m_defSoundFont;
+        }
+        auto progress = [this, &loaded](int percent) {
+            emit soundFontProgress(loaded, percent);
+        };
+        fluid_sfont_t *sfont = cache->acquire(loaded, this, progress);
+        if (sfont == nullptr && fallback && !defSoundFont.isEmpty() && defSoundFont != fileName) {
+            loaded = defSoundFont;
+            sfont = cache->acquire(loaded, this, progress);
+        }
+        if (sfont == nullptr) {
+            emit soundFontLoaded(fileName, false);
+        } else if (attachSoundFont(sfont, serial)) {
+            if (loaded != fileName) {
+                QMutexLocker locker(&m_mutex);
+                m_soundFont = loaded;
+            }
+            emit soundFontLoaded(loaded, true);
+        } else {
+            cache->release(sfont);
+        }
+    }
+    m_pending.deref();
+}
+
+/*
+ * Replaces the current font of the synth, unless the request has been
+ * superseded. The presets of all channels are selected again.
+ */
+bool SynthEngine::attachSoundFont(fluid_sfont_t *sfont, int serial)
+{
+    QMutexLocker locker(&m_mutex);
+    if (serial != m_serial.load() || m_synth == nullptr) {
+        return false;
+    }
+    if (sfont == m_sfont) {
+        SoundFontCache::instance()->release(sfont);
+        return true;
+    }
+    detachSoundFont();
+    ::fluid_synth_add_sfont(m_synth, sfont);
+    ::fluid_synth_program_reset(m_synth);
+    m_sfont = sfont;
+    return true;
+}
+
+/* called with m_mutex locked */
+void SynthEngine::detachSoundFont()
 {
-    if (m_sfid != -1) {
-        ::fluid_synth_sfunload(m_synth, unsigned(m_sfid), 1);
+    if (m_sfont != nullptr) {
+        if (m_synth != nullptr) {
+            ::fluid_synth_remove_sfont(m_synth, m_sfont);
+        }
+        SoundFontCache::instance()->release(m_sfont);
+        m_sfont = nullptr;
     }
-    m_sfid = ::fluid_synth_sfload(m_synth, qPrintable(m_soundFont), 1);
 }
 
+bool SynthEngine::isLoading() const
+{
+    return m_pending.load() > 0;
+}
+
+void SynthEngine::waitForSoundFont()
+{
+    m_scanner.waitForDone();
+    m_loader.waitForDone();
+}
+
+/*
+ * The SoundFont list is taken from the index saved by the last scan, and
+ * refreshed by a background scan, so the initialization does not wait for
+ * the file system. On the first run there is no index yet: the default
+ * SoundFont is loaded when the background scan finds it.
+ */
 void SynthEngine::initialize(QSettings *settings)
 {
     initializeSynth(settings);
-    scanSoundFonts();
-    loadSoundFont();
-    if (m_sfid < 0) {
-        m_soundFont = m_defSoundFont;
-        loadSoundFont();
+    SoundFontIndex index;
+    if (index.load()) {
+        setSoundFontsList(index.files());
+    }
+    if (m_backgroundScan) {
+        requestSoundFont(soundFont(), true);
+        m_scanner.start(new ScanTask(this));
+    } else {
+        refreshSoundFonts();
+        requestSoundFont(soundFont(), true);
     }
 }
 
@@ -174,35 +377,26 @@ void SynthEngine::bender(const int channel, const int value)
     ::fluid_synth_pitch_bend(m_synth, channel, value + 8192);
 }
 
-void SynthEngine::setSoundFont(const QString &value)
+QString SynthEngine::soundFont() const
 {
-    if (value != m_soundFont) {
-        m_soundFont = value;
-        loadSoundFont();
-    }
+    QMutexLocker locker(&m_mutex);
+    return m_soundFont;
 }
 
-void SynthEngine::scanSoundFonts(const QDir &initialDir)
-{
-    QDir dir(initialDir);
-    dir.setFilter(QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot);
-    dir.setSorting(QDir::Name);
-    QStringList filters;
-    filters << "*.sf2" << "*.SF2";
-    QFileInfoList entries= dir.entryInfoList(filters);
-    foreach(const QFileInfo &info, entries) {
-        QString name = info.absoluteFilePath();
-        if (info.isFile() && info.fileName().toLower() == QSTR_SOUNDFONT) {
-            m_soundFontsList << name;
-        } else if (info.isDir()){
-            scanSoundFonts(name);
+void SynthEngine::setSoundFont(const QString &value)
+{
+    if (value != soundFont()) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_soundFont = value;
         }
+        requestSoundFont(value, false);
     }
 }
 
-void SynthEngine::scanSoundFonts()
+QStringList SynthEngine::soundFontDirs()
 {
-    m_soundFontsList.clear();
+    QStringList dirs;
     QStringList paths = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
 #if defined(Q_OS_OSX)
     paths << (QCoreApplication::applicationDirPath() + QLatin1Literal("../Resources"));
@@ -213,14 +407,66 @@ void SynthEngine::scanSoundFonts()
            d = QDir(p + QDir::separator() + QSTR_DATADIR2);
        }
        if (d.exists()) {
-            scanSoundFonts(d);
+            dirs << d.absolutePath();
        }
     }
+    return dirs;
+}
+
+void SynthEngine::setSoundFontsList(const QStringList &files)
+{
+    QStringList soundFonts;
+    foreach(const QString &name, files) {
+        if (QFileInfo(name).fileName().toLower() == QSTR_SOUNDFONT) {
+            soundFonts << name;
+        }
+    }
+    QMutexLocker locker(&m_mutex);
+    m_soundFontsList = soundFonts;
     if (m_defSoundFont.isEmpty() && m_soundFontsList.length() > 0) {
         m_defSoundFont = m_soundFontsList.first();
     }
 }
 
+/* incremental scan: only the changed directories are listed again */
+void SynthEngine::refreshSoundFonts()
+{
+    SoundFontIndex index;
+    index.load();
+    index.refresh(soundFontDirs());
+    index.save();
+    setSoundFontsList(index.files());
+    emit soundFontsScanned();
+}
+
+/* after a background scan and the loads queued before it, when no SoundFont could be loaded */
+void SynthEngine::requestDefaultSoundFont()
+{
+    QString defSoundFont;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_sfont != nullptr || m_synth == nullptr) {
+            return;
+        }
+        defSoundFont = m_defSoundFont;
+    }
+    if (!defSoundFont.isEmpty() && !isLoading()) {
+        requestSoundFont(defSoundFont, false);
+    }
+}
+
+void SynthEngine::scanSoundFonts()
+{
+    m_scanner.waitForDone();
+    refreshSoundFonts();
+}
+
+QStringList SynthEngine::soundFonts() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_soundFontsList;
+}
+
 void SynthEngine::readSettings(QSettings *settings)
 {
     QDir dir;
@@ -234,11 +480,11 @@ void SynthEngine::readSettings(QSettings *settings)
 #else
     dir = QDir(QStandardPaths::locate(QStandardPaths::GenericDataLocation, QSTR_DATADIR, QStandardPaths::LocateDirectory));
 #endif
+    QMutexLocker locker(&m_mutex);
     QFileInfo sf2(dir, QSTR_SOUNDFONT);
     if (sf2.exists()) {
         m_defSoundFont = sf2.absoluteFilePath();
     }
-    m_sfid = -1;
     //qDebug() << "defSoundFont:" << m_defSoundFont;
     settings->beginGroup(QSTR_PREFERENCES);
     m_soundFont = settings->value(QSTR_INSTRUMENTSDEFINITION, m_defSoundFont).toString();
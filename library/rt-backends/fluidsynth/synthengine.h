@@ -23,7 +23,10 @@
 #include <QString>
 #include <QList>
 #include <QDir>
+#include <QAtomicInt>
+#include <QMutex>
 #include <QSettings>
+#include <QThreadPool>
 #include <drumstick/rtmidioutput.h>
 #include <fluidsynth.h>
 
@@ -38,12 +41,13 @@ public:
     explicit SynthEngine(QObject *parent = nullptr);
     virtual ~SynthEngine();
 
-    QString soundFont() const { return m_soundFont; }
+    QString soundFont() const;
     void setSoundFont(const QString &value);
 
     Q_INVOKABLE void initialize(QSettings *settings);
     Q_INVOKABLE void readSettings(QSettings *settings);
     Q_INVOKABLE void scanSoundFonts();
+    Q_INVOKABLE QStringList soundFonts() const;
     Q_INVOKABLE void panic();
     Q_INVOKABLE void setInstrument(const int channel, int i);
     Q_INVOKABLE void noteOn(const int channel, const int midiNote, const int velocity);
@@ -51,8 +55,15 @@ public:
     Q_INVOKABLE void controlChange(const int channel, const int ctl, const int value);
     Q_INVOKABLE void bender(const int channel, const int value);
     Q_INVOKABLE QString version() const { return QT_STRINGIFY(VERSION); }
+    Q_INVOKABLE bool isLoading() const;
+    Q_INVOKABLE void waitForSoundFont();
 
     MIDIConnection currentConnection() const { return m_currentConnection; }
+    fluid_synth_t* synth() const { return m_synth; }
+    double sampleRate() const;
+    int cpuCores() const;
+    bool realtime() const { return m_realtime; }
+    void setRealtime(bool enable) { m_realtime = enable; }
     void close();
     void open();
     void uninitialize();
@@ -72,6 +83,9 @@ public:
     static const QString QSTR_REVERB;
     static const QString QSTR_GAIN;
     static const QString QSTR_POLYPHONY;
+    static const QString QSTR_CPUCORES;
+    static const QString QSTR_SOUNDFONTCACHE;
+    static const QString QSTR_BACKGROUNDSCAN;
     static const QString QSTR_DEFAULT_AUDIODRIVER;
 
     static const int DEFAULT_PERIODS;
@@ -81,13 +95,37 @@ public:
     static const int DEFAULT_REVERB;
     static const double DEFAULT_GAIN;
     static const int DEFAULT_POLYPHONY;
+    static const int DEFAULT_CPUCORES;
+    static const int DEFAULT_SOUNDFONTCACHE;
+    static const bool DEFAULT_BACKGROUNDSCAN;
+
+signals:
+    void soundFontProgress(const QString &fileName, int percent);
+    void soundFontLoaded(const QString &fileName, bool success);
+    void soundFontsScanned();
 
 private:
-    void scanSoundFonts(const QDir &dir);
-    void initializeSynth(QSettings *settings = nullptr);
-    void loadSoundFont();
+    class LoadTask;
+    class ScanTask;
 
-    int m_sfid;
+    static QStringList soundFontDirs();
+    void setSoundFontsList(const QStringList &files);
+    void refreshSoundFonts();
+    void requestDefaultSoundFont();
+    void initializeSynth(QSettings *settings = nullptr);
+    void requestSoundFont(const QString &fileName, bool fallback);
+    void loadSoundFont(const QString &fileName, bool fallback, int serial);
+    bool attachSoundFont(fluid_sfont_t *sfont, int serial);
+    void detachSoundFont();
+
+    fluid_sfont_t *m_sfont;
+    bool m_realtime;
+    bool m_backgroundScan;
+    mutable QMutex m_mutex;
+    QThreadPool m_loader;
+    QThreadPool m_scanner;
+    QAtomicInt m_serial;
+    QAtomicInt m_pending;
     MIDIConnection m_currentConnection;
     QString m_soundFont;
     QString m_defSoundFont;
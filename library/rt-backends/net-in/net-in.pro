@@ -11,6 +11,7 @@ include (../../../global.pri)
 QT -= gui
 
 HEADERS += ../common/midiparser.h \
+           ../common/netmidipacket.h \
            netmidiinput.h \
            netmidiinput_p.h
 
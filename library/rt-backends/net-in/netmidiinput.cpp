@@ -94,6 +94,16 @@ bool NetMIDIInput::isEnabledMIDIThru()
     return d->m_thruEnabled && (d->m_out != nullptr);
 }
 
+/*
+ * Statistics of the timestamped network transport: packets received, lost,
+ * reordered and late, the estimated jitter, and the average and maximum
+ * delay added by the jitter buffer, in microseconds.
+ */
+QVariantMap NetMIDIInput::statistics() const
+{
+    return d->statistics();
+}
+
 } // namespace rt
 } // namespace drumstick
 
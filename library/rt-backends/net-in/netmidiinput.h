@@ -21,6 +21,7 @@
 
 #include <QObject>
 #include <QHostAddress>
+#include <QVariantMap>
 #include <QtPlugin>
 #include <drumstick/rtmidiinput.h>
 
@@ -34,6 +35,7 @@ namespace rt {
         Q_OBJECT
         Q_PLUGIN_METADATA(IID "net.sourceforge.drumstick.rt.MIDIInput/2.0")
         Q_INTERFACES(drumstick::rt::MIDIInput)
+        Q_PROPERTY(QVariantMap statistics READ statistics)
     public:
         explicit NetMIDIInput(QObject *parent = nullptr);
 
@@ -52,6 +54,8 @@ namespace rt {
         virtual void enableMIDIThru(bool enable) override;
         virtual bool isEnabledMIDIThru() override;
 
+        QVariantMap statistics() const;
+
         static const QString DEFAULT_PUBLIC_NAME;
         static const QString STR_ADDRESS_IPV4;
         static const QString STR_ADDRESS_IPV6;
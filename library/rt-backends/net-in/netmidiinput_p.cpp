@@ -21,6 +21,7 @@
 
 #include "netmidiinput.h"
 #include "netmidiinput_p.h"
+#include "netmidipacket.h"
 
 namespace drumstick { namespace rt {
 
@@ -33,11 +34,16 @@ NetMIDIInputPrivate::NetMIDIInputPrivate(QObject *parent) : QObject(parent),
     m_port(0),
     m_publicName(NetMIDIInput::DEFAULT_PUBLIC_NAME),
     m_groupAddress(QHostAddress(NetMIDIInput::STR_ADDRESS_IPV4)),
-    m_ipv6(false)
+    m_ipv6(false),
+    m_maxBufferDelay(20)
 {
     for(int i=NetMIDIInput::MULTICAST_PORT; i<NetMIDIInput::LAST_PORT; ++i) {
         m_inputDevices << MIDIConnection(QString::number(i), i);
     }
+    m_playoutTimer.setSingleShot(true);
+    m_playoutTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_playoutTimer, &QTimer::timeout, this, &NetMIDIInputPrivate::processPendingPackets);
+    resetStatistics();
 }
 
 void NetMIDIInputPrivate::open(const MIDIConnection& portName)
@@ -50,6 +56,8 @@ void NetMIDIInputPrivate::open(const MIDIConnection& portName)
         m_parser = new MIDIParser(m_inp);
         m_port = static_cast<quint16>(p);
         m_currentInput = portName;
+        resetStatistics();
+        m_clock.start();
         bool res = m_socket->bind(m_ipv6 ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4, m_port, QUdpSocket::ShareAddress);
         if (res) {
 #ifdef Q_OS_WIN
@@ -71,6 +79,8 @@ void NetMIDIInputPrivate::open(const MIDIConnection& portName)
 
 void NetMIDIInputPrivate::close()
 {
+    m_playoutTimer.stop();
+    m_pending.clear();
     delete m_socket;
     delete m_parser;
     m_socket = nullptr;
@@ -85,6 +95,7 @@ void NetMIDIInputPrivate::initialize(QSettings *settings)
         QString ifaceName = settings->value("interface", QString()).toString();
         m_ipv6 = settings->value("ipv6", false).toBool();
         QString address = settings->value("address", m_ipv6 ? NetMIDIInput::STR_ADDRESS_IPV6 : NetMIDIInput::STR_ADDRESS_IPV4).toString();
+        m_maxBufferDelay = settings->value("jitter_buffer", 20).toInt();
         settings->endGroup();
         if (!ifaceName.isEmpty()) {
             m_iface = QNetworkInterface::interfaceFromName(ifaceName);
@@ -107,14 +118,138 @@ void NetMIDIInputPrivate::setMIDIThruDevice(MIDIOutput* device)
 
 void NetMIDIInputPrivate::processIncomingMessages()
 {
+    // a datagram may contain several messages, using running status
     while (m_socket->hasPendingDatagrams()) {
-        QByteArray datagram;
-        datagram.resize(static_cast<int>(m_socket->pendingDatagramSize()));
-        m_socket->readDatagram(datagram.data(), datagram.size());
+        m_datagram.resize(static_cast<int>(m_socket->pendingDatagramSize()));
+        m_socket->readDatagram(m_datagram.data(), m_datagram.size());
+        quint32 seq;
+        quint64 timestamp;
+        if (readNetMIDIHeader(reinterpret_cast<const uchar *>(m_datagram.constData()), m_datagram.size(), seq, timestamp)) {
+            processTimestampedPacket(seq, timestamp,
+                                     m_datagram.constData() + NETMIDI_HEADER_SIZE,
+                                     m_datagram.size() - NETMIDI_HEADER_SIZE);
+        } else if (m_parser != nullptr) {
+            m_parser->parse(m_datagram);
+        }
+    }
+}
+
+/*
+ * Adaptive jitter buffer. The clock offset between sender and receiver is
+ * estimated as the minimum transit time (arrival - sender timestamp) seen in
+ * a sliding window, and the jitter is estimated like RFC 3550 does. Each
+ * packet is played at its sender timestamp plus the offset plus a delay of
+ * three times the jitter, limited by m_maxBufferDelay milliseconds.
+ * The offset and the jitter estimates may shrink from one packet to the
+ * next, so the pending packets are kept in sequence order and the due
+ * times are raised to be monotonic along it: the MIDI stream is never
+ * reordered by the buffer.
+ */
+void NetMIDIInputPrivate::processTimestampedPacket(quint32 seq, quint64 timestamp, const char *payload, int size)
+{
+    const int TRANSIT_WINDOW = 256;
+    qint64 now = m_clock.nsecsElapsed() / 1000;
+    qint64 transit = now - static_cast<qint64>(timestamp);
+    m_packets++;
+
+    if (!m_synced) {
+        m_synced = true;
+        m_expectedSeq = seq + 1;
+        m_minTransit = m_windowMinTransit = m_lastTransit = transit;
+    } else {
+        qint32 gap = static_cast<qint32>(seq - m_expectedSeq);
+        if (gap >= 0) {
+            m_lost += static_cast<quint32>(gap);
+            m_expectedSeq = seq + 1;
+        } else {
+            // a packet counted as lost has finally arrived
+            m_reordered++;
+            if (m_lost > 0) {
+                m_lost--;
+            }
+        }
+        qint64 d = qAbs(transit - m_lastTransit);
+        m_jitter += (d - m_jitter) / 16.0;
+        m_lastTransit = transit;
+        m_minTransit = qMin(m_minTransit, transit);
+        m_windowMinTransit = qMin(m_windowMinTransit, transit);
+        if (m_packets % TRANSIT_WINDOW == 0) {
+            // follow the clock drift between sender and receiver
+            m_minTransit = m_windowMinTransit;
+            m_windowMinTransit = transit;
+        }
+    }
+
+    qint64 delay = qMin(static_cast<qint64>(3.0 * m_jitter), m_maxBufferDelay * 1000LL);
+    qint64 due = static_cast<qint64>(timestamp) + m_minTransit + delay;
+    if (due < now) {
+        m_late++;
+        due = now;
+    }
+    int i = m_pending.count();
+    while (i > 0 && static_cast<qint32>(m_pending.at(i - 1).seq - seq) > 0) {
+        --i;
+    }
+    due = qMax(due, m_lastDue);
+    if (i > 0) {
+        due = qMax(due, m_pending.at(i - 1).due);
+    }
+    m_pending.insert(i, NetMIDIPendingPacket{seq, due, now, QByteArray(payload, size)});
+    for (int j = i + 1; j < m_pending.count() && m_pending.at(j).due < due; ++j) {
+        m_pending[j].due = due;
+    }
+    processPendingPackets();
+}
+
+void NetMIDIInputPrivate::processPendingPackets()
+{
+    qint64 now = m_clock.nsecsElapsed() / 1000;
+    while (!m_pending.isEmpty() && m_pending.first().due <= now) {
+        NetMIDIPendingPacket packet = m_pending.takeFirst();
+        m_lastDue = packet.due;
+        qint64 bufferDelay = now - packet.arrival;
+        m_totalDelay += bufferDelay;
+        m_maxDelay = qMax(m_maxDelay, bufferDelay);
+        m_delivered++;
         if (m_parser != nullptr) {
-            m_parser->parse(datagram);
+            m_parser->parse(packet.payload);
         }
     }
+    if (!m_pending.isEmpty()) {
+        qint64 wait = m_pending.first().due - now;
+        m_playoutTimer.start(static_cast<int>((wait + 999) / 1000));
+    }
+}
+
+void NetMIDIInputPrivate::resetStatistics()
+{
+    m_synced = false;
+    m_expectedSeq = 0;
+    m_minTransit = 0;
+    m_windowMinTransit = 0;
+    m_lastTransit = 0;
+    m_lastDue = 0;
+    m_jitter = 0.0;
+    m_packets = 0;
+    m_lost = 0;
+    m_reordered = 0;
+    m_late = 0;
+    m_delivered = 0;
+    m_totalDelay = 0;
+    m_maxDelay = 0;
+}
+
+QVariantMap NetMIDIInputPrivate::statistics() const
+{
+    QVariantMap stats;
+    stats["packets"] = m_packets;
+    stats["lost"] = m_lost;
+    stats["reordered"] = m_reordered;
+    stats["late"] = m_late;
+    stats["jitter_us"] = static_cast<qint64>(m_jitter);
+    stats["buffer_delay_us"] = m_delivered > 0 ? m_totalDelay / static_cast<qint64>(m_delivered) : 0;
+    stats["buffer_delay_max_us"] = m_maxDelay;
+    return stats;
 }
 
 } // namespace rt
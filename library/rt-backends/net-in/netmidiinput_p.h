@@ -22,6 +22,10 @@
 #include <QObject>
 #include <QUdpSocket>
 #include <QNetworkInterface>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVariantMap>
+#include <QList>
 #include "midiparser.h"
 
 namespace drumstick {
@@ -30,6 +34,17 @@ namespace rt {
 class MIDIOutput;
 class NetMIDIInput;
 
+/*
+ * A timestamped datagram waiting in the jitter buffer
+ */
+struct NetMIDIPendingPacket
+{
+    quint32 seq;
+    qint64 due;
+    qint64 arrival;
+    QByteArray payload;
+};
+
 class NetMIDIInputPrivate : public QObject
 {
     Q_OBJECT
@@ -46,17 +61,42 @@ public:
     QList<MIDIConnection> m_inputDevices;
     QStringList m_excludedNames;
     QNetworkInterface m_iface;
+    QByteArray m_datagram;
     bool m_ipv6;
 
+    // timestamped transport and jitter buffer
+    int m_maxBufferDelay;
+    QElapsedTimer m_clock;
+    QTimer m_playoutTimer;
+    QList<NetMIDIPendingPacket> m_pending;
+    bool m_synced;
+    quint32 m_expectedSeq;
+    qint64 m_minTransit;
+    qint64 m_windowMinTransit;
+    qint64 m_lastTransit;
+    qint64 m_lastDue;
+    double m_jitter;
+    quint64 m_packets;
+    quint64 m_lost;
+    quint64 m_reordered;
+    quint64 m_late;
+    quint64 m_delivered;
+    qint64 m_totalDelay;
+    qint64 m_maxDelay;
+
     explicit NetMIDIInputPrivate(QObject *parent = nullptr);
 
     void open(const MIDIConnection& conn);
     void close();
     void initialize(QSettings* settings);
     void setMIDIThruDevice(MIDIOutput* device);
+    void resetStatistics();
+    QVariantMap statistics() const;
+    void processTimestampedPacket(quint32 seq, quint64 timestamp, const char *payload, int size);
 
 public slots:
     void processIncomingMessages();
+    void processPendingPackets();
 };
 
 }}
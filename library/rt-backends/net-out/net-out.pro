@@ -5,14 +5,15 @@ static {
 }
 TARGET = drumstick-rt-net-out
 DESTDIR = ../../../build/lib/drumstick2
-DEPENDPATH += . ../../include
-INCLUDEPATH += . ../../include
+DEPENDPATH += . ../../include ../common
+INCLUDEPATH += . ../../include ../common
 include (../../../global.pri)
 DEPENDPATH += ../../include
 INCLUDEPATH += ../../include
 QT -= gui
 
-HEADERS += netmidioutput.h
+HEADERS += netmidioutput.h \
+           ../common/netmidipacket.h
 SOURCES += netmidioutput.cpp
 
 QT += network
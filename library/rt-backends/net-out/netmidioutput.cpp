@@ -17,9 +17,15 @@
 */
 
 #include "netmidioutput.h"
+#include "netmidipacket.h"
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QNetworkInterface>
 #include <QSettings>
+#include <QThread>
+#include <QTimer>
 #include <QUdpSocket>
 
 namespace drumstick { namespace rt {
@@ -29,6 +35,7 @@ const QString NetMIDIOutput::STR_ADDRESS_IPV4 = QStringLiteral("225.0.0.37");
 const QString NetMIDIOutput::STR_ADDRESS_IPV6 = QStringLiteral("ff12::37");
 const int NetMIDIOutput::MULTICAST_PORT = 21928;
 const int NetMIDIOutput::LAST_PORT = 21948;
+const int NetMIDIOutput::MAX_DATAGRAM_SIZE = 512;
 
 class NetMIDIOutput::NetMIDIOutputPrivate
 {
@@ -42,17 +49,43 @@ public:
     QNetworkInterface m_iface;
     quint16 m_port;
     bool m_ipv6;
+    int m_coalesceTime;
+    quint8 m_runningStatus;
+    QByteArray m_packet;
+    QElapsedTimer m_packetTime;
+    QTimer m_flushTimer;
+    bool m_flushPending;
+    QMutex m_mutex;
+    bool m_timestamps;
+    bool m_loopback;
+    quint32 m_sequence;
+    QByteArray m_stamped;
+    QElapsedTimer m_clock;
 
     NetMIDIOutputPrivate() :
         m_socket(nullptr),
         m_publicName(DEFAULT_PUBLIC_NAME),
         m_groupAddress(QHostAddress(STR_ADDRESS_IPV4)),
         m_port(0),
-        m_ipv6(false)
+        m_ipv6(false),
+        m_coalesceTime(0),
+        m_runningStatus(0),
+        m_flushPending(false),
+        m_timestamps(false),
+        m_loopback(false),
+        m_sequence(0)
     {
         for(int i=MULTICAST_PORT; i<LAST_PORT; ++i) {
             m_outputDevices << MIDIConnection(QString::number(i), i);
         }
+        m_packet.reserve(MAX_DATAGRAM_SIZE);
+        m_stamped.reserve(NETMIDI_HEADER_SIZE + MAX_DATAGRAM_SIZE);
+        m_flushTimer.setSingleShot(true);
+        m_flushTimer.setTimerType(Qt::PreciseTimer);
+        QObject::connect(&m_flushTimer, &QTimer::timeout, [this]{
+            QMutexLocker locker(&m_mutex);
+            flush();
+        });
     }
 
     ~NetMIDIOutputPrivate()
@@ -67,6 +100,9 @@ public:
             QString ifaceName = settings->value("interface", QString()).toString();
             m_ipv6 = settings->value("ipv6", false).toBool();
             QString address = settings->value("address", m_ipv6 ? STR_ADDRESS_IPV6 : STR_ADDRESS_IPV4).toString();
+            m_coalesceTime = settings->value("coalesce_time", 0).toInt();
+            m_timestamps = settings->value("timestamps", false).toBool();
+            m_loopback = settings->value("loopback", false).toBool();
             settings->endGroup();
             if (!ifaceName.isEmpty()) {
                 m_iface = QNetworkInterface::interfaceFromName(ifaceName);
@@ -90,9 +126,11 @@ public:
             if (res) {
                 m_socket->setSocketOption(QAbstractSocket::MulticastTtlOption, 1);
 #ifdef Q_OS_UNIX
-                m_socket->setSocketOption(QAbstractSocket::MulticastLoopbackOption, 0);
+                m_socket->setSocketOption(QAbstractSocket::MulticastLoopbackOption, m_loopback ? 1 : 0);
 #endif
                 m_port = static_cast<quint16>(p);
+                m_sequence = 0;
+                m_clock.start();
                 if (m_iface.isValid()) {
                     m_socket->setMulticastInterface(m_iface);
                 }
@@ -106,6 +144,9 @@ public:
 
     void close()
     {
+        QMutexLocker locker(&m_mutex);
+        m_flushTimer.stop();
+        flush();
         delete m_socket;
         m_socket = nullptr;
         m_currentOutput = MIDIConnection();
@@ -113,29 +154,146 @@ public:
 
     void sendMessage(int m0)
     {
-        QByteArray m;
-        m.resize(1);
-        m[0] = static_cast<char>(m0);
-        sendMessage(m);
+        if (m_coalesceTime > 0) {
+            QMutexLocker locker(&m_mutex);
+            if (m0 < MIDI_STATUS_REALTIME) {
+                // system common messages cancel the running status
+                m_runningStatus = 0;
+                appendMessage(m0, 0, 0, 1);
+            } else {
+                // realtime messages are never delayed: they go out at once
+                // with the pending messages, keeping their order
+                m_packet.append(static_cast<char>(m0));
+                flush();
+            }
+        } else {
+            QByteArray m;
+            m.resize(1);
+            m[0] = static_cast<char>(m0);
+            sendMessage(m);
+        }
     }
 
     void sendMessage(int m0, int m1)
     {
-        QByteArray m;
-        m.resize(2);
-        m[0] = static_cast<char>(m0);
-        m[1] = static_cast<char>(m1);
-        sendMessage(m);
+        if (m_coalesceTime > 0) {
+            QMutexLocker locker(&m_mutex);
+            appendChannelMessage(m0, m1, 0, 2);
+        } else {
+            QByteArray m;
+            m.resize(2);
+            m[0] = static_cast<char>(m0);
+            m[1] = static_cast<char>(m1);
+            sendMessage(m);
+        }
     }
 
     void sendMessage(int m0, int m1, int m2)
     {
-        QByteArray m;
-        m.resize(3);
-        m[0] = static_cast<char>(m0);
-        m[1] = static_cast<char>(m1);
-        m[2] = static_cast<char>(m2);
-        sendMessage(m);
+        if (m_coalesceTime > 0) {
+            QMutexLocker locker(&m_mutex);
+            appendChannelMessage(m0, m1, m2, 3);
+        } else {
+            QByteArray m;
+            m.resize(3);
+            m[0] = static_cast<char>(m0);
+            m[1] = static_cast<char>(m1);
+            m[2] = static_cast<char>(m2);
+            sendMessage(m);
+        }
+    }
+
+    void sendSysex(const QByteArray& message)
+    {
+        if (m_coalesceTime > 0) {
+            QMutexLocker locker(&m_mutex);
+            if (m_packet.size() + message.size() > MAX_DATAGRAM_SIZE) {
+                flush();
+            }
+            if (message.size() > MAX_DATAGRAM_SIZE) {
+                sendMessage(message);
+            } else {
+                if (m_packet.isEmpty()) {
+                    m_packetTime.start();
+                }
+                m_runningStatus = 0;
+                m_packet.append(message);
+                scheduleFlush();
+            }
+        } else {
+            sendMessage(message);
+        }
+    }
+
+    /*
+     * Coalescing mode: consecutive messages are packed into a single datagram
+     * using running status, and sent either when the datagram is full or
+     * when the latency budget (m_coalesceTime milliseconds) expires.
+     * Each datagram starts with a status byte, so a lost packet never
+     * corrupts the running status of the next one.
+     *
+     * The messages may come from any thread (MIDI Thru is sent from the
+     * input thread), so the packet is guarded by m_mutex. The budget is
+     * checked after each complete message, and the flush timer, which only
+     * runs in its own thread, is started through a queued call to cover the
+     * last messages of a burst. Called with m_mutex locked.
+     */
+    void appendChannelMessage(int m0, int m1, int m2, int len)
+    {
+        if (m_packet.size() + len > MAX_DATAGRAM_SIZE) {
+            flush();
+        }
+        if (m0 == m_runningStatus) {
+            appendMessage(m1, m2, 0, len - 1);
+        } else {
+            m_runningStatus = static_cast<quint8>(m0);
+            appendMessage(m0, m1, m2, len);
+        }
+    }
+
+    /* appends a whole message, so a flush never splits it */
+    void appendMessage(int b0, int b1, int b2, int len)
+    {
+        if (m_packet.size() + len > MAX_DATAGRAM_SIZE) {
+            flush();
+        }
+        if (m_packet.isEmpty()) {
+            m_packetTime.start();
+        }
+        m_packet.append(static_cast<char>(b0));
+        if (len > 1) {
+            m_packet.append(static_cast<char>(b1));
+        }
+        if (len > 2) {
+            m_packet.append(static_cast<char>(b2));
+        }
+        scheduleFlush();
+    }
+
+    void scheduleFlush()
+    {
+        if (m_packetTime.elapsed() >= m_coalesceTime) {
+            flush();
+        } else if (!m_flushPending) {
+            m_flushPending = true;
+            if (QThread::currentThread() == m_flushTimer.thread()) {
+                m_flushTimer.start(m_coalesceTime);
+            } else {
+                QMetaObject::invokeMethod(&m_flushTimer, "start", Qt::QueuedConnection,
+                                          Q_ARG(int, m_coalesceTime));
+            }
+        }
+    }
+
+    void flush()
+    {
+        // a timer still running only flushes a later packet a bit earlier
+        m_flushPending = false;
+        if (!m_packet.isEmpty()) {
+            sendMessage(m_packet);
+            m_packet.resize(0);
+        }
+        m_runningStatus = 0;
     }
 
     void sendMessage(const QByteArray& message )
@@ -148,7 +306,16 @@ public:
             qWarning() << Q_FUNC_INFO << "udp socket has invalid state:" << m_socket->state() << "Error:" << m_socket->error() << m_socket->errorString();
             return;
         }
-        auto res = m_socket->writeDatagram(message, m_groupAddress, m_port);
+        qint64 res;
+        if (m_timestamps) {
+            m_stamped.resize(NETMIDI_HEADER_SIZE + message.size());
+            uchar *buffer = reinterpret_cast<uchar *>(m_stamped.data());
+            writeNetMIDIHeader(buffer, m_sequence++, static_cast<quint64>(m_clock.nsecsElapsed() / 1000));
+            memcpy(buffer + NETMIDI_HEADER_SIZE, message.constData(), static_cast<size_t>(message.size()));
+            res = m_socket->writeDatagram(m_stamped, m_groupAddress, m_port);
+        } else {
+            res = m_socket->writeDatagram(message, m_groupAddress, m_port);
+        }
         //qDebug() << Q_FUNC_INFO << "writeDatagram:" << res;
         if (res < 0) {
             qWarning() << Q_FUNC_INFO << "Error:" << m_socket->error() << m_socket->errorString();
@@ -250,7 +417,7 @@ void NetMIDIOutput::sendPitchBend(int chan, int v)
 
 void NetMIDIOutput::sendSysex(const QByteArray &data)
 {
-    d->sendMessage(data);
+    d->sendSysex(data);
 }
 
 void NetMIDIOutput::sendSystemMsg(const int status)
@@ -39,6 +39,7 @@ namespace drumstick { namespace rt {
         static const QString STR_ADDRESS_IPV6;
         static const int MULTICAST_PORT;
         static const int LAST_PORT;
+        static const int MAX_DATAGRAM_SIZE;
 
         // MIDIOutput interface
     public:
@@ -20,6 +20,7 @@
 #include <QDir>
 #include <QFile>
 #include <QObject>
+#include <unistd.h>
 
 #include "ossinput.h"
 #include "ossinput_p.h"
@@ -92,13 +93,16 @@ void OSSInputPrivate::setMIDIThruDevice(MIDIOutput* device)
     }
 }
 
+/*
+ * A single read() of the available bytes: QFile::read() on the blocking
+ * device would wait until the whole buffer is filled.
+ */
 void OSSInputPrivate::processIncomingMessages(int)
 {
-    char ch;
-    m_device->getChar(&ch);
-    if (m_parser != nullptr) {
-        uchar uch = static_cast<unsigned>(ch);
-        m_parser->parse(uch);
+    char buffer[256];
+    ssize_t len = ::read(m_device->handle(), buffer, sizeof(buffer));
+    if (len > 0 && m_parser != nullptr) {
+        m_parser->parse(reinterpret_cast<const uchar *>(buffer), static_cast<size_t>(len));
     }
 }
 
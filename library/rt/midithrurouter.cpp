@@ -0,0 +1,625 @@
+/*
+    Drumstick MIDI realtime input-output
+    Copyright (C) 2009-2021 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+#include <limits>
+#include <drumstick/midithrurouter.h>
+
+/**
+ * @file midithrurouter.cpp
+ * Implementation of a class routing MIDI Thru messages between backends
+ */
+
+namespace drumstick { namespace rt {
+
+    /*
+     * Routing settings. A published RouterConfig is never modified: the setters
+     * copy it, change the copy and swap the pointer, so the input threads
+     * read it without locking.
+     */
+    struct RouterConfig {
+        QVector<MIDIOutput*> m_outputs;
+        quint16 m_channelMask;
+        int m_lowNote;
+        int m_highNote;
+        int m_transpose;
+        bool m_systemEnabled;
+        int m_channelMap[MIDI_STD_CHANNELS];
+    };
+
+    /* routing calls in progress on the current thread, of any router */
+    static thread_local int routingDepth = 0;
+
+    class MIDIThruRouter::MIDIThruRouterPrivate {
+    public:
+        MIDIThruRouterPrivate():
+            m_publicName(QStringLiteral("MIDI Thru"))
+        {
+            RouterConfig *config = new RouterConfig;
+            config->m_channelMask = 0xffff;
+            config->m_lowNote = 0;
+            config->m_highNote = 127;
+            config->m_transpose = 0;
+            config->m_systemEnabled = true;
+            for (int i = 0; i < MIDI_STD_CHANNELS; ++i) {
+                config->m_channelMap[i] = i;
+            }
+            m_config.store(config);
+            resetStatistics();
+            m_clock.start();
+        }
+
+        ~MIDIThruRouterPrivate()
+        {
+            qDeleteAll(m_retiredOld);
+            qDeleteAll(m_retired);
+            delete m_config.load();
+        }
+
+        /* writer side, called with m_mutex locked */
+        RouterConfig *edit() const
+        {
+            return new RouterConfig(*m_config.load());
+        }
+
+        /*
+         * Publishes a new configuration without waiting for the senders.
+         * The previous one is retired, and freed by a later reclaim().
+         */
+        void publish(RouterConfig *config)
+        {
+            m_retired.append(m_config.fetchAndStoreOrdered(config));
+            reclaim();
+        }
+
+        /*
+         * The senders are counted in two slots, selected by the parity of
+         * the epoch they entered. When the slot of the previous epoch is
+         * empty, no sender can hold a configuration retired before the
+         * last epoch change: those are freed, and the epoch advances. The
+         * senders entering meanwhile use the other slot, so the writers
+         * never wait for them. Called with m_mutex locked.
+         */
+        void reclaim()
+        {
+            const int epoch = m_epoch.loadAcquire();
+            if (m_readers[(epoch + 1) & 1].loadAcquire() == 0) {
+                qDeleteAll(m_retiredOld);
+                m_retiredOld = m_retired;
+                m_retired.clear();
+                m_epoch.fetchAndStoreOrdered(epoch + 1);
+            }
+        }
+
+        /*
+         * Waits until every retired configuration is freed, which takes two
+         * epoch changes. Each one only waits for the senders already in
+         * the previous epoch. A sender can't wait for itself, so this
+         * returns at once when called from a routing call.
+         */
+        void synchronize()
+        {
+            if (routingDepth > 0) {
+                return;
+            }
+            while (!m_retired.isEmpty() || !m_retiredOld.isEmpty()) {
+                reclaim();
+                if (!m_retired.isEmpty() || !m_retiredOld.isEmpty()) {
+                    QThread::yieldCurrentThread();
+                }
+            }
+        }
+
+        void resetStatistics()
+        {
+            m_forwarded.store(0);
+            m_filtered.store(0);
+            m_minLatency.store(std::numeric_limits<qint64>::max());
+            m_maxLatency.store(0);
+            m_totalLatency.store(0);
+        }
+
+        bool acceptChannel(const RouterConfig *config, int &chan)
+        {
+            if (chan < 0 || chan >= MIDI_STD_CHANNELS || (config->m_channelMask & (1 << chan)) == 0) {
+                m_filtered.fetchAndAddRelaxed(1);
+                return false;
+            }
+            chan = config->m_channelMap[chan];
+            return true;
+        }
+
+        bool acceptNote(const RouterConfig *config, int &chan, int &note)
+        {
+            if (!acceptChannel(config, chan)) {
+                return false;
+            }
+            if (note < config->m_lowNote || note > config->m_highNote) {
+                m_filtered.fetchAndAddRelaxed(1);
+                return false;
+            }
+            note += config->m_transpose;
+            if (note < 0 || note > 127) {
+                m_filtered.fetchAndAddRelaxed(1);
+                return false;
+            }
+            return true;
+        }
+
+        qint64 begin() const
+        {
+            return m_clock.nsecsElapsed();
+        }
+
+        void end(qint64 start)
+        {
+            qint64 elapsed = m_clock.nsecsElapsed() - start;
+            qint64 current = m_minLatency.load();
+            while (elapsed < current && !m_minLatency.testAndSetRelaxed(current, elapsed)) {
+                current = m_minLatency.load();
+            }
+            current = m_maxLatency.load();
+            while (elapsed > current && !m_maxLatency.testAndSetRelaxed(current, elapsed)) {
+                current = m_maxLatency.load();
+            }
+            m_totalLatency.fetchAndAddRelaxed(elapsed);
+            m_forwarded.fetchAndAddRelaxed(1);
+        }
+
+        /* serializes the writers; never taken by the senders */
+        mutable QMutex m_mutex;
+        QString m_publicName;
+        QAtomicPointer<RouterConfig> m_config;
+        QAtomicInt m_epoch;
+        QAtomicInt m_readers[2];
+        QVector<RouterConfig*> m_retired;
+        QVector<RouterConfig*> m_retiredOld;
+        QElapsedTimer m_clock;
+        QAtomicInteger<quint64> m_forwarded;
+        QAtomicInteger<quint64> m_filtered;
+        QAtomicInteger<qint64> m_minLatency;
+        QAtomicInteger<qint64> m_maxLatency;
+        QAtomicInteger<qint64> m_totalLatency;
+    };
+
+    /*
+     * Holds the current configuration while a message is routed. The
+     * sender enters the current epoch, retrying if it changed meanwhile,
+     * and only then loads the configuration.
+     */
+    class ConfigReader {
+    public:
+        ConfigReader(QAtomicPointer<RouterConfig> &config, QAtomicInt &epoch, QAtomicInt *readers)
+        {
+            int current;
+            do {
+                current = epoch.loadAcquire();
+                m_readers = &readers[current & 1];
+                m_readers->ref();
+                if (epoch.loadAcquire() == current) {
+                    break;
+                }
+                m_readers->deref();
+            } while (true);
+            m_config = config.loadAcquire();
+            ++routingDepth;
+        }
+        ~ConfigReader()
+        {
+            --routingDepth;
+            m_readers->deref();
+        }
+        const RouterConfig *operator->() const
+        {
+            return m_config;
+        }
+        const RouterConfig *data() const
+        {
+            return m_config;
+        }
+    private:
+        QAtomicInt *m_readers;
+        const RouterConfig *m_config;
+    };
+
+    /**
+     * @brief Constructor
+     * @param parent
+     */
+    MIDIThruRouter::MIDIThruRouter(QObject *parent) : MIDIOutput(parent),
+        d(new MIDIThruRouterPrivate)
+    { }
+
+    /**
+     * @brief Destructor
+     */
+    MIDIThruRouter::~MIDIThruRouter()
+    { }
+
+    /**
+     * @brief Installs the router as the MIDI Thru device of the input, and enables MIDI Thru
+     * @param input MIDI input
+     */
+    void MIDIThruRouter::attachInput(MIDIInput *input)
+    {
+        if (input != nullptr) {
+            input->setMIDIThruDevice(this);
+            input->enableMIDIThru(true);
+        }
+    }
+
+    /**
+     * @brief Disables MIDI Thru on the input
+     * @param input MIDI input
+     */
+    void MIDIThruRouter::detachInput(MIDIInput *input)
+    {
+        if (input != nullptr) {
+            input->enableMIDIThru(false);
+            input->setMIDIThruDevice(nullptr);
+        }
+    }
+
+    /**
+     * @brief Appends a destination for the routed messages
+     * @param output MIDI output
+     */
+    void MIDIThruRouter::addOutput(MIDIOutput *output)
+    {
+        QMutexLocker locker(&d->m_mutex);
+        if (output != nullptr && output != this && !d->m_config.load()->m_outputs.contains(output)) {
+            RouterConfig *config = d->edit();
+            config->m_outputs.append(output);
+            d->publish(config);
+        }
+    }
+
+    /**
+     * @brief Removes a destination. When this function returns, the output
+     * is not used by the router anymore, and it may be deleted. Called while
+     * routing a message, like from a slot directly connected to an output,
+     * it returns at once instead, and the output may still be used until
+     * that message has been routed.
+     * @param output MIDI output
+     */
+    void MIDIThruRouter::removeOutput(MIDIOutput *output)
+    {
+        QMutexLocker locker(&d->m_mutex);
+        RouterConfig *config = d->edit();
+        config->m_outputs.removeAll(output);
+        d->publish(config);
+        d->synchronize();
+    }
+
+    /**
+     * @brief Returns the list of destinations
+     * @return list of MIDI outputs
+     */
+    QList<MIDIOutput *> MIDIThruRouter::outputs() const
+    {
+        QMutexLocker locker(&d->m_mutex);
+        return d->m_config.load()->m_outputs.toList();
+    }
+
+    /**
+     * @brief Sets the accepted channels
+     * @param mask bit mask of the accepted channels
+     */
+    void MIDIThruRouter::setChannelFilter(quint16 mask)
+    {
+        QMutexLocker locker(&d->m_mutex);
+        RouterConfig *config = d->edit();
+        config->m_channelMask = mask;
+        d->publish(config);
+    }
+
+    /**
+     * @brief Returns the accepted channels
+     * @return bit mask of the accepted channels
+     */
+    quint16 MIDIThruRouter::channelFilter() const
+    {
+        QMutexLocker locker(&d->m_mutex);
+        return d->m_config.load()->m_channelMask;
+    }
+
+    /**
+     * @brief Sets the range of accepted notes, before transposition
+     * @param low lowest note number
+     * @param high highest note number
+     */
+    void MIDIThruRouter::setNoteRange(int low, int high)
+    {
+        QMutexLocker locker(&d->m_mutex);
+        RouterConfig *config = d->edit();
+        config->m_lowNote = qBound(0, low, 127);
+        config->m_highNote = qBound(0, high, 127);
+        d->publish(config);
+    }
+
+    /**
+     * @brief Sets the transposition of notes. Notes out of range after
+     * transposition are discarded.
+     * @param semitones interval
+     */
+    void MIDIThruRouter::setTranspose(int semitones)
+    {
+        QMutexLocker locker(&d->m_mutex);
+        RouterConfig *config = d->edit();
+        config->m_transpose = semitones;
+        d->publish(config);
+    }
+
+    /**
+     * @brief Returns the transposition of notes
+     * @return interval in semitones
+     */
+    int MIDIThruRouter::transpose() const
+    {
+        QMutexLocker locker(&d->m_mutex);
+        return d->m_config.load()->m_transpose;
+    }
+
+    /**
+     * @brief Redirects the channel messages of inputChannel to outputChannel
+     * @param inputChannel source channel
+     * @param outputChannel destination channel
+     */
+    void MIDIThruRouter::setChannelMap(int inputChannel, int outputChannel)
+    {
+        QMutexLocker locker(&d->m_mutex);
+        if (inputChannel >= 0 && inputChannel < MIDI_STD_CHANNELS &&
+            outputChannel >= 0 && outputChannel < MIDI_STD_CHANNELS) {
+            RouterConfig *config = d->edit();
+            config->m_channelMap[inputChannel] = outputChannel;
+            d->publish(config);
+        }
+    }
+
+    /**
+     * @brief Enables or disables the forwarding of system messages and sysex
+     * @param enabled
+     */
+    void MIDIThruRouter::setSystemMessagesEnabled(bool enabled)
+    {
+        QMutexLocker locker(&d->m_mutex);
+        RouterConfig *config = d->edit();
+        config->m_systemEnabled = enabled;
+        d->publish(config);
+    }
+
+    /**
+     * @brief Returns the number of forwarded messages
+     * @return number of messages
+     */
+    quint64 MIDIThruRouter::forwardedMessages() const
+    {
+        return d->m_forwarded.load();
+    }
+
+    /**
+     * @brief Returns the number of discarded messages
+     * @return number of messages
+     */
+    quint64 MIDIThruRouter::filteredMessages() const
+    {
+        return d->m_filtered.load();
+    }
+
+    /**
+     * @brief Returns the minimum time spent in the destination outputs
+     * forwarding a message
+     * @return nanoseconds
+     */
+    qint64 MIDIThruRouter::minLatency() const
+    {
+        return d->m_forwarded.load() > 0 ? d->m_minLatency.load() : 0;
+    }
+
+    /**
+     * @brief Returns the maximum time spent in the destination outputs
+     * forwarding a message
+     * @return nanoseconds
+     */
+    qint64 MIDIThruRouter::maxLatency() const
+    {
+        return d->m_maxLatency.load();
+    }
+
+    /**
+     * @brief Returns the average time spent in the destination outputs
+     * forwarding a message
+     * @return nanoseconds
+     */
+    qint64 MIDIThruRouter::averageLatency() const
+    {
+        quint64 forwarded = d->m_forwarded.load();
+        return forwarded > 0 ? d->m_totalLatency.load() / static_cast<qint64>(forwarded) : 0;
+    }
+
+    /**
+     * @brief Clears the message counters and latencies
+     */
+    void MIDIThruRouter::resetStatistics()
+    {
+        d->resetStatistics();
+    }
+
+    void MIDIThruRouter::initialize(QSettings *settings)
+    {
+        Q_UNUSED(settings)
+    }
+
+    QString MIDIThruRouter::backendName()
+    {
+        return QStringLiteral("Thru Router");
+    }
+
+    QString MIDIThruRouter::publicName()
+    {
+        return d->m_publicName;
+    }
+
+    void MIDIThruRouter::setPublicName(QString name)
+    {
+        d->m_publicName = name;
+    }
+
+    QList<MIDIConnection> MIDIThruRouter::connections(bool advanced)
+    {
+        Q_UNUSED(advanced)
+        return QList<MIDIConnection>();
+    }
+
+    void MIDIThruRouter::setExcludedConnections(QStringList conns)
+    {
+        Q_UNUSED(conns)
+    }
+
+    void MIDIThruRouter::open(const MIDIConnection &conn)
+    {
+        Q_UNUSED(conn)
+    }
+
+    void MIDIThruRouter::close()
+    { }
+
+    MIDIConnection MIDIThruRouter::currentConnection()
+    {
+        return MIDIConnection();
+    }
+
+    void MIDIThruRouter::sendNoteOff(int chan, int note, int vel)
+    {
+        ConfigReader config(d->m_config, d->m_epoch, d->m_readers);
+        if (d->acceptNote(config.data(), chan, note)) {
+            qint64 start = d->begin();
+            for (MIDIOutput *out : config->m_outputs) {
+                out->sendNoteOff(chan, note, vel);
+            }
+            d->end(start);
+        }
+    }
+
+    void MIDIThruRouter::sendNoteOn(int chan, int note, int vel)
+    {
+        ConfigReader config(d->m_config, d->m_epoch, d->m_readers);
+        if (d->acceptNote(config.data(), chan, note)) {
+            qint64 start = d->begin();
+            for (MIDIOutput *out : config->m_outputs) {
+                out->sendNoteOn(chan, note, vel);
+            }
+            d->end(start);
+        }
+    }
+
+    void MIDIThruRouter::sendKeyPressure(int chan, int note, int value)
+    {
+        ConfigReader config(d->m_config, d->m_epoch, d->m_readers);
+        if (d->acceptNote(config.data(), chan, note)) {
+            qint64 start = d->begin();
+            for (MIDIOutput *out : config->m_outputs) {
+                out->sendKeyPressure(chan, note, value);
+            }
+            d->end(start);
+        }
+    }
+
+    void MIDIThruRouter::sendController(int chan, int control, int value)
+    {
+        ConfigReader config(d->m_config, d->m_epoch, d->m_readers);
+        if (d->acceptChannel(config.data(), chan)) {
+            qint64 start = d->begin();
+            for (MIDIOutput *out : config->m_outputs) {
+                out->sendController(chan, control, value);
+            }
+            d->end(start);
+        }
+    }
+
+    void MIDIThruRouter::sendProgram(int chan, int program)
+    {
+        ConfigReader config(d->m_config, d->m_epoch, d->m_readers);
+        if (d->acceptChannel(config.data(), chan)) {
+            qint64 start = d->begin();
+            for (MIDIOutput *out : config->m_outputs) {
+                out->sendProgram(chan, program);
+            }
+            d->end(start);
+        }
+    }
+
+    void MIDIThruRouter::sendChannelPressure(int chan, int value)
+    {
+        ConfigReader config(d->m_config, d->m_epoch, d->m_readers);
+        if (d->acceptChannel(config.data(), chan)) {
+            qint64 start = d->begin();
+            for (MIDIOutput *out : config->m_outputs) {
+                out->sendChannelPressure(chan, value);
+            }
+            d->end(start);
+        }
+    }
+
+    void MIDIThruRouter::sendPitchBend(int chan, int value)
+    {
+        ConfigReader config(d->m_config, d->m_epoch, d->m_readers);
+        if (d->acceptChannel(config.data(), chan)) {
+            qint64 start = d->begin();
+            for (MIDIOutput *out : config->m_outputs) {
+                out->sendPitchBend(chan, value);
+            }
+            d->end(start);
+        }
+    }
+
+    void MIDIThruRouter::sendSysex(const QByteArray &data)
+    {
+        ConfigReader config(d->m_config, d->m_epoch, d->m_readers);
+        if (config->m_systemEnabled) {
+            qint64 start = d->begin();
+            for (MIDIOutput *out : config->m_outputs) {
+                out->sendSysex(data);
+            }
+            d->end(start);
+        } else {
+            d->m_filtered.fetchAndAddRelaxed(1);
+        }
+    }
+
+    void MIDIThruRouter::sendSystemMsg(const int status)
+    {
+        ConfigReader config(d->m_config, d->m_epoch, d->m_readers);
+        if (config->m_systemEnabled) {
+            qint64 start = d->begin();
+            for (MIDIOutput *out : config->m_outputs) {
+                out->sendSystemMsg(status);
+            }
+            d->end(start);
+        } else {
+            d->m_filtered.fetchAndAddRelaxed(1);
+        }
+    }
+
+}} // namespace drumstick::rt
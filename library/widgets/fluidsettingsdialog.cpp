@@ -47,6 +47,9 @@ const QString FluidSettingsDialog::QSTR_CHORUS = QStringLiteral("Chorus");
 const QString FluidSettingsDialog::QSTR_REVERB = QStringLiteral("Reverb");
 const QString FluidSettingsDialog::QSTR_GAIN = QStringLiteral("Gain");
 const QString FluidSettingsDialog::QSTR_POLYPHONY = QStringLiteral("Polyphony");
+const QString FluidSettingsDialog::QSTR_CPUCORES = QStringLiteral("CPUCores");
+const QString FluidSettingsDialog::QSTR_SOUNDFONTCACHE = QStringLiteral("SoundFontCache");
+const QString FluidSettingsDialog::QSTR_BACKGROUNDSCAN = QStringLiteral("BackgroundScan");
 const double FluidSettingsDialog::DEFAULT_SAMPLERATE = 48000.0;
 const double FluidSettingsDialog::DEFAULT_GAIN = .5;
 
@@ -63,6 +66,8 @@ FluidSettingsDialog::FluidSettingsDialog(QWidget *parent) :
     ui->sampleRate->setValidator(new QDoubleValidator(22050.0, 96000.0, 1, this));
     ui->gain->setValidator(new QDoubleValidator(0.0, 10.0, 2, this));
     ui->polyphony->setValidator(new QIntValidator(16, 4096, this));
+    ui->cpuCores->setValidator(new QIntValidator(1, 256, this));
+    ui->soundFontCache->setValidator(new QIntValidator(0, 64, this));
 }
 
 FluidSettingsDialog::~FluidSettingsDialog()
@@ -132,6 +137,9 @@ void FluidSettingsDialog::readSettings()
     ui->reverb->setChecked( settings->value(QSTR_REVERB, DEFAULT_REVERB).toInt() != 0 );
     ui->gain->setText( settings->value(QSTR_GAIN, DEFAULT_GAIN).toString() );
     ui->polyphony->setText( settings->value(QSTR_POLYPHONY, DEFAULT_POLYPHONY).toString() );
+    ui->cpuCores->setText( settings->value(QSTR_CPUCORES, DEFAULT_CPUCORES).toString() );
+    ui->soundFontCache->setText( settings->value(QSTR_SOUNDFONTCACHE, DEFAULT_SOUNDFONTCACHE).toString() );
+    ui->backgroundScan->setChecked( settings->value(QSTR_BACKGROUNDSCAN, DEFAULT_BACKGROUNDSCAN).toBool() );
     ui->soundFont->setText( settings->value(QSTR_INSTRUMENTSDEFINITION, fs_defSoundFont).toString() );
     settings->endGroup();
 }
@@ -148,6 +156,9 @@ void FluidSettingsDialog::writeSettings()
     int     reverb(DEFAULT_REVERB);
     double  gain(DEFAULT_GAIN);
     int     polyphony(DEFAULT_POLYPHONY);
+    int     cpuCores(DEFAULT_CPUCORES);
+    int     soundFontCache(DEFAULT_SOUNDFONTCACHE);
+    bool    backgroundScan(DEFAULT_BACKGROUNDSCAN);
 
     audioDriver = ui->audioDriver->currentText();
     if (audioDriver.isEmpty()) {
@@ -161,6 +172,9 @@ void FluidSettingsDialog::writeSettings()
     reverb = (ui->reverb->isChecked() ? 1 : 0);
     gain = ui->gain->text().toDouble();
     polyphony = ui->polyphony->text().toInt();
+    cpuCores = qMax(1, ui->cpuCores->text().toInt());
+    soundFontCache = ui->soundFontCache->text().toInt();
+    backgroundScan = ui->backgroundScan->isChecked();
 
     settings->beginGroup(QSTR_PREFERENCES);
     settings->setValue(QSTR_INSTRUMENTSDEFINITION, soundFont);
@@ -172,6 +186,9 @@ void FluidSettingsDialog::writeSettings()
     settings->setValue(QSTR_REVERB, reverb);
     settings->setValue(QSTR_GAIN, gain);
     settings->setValue(QSTR_POLYPHONY, polyphony);
+    settings->setValue(QSTR_CPUCORES, cpuCores);
+    settings->setValue(QSTR_SOUNDFONTCACHE, soundFontCache);
+    settings->setValue(QSTR_BACKGROUNDSCAN, backgroundScan);
     settings->endGroup();
     settings->sync();
 }
@@ -186,6 +203,9 @@ void FluidSettingsDialog::restoreDefaults()
     ui->reverb->setChecked( DEFAULT_REVERB != 0 );
     ui->gain->setText( QString::number( DEFAULT_GAIN ) );
     ui->polyphony->setText( QString::number( DEFAULT_POLYPHONY ));
+    ui->cpuCores->setText( QString::number( DEFAULT_CPUCORES ));
+    ui->soundFontCache->setText( QString::number( DEFAULT_SOUNDFONTCACHE ));
+    ui->backgroundScan->setChecked( DEFAULT_BACKGROUNDSCAN );
     ui->soundFont->setText( QSTR_SOUNDFONT );
 }
 
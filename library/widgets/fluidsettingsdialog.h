@@ -65,6 +65,9 @@ public:
     static const QString QSTR_REVERB;
     static const QString QSTR_GAIN;
     static const QString QSTR_POLYPHONY;
+    static const QString QSTR_CPUCORES;
+    static const QString QSTR_SOUNDFONTCACHE;
+    static const QString QSTR_BACKGROUNDSCAN;
 
     static const int DEFAULT_PERIODSIZE = 3072;
     static const int DEFAULT_PERIODS = 1;
@@ -73,6 +76,9 @@ public:
     static const int DEFAULT_REVERB = 0;
     static const double DEFAULT_GAIN;
     static const int DEFAULT_POLYPHONY = 32;
+    static const int DEFAULT_CPUCORES = 1;
+    static const int DEFAULT_SOUNDFONTCACHE = 2;
+    static const bool DEFAULT_BACKGROUNDSCAN = true;
 
 private:
     QString defaultAudioDriver() const;
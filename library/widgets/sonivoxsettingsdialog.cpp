@@ -32,6 +32,7 @@ namespace drumstick { namespace widgets {
 
 const QString SonivoxSettingsDialog::QSTR_PREFERENCES = QStringLiteral("SonivoxEAS");
 const QString SonivoxSettingsDialog::QSTR_BUFFERTIME = QStringLiteral("BufferTime");
+const QString SonivoxSettingsDialog::QSTR_LOWLATENCY = QStringLiteral("LowLatency");
 const QString SonivoxSettingsDialog::QSTR_REVERBTYPE = QStringLiteral("ReverbType");
 const QString SonivoxSettingsDialog::QSTR_REVERBAMT = QStringLiteral("ReverbAmt");
 const QString SonivoxSettingsDialog::QSTR_CHORUSTYPE = QStringLiteral("ChorusType");
@@ -82,6 +83,7 @@ void SonivoxSettingsDialog::readSettings()
     SettingsFactory settings;
     settings->beginGroup(QSTR_PREFERENCES);
     int bufferTime = settings->value(QSTR_BUFFERTIME, 60).toInt();
+    bool lowLatency = settings->value(QSTR_LOWLATENCY, false).toBool();
     int reverbType = settings->value(QSTR_REVERBTYPE, 1).toInt();
     int reverbAmt = settings->value(QSTR_REVERBAMT, 25800).toInt();
     int chorusType = settings->value(QSTR_CHORUSTYPE, -1).toInt();
@@ -89,6 +91,7 @@ void SonivoxSettingsDialog::readSettings()
     settings->endGroup();
 
     ui->spnTime->setValue(bufferTime);
+    ui->chkLowLatency->setChecked(lowLatency);
     ui->dial_Reverb->setValue(reverbAmt);
     ui->dial_Chorus->setValue(chorusAmt);
     int reverbIndex = ui->combo_Reverb->findData(reverbType);
@@ -102,6 +105,7 @@ void SonivoxSettingsDialog::writeSettings()
     SettingsFactory settings;
     settings->beginGroup(QSTR_PREFERENCES);
     settings->setValue(QSTR_BUFFERTIME, ui->spnTime->value());
+    settings->setValue(QSTR_LOWLATENCY, ui->chkLowLatency->isChecked());
     settings->setValue(QSTR_REVERBTYPE, ui->combo_Reverb->currentData());
     settings->setValue(QSTR_CHORUSTYPE, ui->combo_Chorus->currentData());
     settings->setValue(QSTR_REVERBAMT, ui->dial_Reverb->value());
@@ -113,6 +117,7 @@ void SonivoxSettingsDialog::writeSettings()
 void SonivoxSettingsDialog::restoreDefaults()
 {
     ui->spnTime->setValue(60);
+    ui->chkLowLatency->setChecked(false);
     ui->combo_Reverb->setCurrentIndex(1);
     ui->dial_Reverb->setValue(25800);
     ui->combo_Chorus->setCurrentIndex(4);
@@ -46,6 +46,7 @@ namespace widgets {
 
         static const QString QSTR_PREFERENCES;
         static const QString QSTR_BUFFERTIME;
+        static const QString QSTR_LOWLATENCY;
         static const QString QSTR_REVERBTYPE;
         static const QString QSTR_REVERBAMT;
         static const QString QSTR_CHORUSTYPE;
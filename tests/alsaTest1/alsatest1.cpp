@@ -18,20 +18,28 @@
 */
 
 #include <QString>
+#include <QVector>
 #include <QtTest>
 #include <drumstick/alsaevent.h>
 
 using namespace drumstick::ALSA;
 
+static const int CODEC_BUFSIZE = 256;
+static const int STREAM_SIZE = 4 * 1024 * 1024;
+
 class AlsaTest1 : public QObject
 {
     Q_OBJECT
 
 public:
     AlsaTest1();
+    QByteArray createStream(int size);
 
 private Q_SLOTS:
     void testEvents();
+    void testCodec();
+    void benchmarkEncode();
+    void benchmarkDecode();
 };
 
 AlsaTest1::AlsaTest1() = default;
@@ -87,6 +95,159 @@ void AlsaTest1::testEvents()
     QCOMPARE(textEvent.getLength(), (unsigned) text.length());
 }
 
+/*
+ * Channel messages with full status bytes, and some system
+ * exclusive and realtime messages, so it can be decoded back verbatim
+ * when the running status is disabled.
+ */
+QByteArray AlsaTest1::createStream(int size)
+{
+    const QByteArray sysex = QByteArray::fromHex("f07e7f0901f7");
+    QByteArray stream;
+    stream.reserve(size + 64);
+    int n = 0;
+    while (stream.size() < size) {
+        int chan = n % 16;
+        int note = 36 + (n % 48);
+        stream.append(char(0x90 + chan));
+        stream.append(char(note));
+        stream.append(char(100));
+        stream.append(char(0xb0 + chan));
+        stream.append(char(7));
+        stream.append(char(n % 128));
+        stream.append(char(0xe0 + chan));
+        stream.append(char(n % 128));
+        stream.append(char(0x40));
+        stream.append(char(0x80 + chan));
+        stream.append(char(note));
+        stream.append(char(64));
+        if (n % 64 == 0) {
+            stream.append(char(0xf8));
+            stream.append(sysex);
+        }
+        ++n;
+    }
+    return stream;
+}
+
+void AlsaTest1::testCodec()
+{
+    MidiCodec codec(CODEC_BUFSIZE);
+    codec.enableRunningStatus(false);
+    QByteArray stream = createStream(64 * 1024);
+    const unsigned char *data = reinterpret_cast<const unsigned char*>(stream.constData());
+    QVector<snd_seq_event_t> events(stream.size() / 3 + 1);
+
+    // split the stream in the middle of a message
+    QByteArray sysex1, sysex2;
+    long consumed = 0;
+    long half = stream.size() / 2 + 1;
+    long n = codec.encodeEvents(data, half, events.data(), events.size(), &consumed, &sysex1);
+    QCOMPARE(consumed, half);
+    long m = codec.encodeEvents(data + half, stream.size() - half, events.data() + n, events.size() - n, &consumed, &sysex2);
+    QCOMPARE(consumed, stream.size() - half);
+    QVERIFY(n > 0 && m > 0);
+
+    QByteArray output(stream.size(), 0);
+    long decoded = 0;
+    long bytes = codec.decodeEvents(reinterpret_cast<unsigned char*>(output.data()), output.size(), events.constData(), n + m, &decoded);
+    QCOMPARE(decoded, n + m);
+    QCOMPARE(bytes, long(stream.size()));
+    QCOMPARE(output, stream);
+
+    // a short output buffer stops at an event boundary
+    bytes = codec.decodeEvents(reinterpret_cast<unsigned char*>(output.data()), 10, events.constData(), n + m, &decoded);
+    QCOMPARE(bytes, 9L);
+    QCOMPARE(decoded, 3L);
+
+    // running status in both directions
+    QByteArray running = QByteArray::fromHex("903c403e404040");
+    codec.resetEncoder();
+    n = codec.encodeEvents(reinterpret_cast<const unsigned char*>(running.constData()), running.size(), events.data(), events.size());
+    QCOMPARE(n, 3L);
+    for (int i = 0; i < n; ++i) {
+        QCOMPARE(int(events[i].type), int(SND_SEQ_EVENT_NOTEON));
+        QCOMPARE(int(events[i].data.note.note), 60 + i * 2);
+    }
+    codec.enableRunningStatus(true);
+    codec.resetDecoder();
+    bytes = codec.decodeEvents(reinterpret_cast<unsigned char*>(output.data()), output.size(), events.constData(), n);
+    QCOMPARE(output.left(bytes), running);
+
+    // a short buffer never leaves the running status changed, even before
+    // the parameter and 14 bit controller events spanning several messages
+    QVector<snd_seq_event_t> params(5);
+    for (snd_seq_event_t &ev : params) {
+        snd_seq_ev_clear(&ev);
+    }
+    snd_seq_ev_set_noteon(&params[0], 0, 60, 64);
+    snd_seq_ev_set_controller(&params[1], 0, 0x1234, 0x2345);
+    params[1].type = SND_SEQ_EVENT_NONREGPARAM;
+    snd_seq_ev_set_controller(&params[2], 0, 0x0101, 0x1fff);
+    params[2].type = SND_SEQ_EVENT_REGPARAM;
+    snd_seq_ev_set_controller(&params[3], 0, 7, 0x2000);
+    params[3].type = SND_SEQ_EVENT_CONTROL14;
+    snd_seq_ev_set_noteon(&params[4], 0, 62, 64);
+    codec.resetDecoder();
+    bytes = codec.decodeEvents(reinterpret_cast<unsigned char*>(output.data()), output.size(), params.constData(), params.size(), &decoded);
+    QCOMPARE(decoded, 5L);
+    QByteArray whole = output.left(bytes);
+    codec.resetDecoder();
+    bytes = codec.decodeEvents(reinterpret_cast<unsigned char*>(output.data()), 8, params.constData(), params.size(), &decoded);
+    QCOMPARE(bytes, 3L);
+    QCOMPARE(decoded, 1L);
+    long rest = codec.decodeEvents(reinterpret_cast<unsigned char*>(output.data()) + bytes, output.size() - bytes, params.constData() + decoded, params.size() - decoded);
+    QCOMPARE(output.left(bytes + rest), whole);
+
+    // without storage, the encoding stops after a system exclusive event
+    QByteArray mixed = QByteArray::fromHex("f07e7f0901f7903c40");
+    codec.resetEncoder();
+    n = codec.encodeEvents(reinterpret_cast<const unsigned char*>(mixed.constData()), mixed.size(), events.data(), events.size(), &consumed);
+    QCOMPARE(n, 1L);
+    QCOMPARE(consumed, 6L);
+    QCOMPARE(int(events[0].type), int(SND_SEQ_EVENT_SYSEX));
+    QCOMPARE(QByteArray(static_cast<const char*>(events[0].data.ext.ptr), events[0].data.ext.len), mixed.left(6));
+}
+
+void AlsaTest1::benchmarkEncode()
+{
+    MidiCodec codec(CODEC_BUFSIZE);
+    QByteArray stream = createStream(STREAM_SIZE);
+    const unsigned char *data = reinterpret_cast<const unsigned char*>(stream.constData());
+    QVector<snd_seq_event_t> events(4096);
+    QByteArray sysex;
+    long total = 0;
+    QBENCHMARK {
+        codec.resetEncoder();
+        total = 0;
+        long pos = 0;
+        while (pos < stream.size()) {
+            long consumed = 0;
+            sysex.resize(0);
+            total += codec.encodeEvents(data + pos, stream.size() - pos, events.data(), events.size(), &consumed, &sysex);
+            pos += consumed;
+        }
+    }
+    QVERIFY(total > STREAM_SIZE / 16);
+}
+
+void AlsaTest1::benchmarkDecode()
+{
+    MidiCodec codec(CODEC_BUFSIZE);
+    codec.enableRunningStatus(false);
+    QByteArray stream = createStream(STREAM_SIZE);
+    QVector<snd_seq_event_t> events(stream.size() / 3 + 1);
+    QByteArray sysex;
+    long n = codec.encodeEvents(reinterpret_cast<const unsigned char*>(stream.constData()), stream.size(), events.data(), events.size(), nullptr, &sysex);
+    QByteArray output(stream.size(), 0);
+    long bytes = 0;
+    QBENCHMARK {
+        codec.resetDecoder();
+        bytes = codec.decodeEvents(reinterpret_cast<unsigned char*>(output.data()), output.size(), events.constData(), n);
+    }
+    QCOMPARE(bytes, long(stream.size()));
+}
+
 QTEST_APPLESS_MAIN(AlsaTest1)
 
 #include "alsatest1.moc"
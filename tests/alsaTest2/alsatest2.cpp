@@ -100,6 +100,11 @@ void AlsaTest2::testTimer()
             m_test_timer->stopEvents();
             m_test_timer->stop();
             QVERIFY2(qAbs(50 - m_count) <= 1, "Timer results are wrong");
+            TimerStatistics tstats = m_test_timer->getStatistics();
+            QVERIFY(tstats.periods > 0);
+            QVERIFY(tstats.minPeriod <= tstats.meanPeriod);
+            QVERIFY(tstats.meanPeriod <= tstats.maxPeriod);
+            QCOMPARE(tstats.overruns, Q_UINT64_C(0));
             TimerStatus tstatus = m_test_timer->getTimerStatus();
             QCOMPARE(tstatus.getLost(), 0L);
             QCOMPARE(tstatus.getOverrun(), 0L);
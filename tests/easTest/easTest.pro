@@ -0,0 +1,40 @@
+TEMPLATE  = app
+TARGET    = easTest
+QT       += testlib
+QT       -= gui
+CONFIG   += c++11 cmdline
+include (../../global.pri)
+include (../../library/rt-backends/eassynth/sonivox/sonivox.pri)
+HEADERS += ../../library/rt-backends/eassynth/src/audioringbuffer.h \
+           ../../library/rt-backends/eassynth/src/offlinerenderer.h \
+           ../../library/rt-backends/eassynth/src/renderpool.h \
+           ../../library/rt-backends/eassynth/src/resampler.h \
+           ../../library/rt-backends/eassynth/src/synthrenderer.h
+SOURCES += eastest.cpp \
+           ../../library/rt-backends/eassynth/src/audioringbuffer.cpp \
+           ../../library/rt-backends/eassynth/src/offlinerenderer.cpp \
+           ../../library/rt-backends/eassynth/src/renderpool.cpp \
+           ../../library/rt-backends/eassynth/src/resampler.cpp \
+           ../../library/rt-backends/eassynth/src/synthrenderer.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
+INCLUDEPATH += . ../../library/include/ \
+               ../../library/rt-backends/eassynth/src/ \
+               ../../library/rt-backends/eassynth/sonivox/host_src/ \
+               ../../library/rt-backends/eassynth/sonivox/lib_src/
+# the wavetable engine structures depend on the sonivox build options
+DEFINES += EAS_WT_SYNTH \
+           NUM_OUTPUT_CHANNELS=2 \
+           _SAMPLE_RATE_22050 \
+           MAX_SYNTH_VOICES=$$EAS_MAX_VOICES \
+           _16_BIT_SAMPLES \
+           _FILTER_ENABLED \
+           DLS_SYNTHESIZER \
+           _REVERB_ENABLED \
+           _CHORUS_ENABLED \
+           _SIMD_KERNELS
+DESTDIR = ../../build/bin
+LIBS += -L$$OUT_PWD/../../build/lib \
+        -l$$drumstickLib(drumstick-file) \
+        -lsonivox
+CONFIG += link_pkgconfig
+PKGCONFIG += libpulse-simple libpulse
@@ -0,0 +1,891 @@
+/*
+    Copyright (C) 2008-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This file is part of the Drumstick project, see https://sf.net/p/drumstick
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <random>
+#include <thread>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QTemporaryDir>
+#include <QVector>
+#include <QtTest>
+#include "audioringbuffer.h"
+#include "offlinerenderer.h"
+#include "renderpool.h"
+#include "resampler.h"
+#include "synthrenderer.h"
+
+extern "C" {
+#include "eas_types.h"
+#include "eas_math.h"
+#include "eas_audioconst.h"
+#include "eas_sndlib.h"
+#include "eas_wtengine.h"
+#include "eas_effects.h"
+#include "eas_reverb.h"
+#include "eas_chorus.h"
+extern const S_EFFECTS_INTERFACE EAS_Reverb;
+extern const S_EFFECTS_INTERFACE EAS_Chorus;
+void WT_VoiceGain(S_WT_VOICE *pWTVoice, S_WT_INT_FRAME *pWTIntFrame);
+void WT_Interpolate(S_WT_VOICE *pWTVoice, S_WT_INT_FRAME *pWTIntFrame);
+void WT_InterpolateNoLoop(S_WT_VOICE *pWTVoice, S_WT_INT_FRAME *pWTIntFrame);
+void WT_VoiceFilter(S_FILTER_CONTROL *pFilter, S_WT_INT_FRAME *pWTIntFrame);
+}
+
+using namespace drumstick::rt;
+
+class EasTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    EasTest();
+
+private:
+    qint64 findOnset(SynthRenderer &renderer, qint64 frames);
+    void createSequence(OfflineRenderer &renderer, int seconds);
+    double poolThroughput(int threads, int jobs, int seconds);
+    void kernelData();
+    void effectData();
+    void enableEffectsSIMD(bool enable);
+    void processEffect(bool reverb, bool simd, QVector<EAS_PCM> &output);
+
+private Q_SLOTS:
+    void testOnsetTiming();
+    void testImmediateMessages();
+    void testImmediateAfterScheduled();
+    void testStatistics();
+    void testAudioRingBuffer();
+    void testOfflineRender();
+    void benchmarkOfflineRender();
+    void testRenderPool();
+    void benchmarkRenderPool();
+    void testWavetableKernels();
+    void testSIMDRender();
+    void benchmarkInterpolate_data();
+    void benchmarkInterpolate();
+    void benchmarkVoiceGain_data();
+    void benchmarkVoiceGain();
+    void benchmarkVoiceFilter();
+    void testEffectKernels_data();
+    void testEffectKernels();
+    void testEffectsRender();
+    void benchmarkEffect_data();
+    void benchmarkEffect();
+    void testResampler_data();
+    void testResampler();
+    void benchmarkVoiceManager_data();
+    void benchmarkVoiceManager();
+    void benchmarkVoiceCost();
+};
+
+EasTest::EasTest() = default;
+
+/* first frame with a sample above the noise floor, or -1 */
+qint64 EasTest::findOnset(SynthRenderer &renderer, qint64 frames)
+{
+    const int threshold = 8;
+    const int channels = renderer.channels();
+    QVector<EAS_PCM> buffer(renderer.bufferSize() * channels);
+    qint64 last = renderer.renderedFrames() + frames;
+    while (renderer.renderedFrames() < last) {
+        qint64 position = renderer.renderedFrames();
+        int numGen = renderer.renderBlock(buffer.data());
+        if (numGen <= 0) {
+            break;
+        }
+        for (int i = 0; i < numGen * channels; ++i) {
+            if (qAbs(buffer[i]) > threshold) {
+                return position + i / channels;
+            }
+        }
+    }
+    return -1;
+}
+
+void EasTest::testOnsetTiming()
+{
+    const qint64 requested[] = { 1000, 1037, 1100, 1151, 1217, 1280, 1343, 1500, 4099 };
+    const int attackFrames = 32;
+    qint64 maxError = 0;
+    for (qint64 frame : requested) {
+        SynthRenderer renderer;
+        renderer.initReverb(-1);
+        renderer.initChorus(-1);
+        const qint64 tolerance = renderer.bufferSize() / 2 + attackFrames;
+        renderer.sendMessageAt(frame, 2, 0xC0, 0);
+        renderer.sendMessageAt(frame, 3, 0x90, 60, 127);
+        qint64 onset = findOnset(renderer, frame + renderer.sampleRate());
+        QVERIFY2(onset >= 0, "no sound rendered");
+        qint64 error = onset - frame;
+        QVERIFY2(qAbs(error) <= tolerance,
+                 qPrintable(QString("requested frame %1, onset at %2").arg(frame).arg(onset)));
+        maxError = qMax(maxError, qAbs(error));
+    }
+    qDebug() << "maximum onset error:" << maxError << "frames";
+}
+
+void EasTest::testImmediateMessages()
+{
+    SynthRenderer renderer;
+    renderer.initReverb(-1);
+    renderer.initChorus(-1);
+    QCOMPARE(findOnset(renderer, 10 * renderer.bufferSize()), qint64(-1));
+    qint64 position = renderer.renderedFrames();
+    QCOMPARE(position, qint64(10 * renderer.bufferSize()));
+    renderer.sendMessage(0x90, 60, 127);
+    qint64 onset = findOnset(renderer, renderer.sampleRate());
+    QVERIFY(onset >= position);
+    QVERIFY(onset < position + renderer.bufferSize());
+}
+
+void EasTest::testImmediateAfterScheduled()
+{
+    SynthRenderer renderer;
+    renderer.initReverb(-1);
+    renderer.initChorus(-1);
+    // a message scheduled ahead must not hold back the live input
+    renderer.sendMessageAt(10 * renderer.sampleRate(), 3, 0x90, 60, 127);
+    renderer.sendMessage(0x90, 64, 127);
+    qint64 onset = findOnset(renderer, renderer.sampleRate());
+    QVERIFY(onset >= 0);
+    QVERIFY(onset < renderer.bufferSize());
+}
+
+void EasTest::testStatistics()
+{
+    SynthRenderer renderer;
+    renderer.initReverb(-1);
+    renderer.initChorus(-1);
+    QVector<EAS_PCM> buffer(renderer.bufferSize() * renderer.channels());
+    // apply the queued effect parameters
+    QVERIFY(renderer.renderBlock(buffer.data()) > 0);
+    const int notes = MAX_SYNTH_VOICES + 32;
+    for (int i = 0; i < notes; ++i) {
+        renderer.sendMessage(MIDI_STATUS_NOTEON | (i % 16), 24 + (i / 16) % 80, 100);
+    }
+    QVariantMap stats = renderer.statistics();
+    QCOMPARE(stats["messages_queued"].toInt(), notes);
+    QCOMPARE(stats["queue_depth"].toInt(), notes);
+    QCOMPARE(stats["active_voices"].toInt(), 0);
+    for (int i = 0; i < 10; ++i) {
+        QVERIFY(renderer.renderBlock(buffer.data()) > 0);
+    }
+    stats = renderer.statistics();
+    QCOMPARE(stats["queue_depth"].toInt(), 0);
+    QVERIFY(stats["active_voices"].toInt() > 0);
+    QVERIFY(stats["active_voices"].toInt() <= MAX_SYNTH_VOICES);
+    QVERIFY(stats["max_active_voices"].toInt() >= stats["active_voices"].toInt());
+    QVERIFY(stats["stolen_voices"].toULongLong() > 0);
+    QVERIFY(stats["render_time_max_us"].toLongLong() >= stats["render_time_us"].toLongLong());
+    QCOMPARE(stats["messages_dropped"].toInt(), 0);
+    QCOMPARE(stats["underruns"].toInt(), 0);
+
+    for (int i = 0; i < SynthRenderer::MESSAGE_QUEUE_SIZE; ++i) {
+        renderer.sendMessage(MIDI_STATUS_CONTROLCHANGE, 7, 100);
+    }
+    stats = renderer.statistics();
+    QCOMPARE(stats["messages_dropped"].toInt(), 1);
+    renderer.resetStatistics();
+    stats = renderer.statistics();
+    QCOMPARE(stats["messages_queued"].toInt(), 0);
+    QCOMPARE(stats["messages_dropped"].toInt(), 0);
+    QCOMPARE(stats["stolen_voices"].toULongLong(), Q_UINT64_C(0));
+}
+
+/* a producer and a consumer thread with unrelated block sizes */
+void EasTest::testAudioRingBuffer()
+{
+    AudioRingBuffer ring(300, 2);
+    QCOMPARE(ring.capacity(), 512);
+    QCOMPARE(ring.writeAvailable(), 512);
+    QVector<qint16> block(2 * 600);
+    QCOMPARE(ring.write(block.constData(), 600), 512);
+    QCOMPARE(ring.readAvailable(), 512);
+    QCOMPARE(ring.write(block.constData(), 1), 0);
+    QCOMPARE(ring.read(block.data(), 600), 512);
+    QCOMPARE(ring.read(block.data(), 1), 0);
+
+    const qint64 frames = 2000000;
+    std::thread producer([&ring, frames] {
+        qint16 data[2 * 77];
+        qint64 written = 0;
+        while (written < frames) {
+            int count = int(qMin<qint64>(77, frames - written));
+            for (int i = 0; i < count; ++i) {
+                data[2 * i] = qint16(written + i);
+                data[2 * i + 1] = qint16(~(written + i));
+            }
+            int done = 0;
+            while (done < count) {
+                done += ring.write(data + 2 * done, count - done);
+            }
+            written += count;
+        }
+    });
+    qint16 data[2 * 131];
+    qint64 read = 0;
+    qint64 errors = 0;
+    while (read < frames) {
+        int count = ring.read(data, 131);
+        for (int i = 0; i < count; ++i, ++read) {
+            if (data[2 * i] != qint16(read) || data[2 * i + 1] != qint16(~read)) {
+                ++errors;
+            }
+        }
+    }
+    producer.join();
+    QCOMPARE(errors, qint64(0));
+    QCOMPARE(ring.readAvailable(), 0);
+}
+
+/* sixteenth note arpeggios at 120 bpm on four channels, with a bass line */
+void EasTest::createSequence(OfflineRenderer &renderer, int seconds)
+{
+    const qint64 step = renderer.sampleRate() / 8;
+    const int chord[] = { 0, 4, 7, 12 };
+    for (int chan = 0; chan < 4; ++chan) {
+        renderer.addMessage(0, MIDI_STATUS_PROGRAMCHANGE | chan, chan * 8);
+    }
+    for (qint64 i = 0; i < seconds * 8; ++i) {
+        qint64 frame = i * step;
+        for (int chan = 0; chan < 4; ++chan) {
+            int note = 48 + chan * 12 + chord[i % 4];
+            renderer.addMessage(frame, MIDI_STATUS_NOTEON | chan, note, 100);
+            renderer.addMessage(frame + step - 1, MIDI_STATUS_NOTEOFF | chan, note, 0);
+        }
+        if (i % 8 == 0) {
+            renderer.addMessage(frame, MIDI_STATUS_NOTEON | 4, 36, 110);
+            renderer.addMessage(frame + 8 * step - 1, MIDI_STATUS_NOTEOFF | 4, 36, 0);
+        }
+    }
+}
+
+void EasTest::testOfflineRender()
+{
+    OfflineRenderer renderer;
+    renderer.synth()->initReverb(-1);
+    renderer.synth()->initChorus(-1);
+    renderer.setTailTime(500);
+    renderer.addMessage(2000, MIDI_STATUS_NOTEOFF, 60, 0);
+    renderer.addMessage(1000, MIDI_STATUS_NOTEON, 60, 127);
+    QCOMPARE(renderer.messageCount(), 2);
+    const qint64 length = renderer.length();
+    QCOMPARE(length, 2000 + renderer.sampleRate() / 2);
+
+    qint64 frames = 0;
+    qint64 onset = -1;
+    qint64 rendered = renderer.render([&](const EAS_PCM *samples, int count) {
+        for (int i = 0; onset < 0 && i < count * renderer.channels(); ++i) {
+            if (samples[i] != 0) {
+                onset = frames + i / renderer.channels();
+            }
+        }
+        frames += count;
+    });
+    QCOMPARE(rendered, frames);
+    QVERIFY(frames >= length);
+    QVERIFY(frames < length + renderer.synth()->bufferSize());
+    QVERIFY(onset >= 1000 - renderer.synth()->bufferSize() / 2);
+    QVERIFY(onset < 1000 + renderer.synth()->bufferSize());
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString fileName = dir.filePath("offline.wav");
+    QVERIFY2(renderer.renderToFile(fileName), qPrintable(renderer.errorString()));
+    QFileInfo info(fileName);
+    QCOMPARE(info.size(), 44 + frames * renderer.channels() * qint64(sizeof(EAS_PCM)));
+    QVERIFY(!renderer.loadSMF(dir.filePath("missing.mid")));
+    QVERIFY(!renderer.errorString().isEmpty());
+}
+
+void EasTest::benchmarkOfflineRender()
+{
+    const int seconds = 60;
+    OfflineRenderer renderer;
+    createSequence(renderer, seconds);
+    qint64 frames = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        frames += renderer.render(nullptr);
+    }
+    double rendered = double(frames) / renderer.sampleRate();
+    double elapsed = timer.nsecsElapsed() / 1e9;
+    qDebug() << "rendered" << rendered << "seconds in" << elapsed
+             << "seconds:" << rendered / elapsed << "rendered seconds per second";
+}
+
+void EasTest::testRenderPool()
+{
+    const int jobs = 8;
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QList<QByteArray> results[2];
+    const int threads[2] = { 1, 4 };
+    for (int run = 0; run < 2; ++run) {
+        RenderPool pool;
+        pool.setMaxThreads(threads[run]);
+        pool.setTailTime(200);
+        for (int i = 0; i < jobs; ++i) {
+            /* even jobs render the bass channel alone */
+            quint16 mask = (i % 2 == 0) ? 0x0010 : 0xffff;
+            pool.addJob(dir.filePath(QString("job%1.wav").arg(i)), [this, mask](OfflineRenderer &renderer) {
+                renderer.setChannelMask(mask);
+                createSequence(renderer, 2);
+                return true;
+            });
+        }
+        pool.addFile(dir.filePath("missing.mid"), dir.filePath("missing.wav"));
+        QCOMPARE(pool.jobCount(), jobs + 1);
+        QVERIFY(!pool.run());
+        QCOMPARE(pool.errors().count(), 1);
+        for (int i = 0; i < jobs; ++i) {
+            QFile file(dir.filePath(QString("job%1.wav").arg(i)));
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            results[run] << file.readAll();
+        }
+    }
+    for (int i = 0; i < jobs; ++i) {
+        QVERIFY(results[0][i].size() > 44);
+        QVERIFY(results[0][i] == results[1][i]);
+        QVERIFY(results[0][i] == results[0][i % 2]);
+    }
+    QVERIFY(results[0][0] != results[0][1]);
+}
+
+/* rendered seconds per wall clock second */
+double EasTest::poolThroughput(int threads, int jobs, int seconds)
+{
+    RenderPool pool;
+    pool.setMaxThreads(threads);
+    for (int i = 0; i < jobs; ++i) {
+        pool.addJob(QString(), [this, seconds](OfflineRenderer &renderer) {
+            createSequence(renderer, seconds);
+            return true;
+        });
+    }
+    QElapsedTimer timer;
+    timer.start();
+    pool.run();
+    double elapsed = timer.nsecsElapsed() / 1e9;
+    return double(pool.renderedFrames()) / pool.sampleRate() / elapsed;
+}
+
+void EasTest::benchmarkRenderPool()
+{
+    const int cores = QThread::idealThreadCount();
+    const double single = poolThroughput(1, cores, 20);
+    for (int threads = 1; threads <= cores; threads *= 2) {
+        double throughput = poolThroughput(threads, cores * 2, 20);
+        qDebug() << threads << "threads:" << throughput << "rendered seconds per second,"
+                 << "speedup" << throughput / single;
+    }
+    QBENCHMARK {
+        poolThroughput(cores, cores, 10);
+    }
+}
+
+/* compares the SIMD and scalar kernels with random voices */
+void EasTest::testWavetableKernels()
+{
+    WT_EnableSIMD(EAS_TRUE);
+    if (!WT_SIMDEnabled()) {
+        QSKIP("SIMD kernels not available");
+    }
+    std::mt19937 gen(2026);
+    auto random = [&gen](int low, int high) {
+        return std::uniform_int_distribution<int>(low, high)(gen);
+    };
+    QVector<EAS_SAMPLE> wave(8192);
+    for (EAS_SAMPLE &sample : wave) {
+        sample = static_cast<EAS_SAMPLE>(random(-32768, 32767));
+    }
+    for (int test = 0; test < 20000; ++test) {
+        S_WT_VOICE voice[2];
+        S_WT_INT_FRAME frame[2];
+        EAS_PCM audio[2][BUFFER_SIZE_IN_MONO_SAMPLES];
+        EAS_I32 mix[2][2 * BUFFER_SIZE_IN_MONO_SAMPLES];
+        const int kernel = test % 3;
+        const int numSamples = random(1, BUFFER_SIZE_IN_MONO_SAMPLES);
+        const int loopStart = random(0, 1000);
+        const int loopEnd = loopStart + random(1, 2000);
+        const int position = kernel == 1 ? random(0, 1000) : random(loopStart, loopEnd);
+        const EAS_I32 phaseInc = random(0, test % 4 ? 1 << 16 : 1 << 20);
+        const EAS_U32 phaseFrac = random(0, PHASE_FRAC_MASK);
+        const EAS_I32 prevGain = random(-32767, 32767);
+        const EAS_I32 gainTarget = random(-32767, 32767);
+        const EAS_I16 gainLeft = static_cast<EAS_I16>(random(-32768, 32767));
+        const EAS_I16 gainRight = static_cast<EAS_I16>(random(-32768, 32767));
+        for (int i = 0; i < numSamples; ++i) {
+            audio[0][i] = audio[1][i] = static_cast<EAS_PCM>(random(-32768, 32767));
+        }
+        for (int i = 0; i < 2 * BUFFER_SIZE_IN_MONO_SAMPLES; ++i) {
+            mix[0][i] = mix[1][i] = random(-100000, 100000);
+        }
+        for (int k = 0; k < 2; ++k) {
+            memset(&voice[k], 0, sizeof(S_WT_VOICE));
+            memset(&frame[k], 0, sizeof(S_WT_INT_FRAME));
+            voice[k].loopStart = reinterpret_cast<EAS_U32>(wave.constData() + loopStart);
+            voice[k].loopEnd = reinterpret_cast<EAS_U32>(wave.constData() + loopEnd);
+            voice[k].phaseAccum = reinterpret_cast<EAS_U32>(wave.constData() + position);
+            voice[k].phaseFrac = phaseFrac;
+            voice[k].gainLeft = gainLeft;
+            voice[k].gainRight = gainRight;
+            frame[k].numSamples = numSamples;
+            frame[k].pAudioBuffer = audio[k];
+            frame[k].pMixBuffer = mix[k];
+            frame[k].prevGain = prevGain;
+            frame[k].frame.gainTarget = gainTarget;
+            frame[k].frame.phaseIncrement = phaseInc;
+            WT_EnableSIMD(k == 0 ? EAS_FALSE : EAS_TRUE);
+            switch (kernel) {
+            case 0:
+                WT_Interpolate(&voice[k], &frame[k]);
+                break;
+            case 1:
+                WT_InterpolateNoLoop(&voice[k], &frame[k]);
+                break;
+            default:
+                WT_VoiceGain(&voice[k], &frame[k]);
+            }
+        }
+        QVERIFY2(memcmp(audio[0], audio[1], sizeof(audio[0])) == 0, qPrintable(QString("test %1").arg(test)));
+        QVERIFY2(memcmp(mix[0], mix[1], sizeof(mix[0])) == 0, qPrintable(QString("test %1").arg(test)));
+        QCOMPARE(voice[0].phaseAccum, voice[1].phaseAccum);
+        QCOMPARE(voice[0].phaseFrac, voice[1].phaseFrac);
+    }
+    WT_EnableSIMD(EAS_TRUE);
+}
+
+void EasTest::testSIMDRender()
+{
+    QByteArray output[2];
+    for (int k = 0; k < 2; ++k) {
+        WT_EnableSIMD(k == 0 ? EAS_FALSE : EAS_TRUE);
+        OfflineRenderer renderer;
+        renderer.setTailTime(500);
+        createSequence(renderer, 5);
+        renderer.render([&](const EAS_PCM *samples, int frames) {
+            output[k].append(reinterpret_cast<const char *>(samples), frames * renderer.channels() * int(sizeof(EAS_PCM)));
+        });
+    }
+    WT_EnableSIMD(EAS_TRUE);
+    QVERIFY(!output[0].isEmpty());
+    QVERIFY(output[0] == output[1]);
+}
+
+void EasTest::kernelData()
+{
+    QTest::addColumn<bool>("simd");
+    QTest::newRow("scalar") << false;
+    QTest::newRow("simd") << true;
+}
+
+void EasTest::benchmarkInterpolate_data()
+{
+    kernelData();
+}
+
+void EasTest::benchmarkInterpolate()
+{
+    QFETCH(bool, simd);
+    QVector<EAS_SAMPLE> wave(4096);
+    for (int i = 0; i < wave.size(); ++i) {
+        wave[i] = static_cast<EAS_SAMPLE>((i * 2731) & 0xffff);
+    }
+    S_WT_VOICE voice;
+    S_WT_INT_FRAME frame;
+    EAS_PCM audio[BUFFER_SIZE_IN_MONO_SAMPLES];
+    memset(&voice, 0, sizeof(S_WT_VOICE));
+    memset(&frame, 0, sizeof(S_WT_INT_FRAME));
+    voice.loopStart = reinterpret_cast<EAS_U32>(wave.constData());
+    voice.loopEnd = reinterpret_cast<EAS_U32>(wave.constData() + 4000);
+    voice.phaseAccum = voice.loopStart;
+    frame.numSamples = BUFFER_SIZE_IN_MONO_SAMPLES;
+    frame.pAudioBuffer = audio;
+    frame.frame.phaseIncrement = 40000;
+    WT_EnableSIMD(simd ? EAS_TRUE : EAS_FALSE);
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            WT_Interpolate(&voice, &frame);
+        }
+    }
+    WT_EnableSIMD(EAS_TRUE);
+}
+
+void EasTest::benchmarkVoiceGain_data()
+{
+    kernelData();
+}
+
+void EasTest::benchmarkVoiceGain()
+{
+    QFETCH(bool, simd);
+    S_WT_VOICE voice;
+    S_WT_INT_FRAME frame;
+    EAS_PCM audio[BUFFER_SIZE_IN_MONO_SAMPLES];
+    EAS_I32 mix[2 * BUFFER_SIZE_IN_MONO_SAMPLES];
+    memset(&voice, 0, sizeof(S_WT_VOICE));
+    memset(&frame, 0, sizeof(S_WT_INT_FRAME));
+    memset(mix, 0, sizeof(mix));
+    for (int i = 0; i < BUFFER_SIZE_IN_MONO_SAMPLES; ++i) {
+        audio[i] = static_cast<EAS_PCM>((i * 2731) & 0xffff);
+    }
+    voice.gainLeft = 20000;
+    voice.gainRight = 10000;
+    frame.numSamples = BUFFER_SIZE_IN_MONO_SAMPLES;
+    frame.pAudioBuffer = audio;
+    frame.pMixBuffer = mix;
+    frame.prevGain = 1000;
+    frame.frame.gainTarget = 2000;
+    WT_EnableSIMD(simd ? EAS_TRUE : EAS_FALSE);
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            WT_VoiceGain(&voice, &frame);
+        }
+    }
+    WT_EnableSIMD(EAS_TRUE);
+}
+
+/* the filter is recursive, and has no SIMD version: baseline only */
+void EasTest::benchmarkVoiceFilter()
+{
+    S_FILTER_CONTROL filter;
+    S_WT_INT_FRAME frame;
+    EAS_PCM audio[BUFFER_SIZE_IN_MONO_SAMPLES];
+    memset(&filter, 0, sizeof(S_FILTER_CONTROL));
+    memset(&frame, 0, sizeof(S_WT_INT_FRAME));
+    for (int i = 0; i < BUFFER_SIZE_IN_MONO_SAMPLES; ++i) {
+        audio[i] = static_cast<EAS_PCM>((i * 2731) & 0x0fff);
+    }
+    frame.numSamples = BUFFER_SIZE_IN_MONO_SAMPLES;
+    frame.pAudioBuffer = audio;
+    frame.frame.k = 8192;
+    frame.frame.b1 = -12000;
+    frame.frame.b2 = 4000;
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            WT_VoiceFilter(&filter, &frame);
+        }
+    }
+}
+
+void EasTest::effectData()
+{
+    QTest::addColumn<bool>("reverb");
+    QTest::newRow("reverb") << true;
+    QTest::newRow("chorus") << false;
+}
+
+void EasTest::enableEffectsSIMD(bool enable)
+{
+    ReverbEnableSIMD(enable ? EAS_TRUE : EAS_FALSE);
+    ChorusEnableSIMD(enable ? EAS_TRUE : EAS_FALSE);
+}
+
+/* drives an effect with noise of several levels and random parameters */
+void EasTest::processEffect(bool reverb, bool simd, QVector<EAS_PCM> &output)
+{
+    const S_EFFECTS_INTERFACE *effect = reverb ? &EAS_Reverb : &EAS_Chorus;
+    const int channels = NUM_OUTPUT_CHANNELS;
+    const int blocks = 3000;
+    std::mt19937 gen(2026);
+    auto random = [&gen](int low, int high) {
+        return std::uniform_int_distribution<int>(low, high)(gen);
+    };
+    EAS_DATA_HANDLE easData = nullptr;
+    EAS_VOID_PTR instData = nullptr;
+    QVERIFY(EAS_Init(&easData) == EAS_SUCCESS);
+    QVERIFY(effect->pfInit(easData, &instData) == EAS_SUCCESS);
+    effect->pFSetParam(instData, reverb ? EAS_PARAM_REVERB_BYPASS : EAS_PARAM_CHORUS_BYPASS, EAS_FALSE);
+    enableEffectsSIMD(simd);
+    output.fill(0, blocks * BUFFER_SIZE_IN_MONO_SAMPLES * channels);
+    for (int block = 0; block < blocks; ++block) {
+        if (block % 50 == 0) {
+            if (reverb) {
+                effect->pFSetParam(instData, EAS_PARAM_REVERB_PRESET, random(EAS_PARAM_REVERB_LARGE_HALL, EAS_PARAM_REVERB_ROOM));
+                effect->pFSetParam(instData, EAS_PARAM_REVERB_WET, random(0, 32767));
+                effect->pFSetParam(instData, EAS_PARAM_REVERB_DRY, random(0, 32767));
+            } else {
+                effect->pFSetParam(instData, EAS_PARAM_CHORUS_PRESET, random(EAS_PARAM_CHORUS_PRESET1, EAS_PARAM_CHORUS_PRESET4));
+                effect->pFSetParam(instData, EAS_PARAM_CHORUS_RATE, random(10, 50));
+                effect->pFSetParam(instData, EAS_PARAM_CHORUS_DEPTH, random(15, 60));
+                effect->pFSetParam(instData, EAS_PARAM_CHORUS_LEVEL, random(0, 32767));
+            }
+        }
+        const int level = (block / 100) % 3 == 0 ? 32767 : ((block / 100) % 3 == 1 ? 2000 : 150);
+        const int frames = block % 7 == 0 ? random(1, BUFFER_SIZE_IN_MONO_SAMPLES) : BUFFER_SIZE_IN_MONO_SAMPLES;
+        EAS_PCM *buffer = output.data() + block * BUFFER_SIZE_IN_MONO_SAMPLES * channels;
+        for (int i = 0; i < frames * channels; ++i) {
+            buffer[i] = static_cast<EAS_PCM>(random(-level - 1, level));
+        }
+        effect->pfProcess(instData, buffer, buffer, frames);
+    }
+    effect->pfShutdown(easData, instData);
+    EAS_Shutdown(easData);
+    enableEffectsSIMD(true);
+}
+
+void EasTest::testEffectKernels_data()
+{
+    effectData();
+}
+
+/* compares the SIMD and scalar reverb and chorus with saturating input */
+void EasTest::testEffectKernels()
+{
+    QFETCH(bool, reverb);
+    enableEffectsSIMD(true);
+    if (!(reverb ? ReverbSIMDEnabled() : ChorusSIMDEnabled())) {
+        QSKIP("SIMD effects not available");
+    }
+    QVector<EAS_PCM> output[2];
+    for (int k = 0; k < 2; ++k) {
+        processEffect(reverb, k == 1, output[k]);
+    }
+    QCOMPARE(output[0].size(), output[1].size());
+    for (int i = 0; i < output[0].size(); ++i) {
+        QVERIFY2(output[0][i] == output[1][i], qPrintable(QString("sample %1").arg(i)));
+    }
+}
+
+void EasTest::testEffectsRender()
+{
+    QByteArray output[2];
+    for (int k = 0; k < 2; ++k) {
+        enableEffectsSIMD(k == 1);
+        OfflineRenderer renderer;
+        renderer.synth()->initReverb(EAS_PARAM_REVERB_HALL);
+        renderer.synth()->initChorus(EAS_PARAM_CHORUS_PRESET2);
+        renderer.setTailTime(1000);
+        createSequence(renderer, 5);
+        renderer.render([&](const EAS_PCM *samples, int frames) {
+            output[k].append(reinterpret_cast<const char *>(samples), frames * renderer.channels() * int(sizeof(EAS_PCM)));
+        });
+    }
+    enableEffectsSIMD(true);
+    QVERIFY(!output[0].isEmpty());
+    QVERIFY(output[0] == output[1]);
+}
+
+void EasTest::benchmarkEffect_data()
+{
+    QTest::addColumn<bool>("reverb");
+    QTest::addColumn<bool>("simd");
+    QTest::newRow("reverb scalar") << true << false;
+    QTest::newRow("reverb simd") << true << true;
+    QTest::newRow("chorus scalar") << false << false;
+    QTest::newRow("chorus simd") << false << true;
+}
+
+void EasTest::benchmarkEffect()
+{
+    QFETCH(bool, reverb);
+    QFETCH(bool, simd);
+    const S_EFFECTS_INTERFACE *effect = reverb ? &EAS_Reverb : &EAS_Chorus;
+    EAS_PCM audio[BUFFER_SIZE_IN_MONO_SAMPLES * NUM_OUTPUT_CHANNELS];
+    EAS_DATA_HANDLE easData = nullptr;
+    EAS_VOID_PTR instData = nullptr;
+    QVERIFY(EAS_Init(&easData) == EAS_SUCCESS);
+    QVERIFY(effect->pfInit(easData, &instData) == EAS_SUCCESS);
+    effect->pFSetParam(instData, reverb ? EAS_PARAM_REVERB_BYPASS : EAS_PARAM_CHORUS_BYPASS, EAS_FALSE);
+    for (int i = 0; i < BUFFER_SIZE_IN_MONO_SAMPLES * NUM_OUTPUT_CHANNELS; ++i) {
+        audio[i] = static_cast<EAS_PCM>((i * 2731) & 0x0fff);
+    }
+    enableEffectsSIMD(simd);
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            effect->pfProcess(instData, audio, audio, BUFFER_SIZE_IN_MONO_SAMPLES);
+        }
+    }
+    enableEffectsSIMD(true);
+    effect->pfShutdown(easData, instData);
+    EAS_Shutdown(easData);
+}
+
+void EasTest::testResampler_data()
+{
+    QTest::addColumn<int>("outputRate");
+    QTest::newRow("22050 Hz") << 22050;
+    QTest::newRow("44100 Hz") << 44100;
+    QTest::newRow("48000 Hz") << 48000;
+}
+
+/* a 1 kHz sine converted in synth sized blocks keeps its frequency and level */
+void EasTest::testResampler()
+{
+    QFETCH(int, outputRate);
+    const int inputRate = 22050;
+    const int blockFrames = 128;
+    const int blocks = inputRate / blockFrames;
+    const double frequency = 1000.0;
+    const double amplitude = 10000.0;
+    Resampler resampler;
+    resampler.setRates(inputRate, outputRate, 2);
+    QCOMPARE(resampler.isIdentity(), outputRate == inputRate);
+    QVector<qint16> input(blockFrames * 2);
+    QVector<qint16> output(resampler.maxOutputFrames(blockFrames) * 2);
+    QVector<qint16> left;
+    qint64 n = 0;
+    for (int block = 0; block < blocks; ++block) {
+        for (int i = 0; i < blockFrames; ++i, ++n) {
+            qint16 value = qint16(qRound(amplitude * std::sin(2 * M_PI * frequency * n / inputRate)));
+            input[2 * i] = value;
+            input[2 * i + 1] = -value;
+        }
+        int frames = resampler.process(input.constData(), blockFrames, output.data());
+        QVERIFY(frames <= resampler.maxOutputFrames(blockFrames));
+        for (int i = 0; i < frames; ++i) {
+            QCOMPARE(output[2 * i + 1], qint16(-output[2 * i]));
+            left.append(output[2 * i]);
+        }
+    }
+    const qint64 expected = qint64(blocks) * blockFrames * outputRate / inputRate;
+    QVERIFY(qAbs(left.count() - expected) <= 1);
+
+    int crossings = 0;
+    int peak = 0;
+    const int first = resampler.latency() + Resampler::TAPS;
+    for (int i = first + 1; i < left.count(); ++i) {
+        if ((left[i - 1] < 0) != (left[i] < 0)) {
+            ++crossings;
+        }
+        peak = qMax(peak, qAbs(int(left[i])));
+    }
+    double measured = crossings / 2.0 * outputRate / (left.count() - first);
+    QVERIFY2(qAbs(measured - frequency) < 5.0, qPrintable(QString("frequency %1 Hz").arg(measured)));
+    QVERIFY2(qAbs(peak - amplitude) < amplitude / 100, qPrintable(QString("peak %1").arg(peak)));
+}
+
+void EasTest::benchmarkVoiceManager_data()
+{
+    QTest::addColumn<int>("polyphony");
+    for (int voices : { 16, 32, 64, 128, 256 }) {
+        if (voices <= MAX_SYNTH_VOICES) {
+            QTest::newRow(qPrintable(QString("%1 voices").arg(voices))) << voices;
+        }
+    }
+}
+
+/*
+ * Random notes on all channels, without note offs and faster than they
+ * decay, so the voice manager is stealing voices all the time.
+ */
+void EasTest::benchmarkVoiceManager()
+{
+    QFETCH(int, polyphony);
+    const S_EAS_LIB_CONFIG *config = EAS_Config();
+    EAS_DATA_HANDLE easData = nullptr;
+    EAS_HANDLE stream = nullptr;
+    QVERIFY(EAS_Init(&easData) == EAS_SUCCESS);
+    QVERIFY(EAS_OpenMIDIStream(easData, &stream, nullptr) == EAS_SUCCESS);
+    QVERIFY(EAS_SetSynthPolyphony(easData, 0, polyphony) == EAS_SUCCESS);
+    QVector<EAS_PCM> buffer(config->mixBufferSize * config->numChannels);
+    std::mt19937 gen(polyphony);
+    auto random = [&gen](int low, int high) {
+        return std::uniform_int_distribution<int>(low, high)(gen);
+    };
+    EAS_I32 maxVoices = 0;
+    QBENCHMARK {
+        for (int block = 0; block < 200; ++block) {
+            for (int i = 0; i < 8; ++i) {
+                EAS_U8 msg[3] = { EAS_U8(MIDI_STATUS_NOTEON | random(0, 15)),
+                                  EAS_U8(random(24, 96)), EAS_U8(random(64, 127)) };
+                EAS_WriteMIDIStream(easData, stream, msg, 3);
+            }
+            EAS_I32 numGen = 0;
+            EAS_I32 active = 0;
+            EAS_Render(easData, buffer.data(), config->mixBufferSize, &numGen);
+            EAS_GetActiveVoices(easData, &active);
+            maxVoices = qMax(maxVoices, active);
+        }
+    }
+    QVERIFY(maxVoices <= polyphony);
+    QVERIFY(EAS_CloseMIDIStream(easData, stream) == EAS_SUCCESS);
+    QVERIFY(EAS_Shutdown(easData) == EAS_SUCCESS);
+}
+
+/*
+ * Renders an increasing number of sustained organ notes, and fits the render
+ * time to the number of active voices. The slope is the cost of a voice and
+ * the intercept the fixed cost of the mixer and effects, both as a fraction
+ * of one CPU core rendering in real time.
+ */
+void EasTest::benchmarkVoiceCost()
+{
+    const S_EAS_LIB_CONFIG *config = EAS_Config();
+    const int blocks = 2 * config->sampleRate / config->mixBufferSize;
+    QVector<EAS_PCM> buffer(config->mixBufferSize * config->numChannels);
+    QVector<double> voices, load;
+    for (int notes = 8; notes <= MAX_SYNTH_VOICES; notes *= 2) {
+        EAS_DATA_HANDLE easData = nullptr;
+        EAS_HANDLE stream = nullptr;
+        EAS_I32 numGen = 0;
+        EAS_I32 active = 0;
+        QVERIFY(EAS_Init(&easData) == EAS_SUCCESS);
+        QVERIFY(EAS_OpenMIDIStream(easData, &stream, nullptr) == EAS_SUCCESS);
+        for (int chan = 0; chan < 16; ++chan) {
+            EAS_U8 msg[2] = { EAS_U8(MIDI_STATUS_PROGRAMCHANGE | chan), 16 };
+            EAS_WriteMIDIStream(easData, stream, msg, 2);
+        }
+        for (int i = 0; i < notes; ++i) {
+            int chan = i % 15;
+            EAS_U8 msg[3] = { EAS_U8(MIDI_STATUS_NOTEON | (chan < 9 ? chan : chan + 1)),
+                              EAS_U8(36 + (i / 15) * 5), 100 };
+            EAS_WriteMIDIStream(easData, stream, msg, 3);
+        }
+        for (int i = 0; i < 20; ++i) {
+            EAS_Render(easData, buffer.data(), config->mixBufferSize, &numGen);
+        }
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < blocks; ++i) {
+            EAS_Render(easData, buffer.data(), config->mixBufferSize, &numGen);
+        }
+        double elapsed = timer.nsecsElapsed() / 1e9;
+        EAS_GetActiveVoices(easData, &active);
+        QVERIFY(active > 0);
+        voices << active;
+        load << elapsed / (double(blocks) * config->mixBufferSize / config->sampleRate);
+        qDebug() << notes << "notes," << active << "voices:" << 100 * load.last() << "% CPU";
+        EAS_CloseMIDIStream(easData, stream);
+        EAS_Shutdown(easData);
+    }
+    double mx = 0, my = 0, sxy = 0, sxx = 0;
+    for (int i = 0; i < voices.count(); ++i) {
+        mx += voices[i] / voices.count();
+        my += load[i] / voices.count();
+    }
+    for (int i = 0; i < voices.count(); ++i) {
+        sxy += (voices[i] - mx) * (load[i] - my);
+        sxx += (voices[i] - mx) * (voices[i] - mx);
+    }
+    QVERIFY(sxx > 0);
+    double perVoice = sxy / sxx;
+    double fixed = my - perVoice * mx;
+    qDebug() << "CPU per voice:" << 100 * perVoice << "%, fixed:" << 100 * fixed
+             << "%, voices per core:" << int((1 - fixed) / perVoice);
+}
+
+QTEST_APPLESS_MAIN(EasTest)
+
+#include "eastest.moc"
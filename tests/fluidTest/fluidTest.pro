@@ -0,0 +1,29 @@
+TEMPLATE  = app
+TARGET    = fluidTest
+QT       += testlib
+QT       -= gui
+CONFIG   += c++11 cmdline
+include (../../global.pri)
+HEADERS += ../../library/rt-backends/fluidsynth/fluidrenderer.h \
+           ../../library/rt-backends/fluidsynth/soundfontcache.h \
+           ../../library/rt-backends/fluidsynth/soundfontindex.h \
+           ../../library/rt-backends/fluidsynth/synthengine.h
+SOURCES += fluidtest.cpp \
+           ../../library/rt-backends/fluidsynth/fluidrenderer.cpp \
+           ../../library/rt-backends/fluidsynth/soundfontcache.cpp \
+           ../../library/rt-backends/fluidsynth/soundfontindex.cpp \
+           ../../library/rt-backends/fluidsynth/synthengine.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
+INCLUDEPATH += . ../../library/include/ \
+               ../../library/rt-backends/fluidsynth/
+DESTDIR = ../../build/bin
+LIBS += -L$$OUT_PWD/../../build/lib \
+        -l$$drumstickLib(drumstick-file)
+macx {
+    INCLUDEPATH += /Library/Frameworks/FluidSynth.framework/Headers
+    QMAKE_LFLAGS += -F/Library/Frameworks
+    LIBS += -framework FluidSynth
+} else {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += fluidsynth
+}
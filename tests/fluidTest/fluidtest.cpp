@@ -0,0 +1,339 @@
+/*
+    Copyright (C) 2008-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This file is part of the Drumstick project, see https://sf.net/p/drumstick
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QVector>
+#include <QtTest>
+#include "fluidrenderer.h"
+#include "soundfontcache.h"
+#include "soundfontindex.h"
+#include "synthengine.h"
+
+using namespace drumstick::rt;
+
+/*
+ * Without a SoundFont FluidSynth renders silence, so the tests checking
+ * the audio and the benchmarks need one: FLUIDTEST_SOUNDFONT names it,
+ * otherwise the default SoundFont of the engine is used. The benchmark
+ * renders the Standard MIDI File named by FLUIDTEST_MIDIFILE, or else
+ * a synthetic dense orchestral sequence.
+ */
+class FluidTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    FluidTest();
+
+private:
+    void writeSettings(QSettings &settings, int cpuCores);
+    bool initRenderer(FluidRenderer &renderer, int cpuCores);
+    void createSequence(FluidRenderer &renderer, int seconds);
+
+    QTemporaryDir m_dir;
+
+private Q_SLOTS:
+    void testCpuCores();
+    void testOfflineRender();
+    void testCpuCoresRender();
+    void testSoundFontCache();
+    void testSoundFontIndex();
+    void benchmarkCpuCores_data();
+    void benchmarkCpuCores();
+};
+
+FluidTest::FluidTest()
+{
+    /* keeps the SoundFont index of the tests out of the user cache */
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void FluidTest::writeSettings(QSettings &settings, int cpuCores)
+{
+    settings.beginGroup(SynthEngine::QSTR_PREFERENCES);
+    settings.setValue(SynthEngine::QSTR_SAMPLERATE, 44100.0);
+    settings.setValue(SynthEngine::QSTR_POLYPHONY, 512);
+    settings.setValue(SynthEngine::QSTR_CHORUS, 1);
+    settings.setValue(SynthEngine::QSTR_REVERB, 1);
+    settings.setValue(SynthEngine::QSTR_CPUCORES, cpuCores);
+    QByteArray soundFont = qgetenv("FLUIDTEST_SOUNDFONT");
+    if (!soundFont.isEmpty()) {
+        settings.setValue(SynthEngine::QSTR_INSTRUMENTSDEFINITION, QString::fromLocal8Bit(soundFont));
+    }
+    settings.endGroup();
+    settings.sync();
+}
+
+/* returns true when a SoundFont is loaded */
+bool FluidTest::initRenderer(FluidRenderer &renderer, int cpuCores)
+{
+    QSettings settings(m_dir.filePath(QString("fluidtest%1.ini").arg(cpuCores)), QSettings::IniFormat);
+    writeSettings(settings, cpuCores);
+    renderer.initialize(&settings);
+    return renderer.engine()->synth() != nullptr
+        && ::fluid_synth_sfcount(renderer.engine()->synth()) > 0;
+}
+
+/*
+ * Sixteen channels of sustained, overlapping chords with volume swells,
+ * several hundred voices at the peaks.
+ */
+void FluidTest::createSequence(FluidRenderer &renderer, int seconds)
+{
+    const int programs[] = { 48, 48, 49, 42, 43, 60, 56, 57, 68, 71, 73, 52, 46, 0, 47, 89 };
+    const int chord[] = { 0, 7, 12, 16 };
+    const qint64 step = renderer.sampleRate() / 4;
+    QByteArray fileName = qgetenv("FLUIDTEST_MIDIFILE");
+    if (!fileName.isEmpty() && renderer.loadSMF(QString::fromLocal8Bit(fileName))) {
+        return;
+    }
+    for (int chan = 0; chan < MIDI_STD_CHANNELS; ++chan) {
+        if (chan != MIDI_GM_STD_DRUM_CHANNEL) {
+            renderer.addMessage(0, MIDI_STATUS_PROGRAMCHANGE | chan, programs[chan]);
+        }
+        renderer.addMessage(0, MIDI_STATUS_CONTROLCHANGE | chan, MIDI_CONTROL_REVERB_SEND, 64);
+    }
+    for (qint64 i = 0; i < seconds * 4; ++i) {
+        const qint64 frame = i * step;
+        for (int chan = 0; chan < MIDI_STD_CHANNELS; ++chan) {
+            renderer.addMessage(frame, MIDI_STATUS_CONTROLCHANGE | chan, 11, 64 + (i + chan) % 8 * 8);
+            if (chan == MIDI_GM_STD_DRUM_CHANNEL) {
+                renderer.addMessage(frame, MIDI_STATUS_NOTEON | chan, (i % 4 == 0) ? 49 : 42, 100);
+                continue;
+            }
+            const int root = 36 + (chan % 5) * 7 + (i / 8) % 5;
+            for (int note : chord) {
+                renderer.addMessage(frame, MIDI_STATUS_NOTEON | chan, root + note, 80 + chan);
+                renderer.addMessage(frame + 4 * step - 1, MIDI_STATUS_NOTEOFF | chan, root + note, 0);
+            }
+        }
+    }
+}
+
+void FluidTest::testCpuCores()
+{
+    QVERIFY(m_dir.isValid());
+    FluidRenderer renderer;
+    initRenderer(renderer, 4);
+    QVERIFY(renderer.engine()->synth() != nullptr);
+    QVERIFY(!renderer.engine()->realtime());
+    QCOMPARE(renderer.engine()->cpuCores(), 4);
+    QCOMPARE(renderer.sampleRate(), 44100);
+}
+
+void FluidTest::testOfflineRender()
+{
+    FluidRenderer renderer;
+    const bool sound = initRenderer(renderer, 1);
+    renderer.setTailTime(500);
+    renderer.setBlockSize(256);
+    renderer.addMessage(4000, MIDI_STATUS_NOTEOFF, 60, 0);
+    renderer.addMessage(1000, MIDI_STATUS_NOTEON, 60, 127);
+    QCOMPARE(renderer.messageCount(), 2);
+    const qint64 length = renderer.length();
+    QCOMPARE(length, 4000 + renderer.sampleRate() / 2);
+
+    qint64 frames = 0;
+    qint64 onset = -1;
+    int maxCount = 0;
+    qint64 rendered = renderer.render([&](const qint16 *samples, int count) {
+        maxCount = qMax(maxCount, count);
+        for (int i = 0; onset < 0 && i < count * renderer.channels(); ++i) {
+            if (samples[i] != 0) {
+                onset = frames + i / renderer.channels();
+            }
+        }
+        frames += count;
+    });
+    QCOMPARE(rendered, frames);
+    QCOMPARE(frames, length);
+    QVERIFY(maxCount <= renderer.blockSize());
+    if (sound) {
+        /* FluidSynth applies the events at its 64 frame period boundaries */
+        QVERIFY(onset >= 1000 - 64);
+        QVERIFY(onset < 1000 + 64);
+    }
+
+    QVector<qint16> buffer = renderer.renderToBuffer();
+    QCOMPARE(qint64(buffer.size()), length * renderer.channels());
+
+    QString fileName = m_dir.filePath("offline.wav");
+    QVERIFY2(renderer.renderToFile(fileName), qPrintable(renderer.errorString()));
+    QFileInfo info(fileName);
+    QCOMPARE(info.size(), 44 + frames * renderer.channels() * qint64(sizeof(qint16)));
+    QVERIFY(!renderer.loadSMF(m_dir.filePath("missing.mid")));
+    QVERIFY(!renderer.errorString().isEmpty());
+}
+
+/* only the float rounding of the voice mix may differ between core counts */
+void FluidTest::testCpuCoresRender()
+{
+    QVector<qint16> results[2];
+    const int cores[2] = { 1, 4 };
+    for (int run = 0; run < 2; ++run) {
+        FluidRenderer renderer;
+        if (!initRenderer(renderer, cores[run])) {
+            QSKIP("SoundFont not available");
+        }
+        renderer.setTailTime(200);
+        createSequence(renderer, 2);
+        results[run] = renderer.renderToBuffer();
+    }
+    QVERIFY(!results[0].isEmpty());
+    QCOMPARE(results[0].size(), results[1].size());
+    int maxDiff = 0;
+    for (int i = 0; i < results[0].size(); ++i) {
+        maxDiff = qMax(maxDiff, qAbs(results[0][i] - results[1][i]));
+    }
+    qDebug() << "maximum sample difference:" << maxDiff;
+    QVERIFY(maxDiff <= 2);
+}
+
+void FluidTest::testSoundFontCache()
+{
+    FluidRenderer first;
+    QSignalSpy progress(first.engine(), &SynthEngine::soundFontProgress);
+    QSignalSpy loaded(first.engine(), &SynthEngine::soundFontLoaded);
+    if (!initRenderer(first, 1)) {
+        QSKIP("SoundFont not available");
+    }
+    QVERIFY(!first.engine()->isLoading());
+    QVERIFY(progress.count() >= 2);
+    QCOMPARE(progress.last().at(1).toInt(), 100);
+    QCOMPARE(loaded.count(), 1);
+    QVERIFY(loaded.last().at(1).toBool());
+    const QString fileName = loaded.last().at(0).toString();
+    fluid_sfont_t *sfont = ::fluid_synth_get_sfont(first.engine()->synth(), 0);
+    QVERIFY(sfont != nullptr);
+
+    /* a second engine gets its own font object */
+    FluidRenderer second;
+    QVERIFY(initRenderer(second, 1));
+    QVERIFY(::fluid_synth_get_sfont(second.engine()->synth(), 0) != nullptr);
+    QVERIFY(::fluid_synth_get_sfont(second.engine()->synth(), 0) != sfont);
+
+    /* a failed load keeps the current font */
+    first.engine()->setSoundFont(m_dir.filePath("missing.sf2"));
+    first.engine()->waitForSoundFont();
+    QCOMPARE(loaded.count(), 2);
+    QVERIFY(!loaded.last().at(1).toBool());
+    QCOMPARE(::fluid_synth_get_sfont(first.engine()->synth(), 0), sfont);
+
+    /* a cached font is switched to at once, on the calling thread */
+    QElapsedTimer timer;
+    timer.start();
+    first.engine()->setSoundFont(fileName);
+    qint64 elapsed = timer.nsecsElapsed();
+    QVERIFY(!first.engine()->isLoading());
+    QCOMPARE(loaded.count(), 3);
+    QVERIFY(loaded.last().at(1).toBool());
+    QCOMPARE(::fluid_synth_get_sfont(first.engine()->synth(), 0), sfont);
+    qDebug() << "cached SoundFont switch:" << elapsed / 1000 << "microseconds";
+    QVERIFY(SoundFontCache::instance()->count() >= 1);
+}
+
+void FluidTest::testSoundFontIndex()
+{
+    QDir root(m_dir.filePath("tree"));
+    QVERIFY(root.mkpath("a/b"));
+    QVERIFY(root.mkpath("c"));
+    auto touch = [&root](const QString &name) {
+        QFile file(root.filePath(name));
+        return file.open(QIODevice::WriteOnly);
+    };
+    QVERIFY(touch("a/default.sf2"));
+    QVERIFY(touch("a/readme.txt"));
+    QVERIFY(touch("a/b/piano.SF2"));
+#if defined(Q_OS_UNIX)
+    QVERIFY(QFile::link(root.filePath("a"), root.filePath("a/b/loop")));
+#endif
+
+    const QString indexFile = m_dir.filePath("index/soundfonts.ini");
+    SoundFontIndex index(indexFile);
+    QVERIFY(!index.load());
+    index.refresh(QStringList{ root.absolutePath() });
+    QCOMPARE(index.directoryCount(), 4);
+    QCOMPARE(index.scannedDirectories(), 4);
+    QStringList files = index.files();
+    QCOMPARE(files.count(), 2);
+    QVERIFY(files.contains(root.filePath("a/default.sf2")));
+    QVERIFY(files.contains(root.filePath("a/b/piano.SF2")));
+    QVERIFY(index.save());
+
+    /* the saved index is used without touching the tree */
+    SoundFontIndex saved(indexFile);
+    QVERIFY(saved.load());
+    QCOMPARE(saved.files(), files);
+    saved.refresh(saved.roots());
+    QCOMPARE(saved.scannedDirectories(), 0);
+    QCOMPARE(saved.files(), files);
+
+    /* only the changed directory is listed again */
+    QThread::msleep(20);
+    QVERIFY(touch("c/strings.sf2"));
+    saved.refresh(saved.roots());
+    QCOMPARE(saved.scannedDirectories(), 1);
+    QCOMPARE(saved.files().count(), 3);
+    QVERIFY(root.remove("a/b/piano.SF2"));
+    saved.refresh(saved.roots());
+    QCOMPARE(saved.scannedDirectories(), 1);
+    QCOMPARE(saved.files().count(), 2);
+}
+
+void FluidTest::benchmarkCpuCores_data()
+{
+    QTest::addColumn<int>("cores");
+    const int ideal = QThread::idealThreadCount();
+    for (int cores = 1; cores <= ideal; cores *= 2) {
+        QTest::newRow(qPrintable(QString("%1 cores").arg(cores))) << cores;
+    }
+}
+
+void FluidTest::benchmarkCpuCores()
+{
+    QFETCH(int, cores);
+    const int seconds = 30;
+    FluidRenderer renderer;
+    if (!initRenderer(renderer, cores)) {
+        QSKIP("SoundFont not available");
+    }
+    createSequence(renderer, seconds);
+    qint64 frames = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        frames += renderer.render(nullptr);
+    }
+    double rendered = double(frames) / renderer.sampleRate();
+    double elapsed = timer.nsecsElapsed() / 1e9;
+    qDebug() << cores << "cores: rendered" << rendered << "seconds in" << elapsed
+             << "seconds:" << rendered / elapsed << "rendered seconds per second";
+}
+
+QTEST_GUILESS_MAIN(FluidTest)
+
+#include "fluidtest.moc"
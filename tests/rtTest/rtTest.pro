@@ -4,9 +4,11 @@ QT       += testlib
 QT       -= gui
 CONFIG   += c++11 cmdline
 include (../../global.pri)
-SOURCES += rttest.cpp
+HEADERS += ../../library/rt-backends/common/midiparser.h
+SOURCES += rttest.cpp \
+           ../../library/rt-backends/common/midiparser.cpp
 DEFINES += SRCDIR=\\\"$$PWD/\\\"
-INCLUDEPATH += . ../../library/include/
+INCLUDEPATH += . ../../library/include/ ../../library/rt-backends/common/
 DESTDIR = ../../build/bin
 
 static {
@@ -19,10 +19,13 @@
 
 #include <QString>
 #include <QStringList>
+#include <QTemporaryDir>
 #include <QtTest>
 #include <drumstick/backendmanager.h>
 #include <drumstick/rtmidiinput.h>
 #include <drumstick/rtmidioutput.h>
+#include <drumstick/midithrurouter.h>
+#include "midiparser.h"
 
 #if defined(LINUX_BACKEND)
 Q_IMPORT_PLUGIN(ALSAMIDIInput)
@@ -62,6 +65,51 @@ Q_IMPORT_PLUGIN(OSSOutput)
 
 using namespace drumstick::rt;
 
+class ParserInput : public MIDIInput
+{
+public:
+    explicit ParserInput(QObject *parent = nullptr) : MIDIInput(parent) {}
+    virtual void initialize(QSettings*) override {}
+    virtual QString backendName() override { return QStringLiteral("Parser"); }
+    virtual QString publicName() override { return QStringLiteral("Parser"); }
+    virtual void setPublicName(QString) override {}
+    virtual QList<MIDIConnection> connections(bool) override { return QList<MIDIConnection>(); }
+    virtual void setExcludedConnections(QStringList) override {}
+    virtual void open(const MIDIConnection&) override {}
+    virtual void close() override {}
+    virtual MIDIConnection currentConnection() override { return MIDIConnection(); }
+    virtual void setMIDIThruDevice(MIDIOutput*) override {}
+    virtual void enableMIDIThru(bool) override {}
+    virtual bool isEnabledMIDIThru() override { return false; }
+};
+
+class RecorderOutput : public MIDIOutput
+{
+public:
+    explicit RecorderOutput(QObject *parent = nullptr) : MIDIOutput(parent) {}
+    virtual void initialize(QSettings*) override {}
+    virtual QString backendName() override { return QStringLiteral("Recorder"); }
+    virtual QString publicName() override { return QStringLiteral("Recorder"); }
+    virtual void setPublicName(QString) override {}
+    virtual QList<MIDIConnection> connections(bool) override { return QList<MIDIConnection>(); }
+    virtual void setExcludedConnections(QStringList) override {}
+    virtual void open(const MIDIConnection&) override {}
+    virtual void close() override {}
+    virtual MIDIConnection currentConnection() override { return MIDIConnection(); }
+    virtual void sendNoteOff(int chan, int note, int vel) override { record(MIDI_STATUS_NOTEOFF + chan, note, vel); }
+    virtual void sendNoteOn(int chan, int note, int vel) override { record(MIDI_STATUS_NOTEON + chan, note, vel); }
+    virtual void sendKeyPressure(int chan, int note, int value) override { record(MIDI_STATUS_KEYPRESURE + chan, note, value); }
+    virtual void sendController(int chan, int control, int value) override { record(MIDI_STATUS_CONTROLCHANGE + chan, control, value); }
+    virtual void sendProgram(int chan, int program) override { record(MIDI_STATUS_PROGRAMCHANGE + chan, program, 0); }
+    virtual void sendChannelPressure(int chan, int value) override { record(MIDI_STATUS_CHANNELPRESSURE + chan, value, 0); }
+    virtual void sendPitchBend(int chan, int value) override { record(MIDI_STATUS_PITCHBEND + chan, value, 0); }
+    virtual void sendSysex(const QByteArray&) override { record(MIDI_STATUS_SYSEX, 0, 0); }
+    virtual void sendSystemMsg(const int status) override { record(status, 0, 0); }
+    QList<QList<int>> m_messages;
+private:
+    void record(int status, int m1, int m2) { m_messages.append(QList<int>{status, m1, m2}); }
+};
+
 class RtTest : public QObject
 {
     Q_OBJECT
@@ -71,9 +119,14 @@ public:
 
 private:
     QString joinConns(QList<MIDIConnection> conns);
+    QByteArray createStream(int size);
 
 private Q_SLOTS:
     void testRT();
+    void testNetTimestamps();
+    void testParser();
+    void benchmarkParser();
+    void testThruRouter();
 };
 
 RtTest::RtTest() = default;
@@ -121,6 +174,184 @@ void RtTest::testRT()
     }
 }
 
+void RtTest::testNetTimestamps()
+{
+    const int NUM_NOTES = 16;
+    QTemporaryDir dir;
+    QSettings settings(dir.filePath("rttest.ini"), QSettings::IniFormat);
+    settings.beginGroup("Network");
+    settings.setValue("timestamps", true);
+    settings.setValue("loopback", true);
+    settings.setValue("jitter_buffer", 10);
+    settings.endGroup();
+
+    BackendManager man;
+    man.refresh(&settings);
+    MIDIInput *input = man.inputBackendByName("Network");
+    MIDIOutput *output = man.outputBackendByName("Network");
+    if (input == nullptr || output == nullptr) {
+        QSKIP("Network backends not available");
+    }
+    input->initialize(&settings);
+    output->initialize(&settings);
+    QList<MIDIConnection> conns = input->connections();
+    QVERIFY(!conns.isEmpty());
+    input->open(conns.first());
+    output->open(conns.first());
+
+    QSignalSpy spy(input, &MIDIInput::midiNoteOn);
+    for (int i = 0; i < NUM_NOTES; ++i) {
+        output->sendNoteOn(0, 60 + i, 100);
+        QTest::qWait(5);
+    }
+    if (spy.isEmpty() && !spy.wait(2000)) {
+        input->close();
+        output->close();
+        QSKIP("Multicast loopback not available");
+    }
+    QTRY_COMPARE(spy.count(), NUM_NOTES);
+    for (int i = 0; i < NUM_NOTES; ++i) {
+        QCOMPARE(spy.at(i).at(1).toInt(), 60 + i);
+    }
+
+    QVariantMap stats = input->property("statistics").toMap();
+    qDebug() << "network statistics:" << stats;
+    QCOMPARE(stats["packets"].toInt(), NUM_NOTES);
+    QCOMPARE(stats["lost"].toInt(), 0);
+    QVERIFY(stats.contains("jitter_us"));
+    QVERIFY(stats.contains("buffer_delay_us"));
+    input->close();
+    output->close();
+}
+
+/*
+ * Builds a raw MIDI stream similar to a captured performance: notes with
+ * and without running status, controllers, pitch bend, MIDI clock bytes
+ * interleaved inside messages, and short sysex messages.
+ */
+QByteArray RtTest::createStream(int size)
+{
+    QByteArray stream;
+    stream.reserve(size + 64);
+    int n = 0;
+    while (stream.size() < size) {
+        int chan = n % MIDI_STD_CHANNELS;
+        int note = 36 + (n % 48);
+        stream.append(char(MIDI_STATUS_NOTEON + chan));
+        stream.append(char(note));
+        stream.append(char(MIDI_REALTIME_CLOCK));
+        stream.append(char(100));
+        stream.append(char(note + 4)); // running status
+        stream.append(char(90));
+        stream.append(char(MIDI_STATUS_CONTROLCHANGE + chan));
+        stream.append(char(MIDI_CONTROL_MSB_MAIN_VOLUME));
+        stream.append(char(n % 128));
+        stream.append(char(MIDI_STATUS_PITCHBEND + chan));
+        stream.append(char(0));
+        stream.append(char(0x40));
+        stream.append(char(MIDI_STATUS_NOTEON + chan));
+        stream.append(char(note));
+        stream.append(char(0));
+        stream.append(char(note + 4));
+        stream.append(char(0));
+        if (n % 64 == 0) {
+            stream.append(QByteArray::fromHex("f07e7f0901f7"));
+        }
+        ++n;
+    }
+    return stream;
+}
+
+void RtTest::testParser()
+{
+    ParserInput input;
+    MIDIParser parser(&input);
+    int noteOns = 0, controllers = 0, bends = 0, sysexes = 0, clocks = 0, bendValue = -1;
+    connect(&input, &MIDIInput::midiNoteOn, [&](int, int, int) { noteOns++; });
+    connect(&input, &MIDIInput::midiController, [&](int, int, int) { controllers++; });
+    connect(&input, &MIDIInput::midiPitchBend, [&](int, int v) { bends++; bendValue = v; });
+    connect(&input, &MIDIInput::midiSysex, [&](const QByteArray& data) {
+        sysexes++;
+        QCOMPARE(data, QByteArray::fromHex("f07e7f0901f7"));
+    });
+    connect(&input, &MIDIInput::midiSystemRealtime, [&](int) { clocks++; });
+
+    QByteArray stream = createStream(1);
+    // split the stream in arbitrary chunks
+    parser.parse(reinterpret_cast<const uchar*>(stream.constData()), 5);
+    parser.parse(reinterpret_cast<const uchar*>(stream.constData()) + 5, stream.size() - 5);
+    QCOMPARE(noteOns, 4);
+    QCOMPARE(controllers, 1);
+    QCOMPARE(bends, 1);
+    QCOMPARE(bendValue, 0);
+    QCOMPARE(sysexes, 1);
+    QCOMPARE(clocks, 1);
+
+    // orphan data bytes and oversized sysex are ignored
+    parser.reset();
+    parser.parse(QByteArray::fromHex("3c40"));
+    QByteArray huge(MIDIParser::MAX_SYSEX_SIZE + 16, 0x01);
+    huge[0] = char(MIDI_STATUS_SYSEX);
+    huge.append(char(MIDI_STATUS_ENDSYSEX));
+    parser.parse(huge);
+    QCOMPARE(noteOns, 4);
+    QCOMPARE(sysexes, 1);
+}
+
+void RtTest::benchmarkParser()
+{
+    ParserInput input;
+    MIDIParser parser(&input);
+    int noteOns = 0;
+    connect(&input, &MIDIInput::midiNoteOn, [&](int, int, int) { noteOns++; });
+    QByteArray stream = createStream(8 * 1024 * 1024);
+    QBENCHMARK {
+        parser.parse(reinterpret_cast<const uchar*>(stream.constData()), static_cast<size_t>(stream.size()));
+    }
+    QVERIFY(noteOns > 0);
+}
+
+void RtTest::testThruRouter()
+{
+    RecorderOutput out1, out2;
+    MIDIThruRouter router;
+    router.addOutput(&out1);
+    router.addOutput(&out2);
+    router.setChannelFilter(0x0003);
+    router.setNoteRange(36, 127);
+    router.setTranspose(12);
+    router.setChannelMap(1, 9);
+
+    router.sendNoteOn(0, 60, 100);  // forwarded, transposed
+    router.sendNoteOn(1, 48, 80);   // forwarded to channel 9
+    router.sendNoteOn(2, 60, 100);  // channel filtered
+    router.sendNoteOn(0, 30, 100);  // note out of range
+    router.sendNoteOn(0, 120, 100); // out of range after transposition
+    router.sendController(1, 7, 64);
+    router.sendSystemMsg(MIDI_REALTIME_CLOCK);
+    router.setSystemMessagesEnabled(false);
+    router.sendSystemMsg(MIDI_REALTIME_CLOCK);
+
+    QCOMPARE(out1.m_messages, out2.m_messages);
+    QCOMPARE(out1.m_messages.count(), 4);
+    QCOMPARE(out1.m_messages.at(0), (QList<int>{MIDI_STATUS_NOTEON, 72, 100}));
+    QCOMPARE(out1.m_messages.at(1), (QList<int>{MIDI_STATUS_NOTEON + 9, 60, 80}));
+    QCOMPARE(out1.m_messages.at(2), (QList<int>{MIDI_STATUS_CONTROLCHANGE + 9, 7, 64}));
+    QCOMPARE(out1.m_messages.at(3), (QList<int>{MIDI_REALTIME_CLOCK, 0, 0}));
+    QCOMPARE(router.forwardedMessages(), quint64(4));
+    QCOMPARE(router.filteredMessages(), quint64(4));
+    QVERIFY(router.minLatency() <= router.averageLatency());
+    QVERIFY(router.averageLatency() <= router.maxLatency());
+
+    // the router is a MIDI Thru device for any input, like the parser ones
+    ParserInput input;
+    router.attachInput(&input);
+    router.removeOutput(&out2);
+    router.resetStatistics();
+    QCOMPARE(router.outputs().count(), 1);
+    QCOMPARE(router.forwardedMessages(), quint64(0));
+}
+
 QString RtTest::joinConns(QList<MIDIConnection> conns)
 {
     QString res;
@@ -4,8 +4,13 @@ SUBDIRS += fileTest1 \
            rtTest \
            widgetsTest
 
+packagesExist(fluidsynth) {
+    SUBDIRS += fluidTest
+}
+
 linux {
     SUBDIRS += \
         alsaTest1 \
-        alsaTest2
+        alsaTest2 \
+        easTest
 }
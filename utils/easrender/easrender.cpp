@@ -0,0 +1,110 @@
+/*
+    Sonivox EAS batch rendering program
+    Copyright (C) 2016-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTextStream>
+#include "renderpool.h"
+
+using namespace drumstick::rt;
+
+QTextStream cout(stdout, QIODevice::WriteOnly);
+QTextStream cerr(stderr, QIODevice::WriteOnly);
+
+int main(int argc, char **argv)
+{
+    const QString PGM_NAME = QStringLiteral("drumstick-easrender");
+    const QString PGM_DESCRIPTION = QStringLiteral("Drumstick command line utility for rendering SMF (Standard MIDI) files with the Sonivox EAS synthesizer");
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(PGM_NAME);
+    QCoreApplication::setApplicationVersion(QStringLiteral(QT_STRINGIFY(VERSION)));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(PGM_DESCRIPTION);
+    auto helpOption = parser.addHelpOption();
+    auto versionOption = parser.addVersionOption();
+    QCommandLineOption outputOption({"o", "output"}, "Output directory (default: current directory).", "directory", ".");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Number of rendering threads (default: number of cores).", "threads");
+    QCommandLineOption groupsOption({"g", "groups"}, "Render the channels of each file in this number of separate groups (default: 1).", "groups", "1");
+    QCommandLineOption tailOption({"t", "tail"}, "Time rendered after the last event, in milliseconds (default: 2000).", "msecs", "2000");
+    QCommandLineOption rawOption({"r", "raw"}, "Write raw PCM samples instead of WAV files.");
+    parser.addOption(outputOption);
+    parser.addOption(jobsOption);
+    parser.addOption(groupsOption);
+    parser.addOption(tailOption);
+    parser.addOption(rawOption);
+    parser.addPositionalArgument("file", "Input SMF file name.", "files...");
+    parser.process(app);
+
+    if (parser.isSet(versionOption) || parser.isSet(helpOption)) {
+        return 0;
+    }
+
+    QStringList positionalArgs = parser.positionalArguments();
+    if (positionalArgs.isEmpty()) {
+        cerr << "Input file name(s) missing" << endl;
+        parser.showHelp();
+    }
+
+    QDir outputDir(parser.value(outputOption));
+    if (!outputDir.exists()) {
+        cerr << "Output directory not found: " << parser.value(outputOption) << endl;
+        return 1;
+    }
+    int groups = qBound(1, parser.value(groupsOption).toInt(), 16);
+    QString suffix = parser.isSet(rawOption) ? QStringLiteral(".pcm") : QStringLiteral(".wav");
+
+    RenderPool pool;
+    if (parser.isSet(jobsOption)) {
+        pool.setMaxThreads(parser.value(jobsOption).toInt());
+    }
+    pool.setTailTime(parser.value(tailOption).toInt());
+    foreach(const QString& a, positionalArgs) {
+        QFileInfo f(a);
+        if (!f.exists()) {
+            cerr << "File not found: " << a << endl;
+            continue;
+        }
+        for (int g = 0; g < groups; ++g) {
+            quint16 mask = 0;
+            for (int chan = g; chan < 16; chan += groups) {
+                mask |= 1 << chan;
+            }
+            QString name = f.completeBaseName();
+            if (groups > 1) {
+                name += QStringLiteral("-%1").arg(g + 1);
+            }
+            pool.addFile(f.canonicalFilePath(), outputDir.filePath(name + suffix), mask);
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = pool.run();
+    double elapsed = timer.elapsed() / 1000.0;
+    foreach(const QString& error, pool.errors()) {
+        cerr << error << endl;
+    }
+    cout << pool.jobCount() << " jobs, " << pool.renderedFrames() << " frames rendered in "
+         << elapsed << " seconds with " << pool.maxThreads() << " threads" << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+TEMPLATE = app
+TARGET = drumstick-easrender
+CONFIG += c++11 cmdline qt
+QT -= gui
+static {
+    CONFIG += link_prl
+    DEFINES += DRUMSTICK_STATIC
+}
+DESTDIR = ../../build/bin
+INCLUDEPATH += . ../../library/include \
+    ../../library/rt-backends/eassynth/src \
+    ../../library/rt-backends/eassynth/sonivox/host_src
+include (../../global.pri)
+include (../../library/rt-backends/eassynth/sonivox/sonivox.pri)
+# Input
+HEADERS += ../../library/rt-backends/eassynth/src/audioringbuffer.h \
+    ../../library/rt-backends/eassynth/src/offlinerenderer.h \
+    ../../library/rt-backends/eassynth/src/renderpool.h \
+    ../../library/rt-backends/eassynth/src/resampler.h \
+    ../../library/rt-backends/eassynth/src/synthrenderer.h
+SOURCES += easrender.cpp \
+    ../../library/rt-backends/eassynth/src/audioringbuffer.cpp \
+    ../../library/rt-backends/eassynth/src/offlinerenderer.cpp \
+    ../../library/rt-backends/eassynth/src/renderpool.cpp \
+    ../../library/rt-backends/eassynth/src/resampler.cpp \
+    ../../library/rt-backends/eassynth/src/synthrenderer.cpp
+
+LIBS = -L$$OUT_PWD/../../build/lib \
+    -l$$drumstickLib(drumstick-file) \
+    -lsonivox
+CONFIG += link_pkgconfig
+PKGCONFIG += libpulse-simple libpulse
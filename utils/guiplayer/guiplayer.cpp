@@ -433,12 +433,14 @@ void GUIPlayer::sequencerEvent(SequencerEvent *ev)
     if ((ev->getSequencerType() == SND_SEQ_EVENT_ECHO) && (m_tick != 0)){
         auto t = ev->getTick();
         int pos = 100 * t / m_tick;
-        const snd_seq_real_time_t* rt = m_Queue->getStatus().getRealtime();
-        int mins = rt->tv_sec / 60;
-        int secs =  rt->tv_sec % 60;
-        int cnts = qFloor( rt->tv_nsec / 1.0e7 );
-        updateTempoLabel(m_Queue->getTempo().getRealBPM());
-        updateTimeLabel(mins, secs, cnts);
+        QueuePosition qpos;
+        if (m_Queue->getPosition(qpos)) {
+            int mins = qpos.time.tv_sec / 60;
+            int secs =  qpos.time.tv_sec % 60;
+            int cnts = qFloor( qpos.time.tv_nsec / 1.0e7 );
+            updateTempoLabel(qpos.realBPM);
+            updateTimeLabel(mins, secs, cnts);
+        }
         m_ui->progressBar->setValue(pos);
         if (t >= m_tick) {
             songFinished();
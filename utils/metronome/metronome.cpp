@@ -77,10 +77,7 @@ Metronome::Metronome(QObject *parent) : QObject(parent),
     m_Port->setTimestamping(true);
     m_Port->setTimestampQueue(m_queueId);
     // Get and apply the best available timer
-    TimerId best = Timer::bestGlobalTimerId();
-    QueueTimer qtimer;
-    qtimer.setId(best);
-    m_Queue->setTimer(qtimer);
+    m_Queue->setBestTimer();
     // Start sequencer input
     m_Client->setRealTimeInput(false);
     m_Client->startSequencerInput();
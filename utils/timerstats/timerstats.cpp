@@ -0,0 +1,141 @@
+/*
+    MIDI Sequencer C++ library
+    Copyright (C) 2006-2021, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+#include <drumstick/alsatimer.h>
+#include <drumstick/sequencererror.h>
+
+QString PGM_NAME = QStringLiteral("drumstick-timerstats");
+QString PGM_DESCRIPTION = QStringLiteral("ALSA Timer Statistics");
+QTextStream cout(stdout, QIODevice::WriteOnly);
+QTextStream cerr(stderr, QIODevice::WriteOnly);
+
+using namespace drumstick::ALSA;
+
+/* times are printed in microseconds */
+double usecs(qint64 nsecs)
+{
+    return nsecs / 1000.0;
+}
+
+void printHistogram(const TimerStatistics& st)
+{
+    for (int i = 0; i < TIMER_JITTER_BINS; ++i) {
+        if (st.histogram[i] == 0)
+            continue;
+        QString range;
+        if (i == 0)
+            range = QStringLiteral("< 1 us");
+        else if (i == TIMER_JITTER_BINS - 1)
+            range = QString(">= %1 us").arg(1 << (i - 1));
+        else
+            range = QString("%1-%2 us").arg(1 << (i - 1)).arg(1 << i);
+        cout << "    " << qSetFieldWidth(16) << left << range
+             << qSetFieldWidth(10) << right << st.histogram[i]
+             << qSetFieldWidth(0) << endl;
+    }
+}
+
+void queryTimers(int frequency, int duration, bool histogram)
+{
+    cout << PGM_DESCRIPTION << ", version: "<< QStringLiteral(QT_STRINGIFY(VERSION)) << endl;
+    cout << "Requested frequency: " << frequency << " Hz, "
+         << "measuring during " << duration << " ms" << endl;
+    cout << "Times in microseconds, drift in parts per million, "
+         << "relative jitter and CPU load in percent" << endl;
+    cout << "Timers not reaching the requested frequency are marked with *" << endl;
+    cout << "Timers ranked from the best to the worst" << endl << endl;
+    cout << "Name________________  Periods   Nominal      Mean       Min"
+         << "       Max  Mean_Jit   Max_Jit  Rel_Jit    Drift Overruns   CPU" << endl;
+    TimerBenchmarkList results = Timer::benchmarkTimers(frequency, duration);
+    foreach( const TimerBenchmarkResult& r, results ) {
+        const TimerStatistics& st = r.stats;
+        cout << qSetFieldWidth(20) << left << r.name.left(20)
+             << qSetFieldWidth(0) << (r.reachable ? " " : "*")
+             << qSetFieldWidth(9) << right << st.periods
+             << qSetFieldWidth(10) << fixed << qSetRealNumberPrecision(1)
+             << usecs(st.nominalPeriod)
+             << usecs(st.meanPeriod)
+             << usecs(st.minPeriod)
+             << usecs(st.maxPeriod)
+             << usecs(st.meanJitter)
+             << usecs(st.maxJitter)
+             << qSetFieldWidth(9) << r.relativeJitter
+             << qSetFieldWidth(9) << st.drift
+             << qSetFieldWidth(9) << st.overruns
+             << qSetFieldWidth(6) << r.cpuLoad
+             << qSetFieldWidth(0) << endl;
+        if (histogram)
+            printHistogram(st);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const QString ERRORSTR = QStringLiteral("Fatal error from the ALSA timers. "
+        "This usually happens when the kernel doesn't have ALSA support, "
+        "or the device node (/dev/snd/timer) doesn't exists. "
+        "Please check your ALSA configuration.");
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(PGM_NAME);
+    QCoreApplication::setApplicationVersion(QStringLiteral(QT_STRINGIFY(VERSION)));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(PGM_DESCRIPTION);
+    auto helpOption = parser.addHelpOption();
+    auto versionOption = parser.addVersionOption();
+    QCommandLineOption frequencyOption({"f", "frequency"},
+        "Requested timer frequency in Hz. Default: 1000.", "hz", "1000");
+    QCommandLineOption durationOption({"d", "duration"},
+        "Measuring time for each timer, in milliseconds. Default: 2000.", "msecs", "2000");
+    QCommandLineOption histogramOption({"H", "histogram"},
+        "Prints the jitter histogram of each timer.");
+    parser.addOption(frequencyOption);
+    parser.addOption(durationOption);
+    parser.addOption(histogramOption);
+    parser.process(app);
+
+    if (parser.isSet(versionOption) || parser.isSet(helpOption)) {
+        return 0;
+    }
+
+    bool ok;
+    int frequency = parser.value(frequencyOption).toInt(&ok);
+    if (!ok || frequency < 1) {
+        cerr << "Invalid frequency: " << parser.value(frequencyOption) << endl;
+        return 1;
+    }
+    int duration = parser.value(durationOption).toInt(&ok);
+    if (!ok || duration < 1) {
+        cerr << "Invalid duration: " << parser.value(durationOption) << endl;
+        return 1;
+    }
+
+    try {
+        queryTimers(frequency, duration, parser.isSet(histogramOption));
+    } catch (const SequencerError& ex) {
+        cerr << ERRORSTR << " Returned error was: " << ex.qstrError() << endl;
+    } catch (...) {
+        cerr << ERRORSTR << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = drumstick-timerstats
+CONFIG += c++11 cmdline qt thread exceptions
+static {
+    CONFIG += link_prl
+}
+DESTDIR = ../../build/bin
+INCLUDEPATH += . ../../library/include
+DEPENDPATH += . ../../library ../../library/include
+LIBS = -L../../build/lib -ldrumstick-alsa -lasound
+include (../../global.pri)
+# Input
+SOURCES += timerstats.cpp
@@ -11,10 +11,12 @@ linux {
     SUBDIRS += \
        drumgrid \
        dumpmid \
+       easrender \
        guiplayer \
        metronome \
        playsmf \
-       sysinfo
+       sysinfo \
+       timerstats
 }
 macx {
     OTHER_FILES += Info.plist.app
@@ -105,6 +105,11 @@ VPiano::VPiano( QWidget * parent, Qt::WindowFlags flags)
     centralOctaveGroup->addAction(ui.actionC5);
     connect(centralOctaveGroup, &QActionGroup::triggered, this, &VPiano::slotCentralOctave);
 
+    m_statistics = new QLabel(this);
+    ui.statusBar->addPermanentWidget(m_statistics);
+    connect(&m_statisticsTimer, &QTimer::timeout, this, &VPiano::slotUpdateStatistics);
+    m_statisticsTimer.start(1000);
+
     ui.statusBar->hide();
 }
 
@@ -546,6 +551,34 @@ void VPiano::slotCustomNames(bool sharps)
     }
 }
 
+/*
+ * Output backends may publish a "statistics" property, like the Sonivox
+ * synth voice and render counters. The status bar shows a short summary
+ * of the voices, underruns and CPU load, and the tooltip the whole map.
+ */
+void VPiano::slotUpdateStatistics()
+{
+    QVariantMap stats;
+    if (m_midiOut != nullptr) {
+        stats = m_midiOut->property("statistics").toMap();
+    }
+    QStringList items, summary;
+    for (auto it = stats.constBegin(); it != stats.constEnd(); ++it) {
+        items << QString("%1: %2").arg(it.key(), it.value().toString());
+    }
+    if (stats.contains("active_voices")) {
+        summary << tr("Voices: %1").arg(stats["active_voices"].toInt());
+    }
+    if (stats.contains("underruns")) {
+        summary << tr("Underruns: %1").arg(stats["underruns"].toInt() + stats["ring_underruns"].toInt());
+    }
+    if (stats.contains("render_load_percent")) {
+        summary << tr("CPU: %1%").arg(stats["render_load_percent"].toDouble(), 0, 'f', 1);
+    }
+    m_statistics->setText(summary.join(QLatin1String("  ")));
+    m_statistics->setToolTip(items.join(QLatin1Char('\n')));
+}
+
 void VPiano::slotNoteName(const QString& name)
 {
     if (name.isEmpty()) {
@@ -21,6 +21,8 @@
 
 #include <QMainWindow>
 #include <QCloseEvent>
+#include <QLabel>
+#include <QTimer>
 #include <drumstick/rtmidiinput.h>
 #include <drumstick/rtmidioutput.h>
 #include "ui_vpiano.h"
@@ -59,6 +61,7 @@ public slots:
     void slotStandardNames();
     void slotCustomNames(bool sharps);
     void slotNoteName(const QString& name);
+    void slotUpdateStatistics();
 
 private:
     void initialize();
@@ -68,6 +71,8 @@ private:
     QList<drumstick::rt::MIDIOutput*> m_outputs;
     drumstick::rt::MIDIInput * m_midiIn;
     drumstick::rt::MIDIOutput* m_midiOut;
+    QLabel* m_statistics;
+    QTimer m_statisticsTimer;
     Ui::VPiano ui;
 
 //  QStringList m_names_s{"do", "do♯", "re", "re♯", "mi", "fa", "fa♯", "sol", "sol♯", "la", "la♯", "si"};